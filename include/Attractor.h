@@ -26,11 +26,13 @@
 #include <vector>
 
 #include "Force.h"
+#include "ParticleForce.h"
 #include "PVector.h"
 #include "Physics.h"
 #include "Particle.h"
+#include "Util.h"
 
-class Attractor final : public Force {
+class Attractor final : public Force, public ParticleForce {
 protected:
     PVector    mPosition;
     float      mRadius;
@@ -48,12 +50,8 @@ public:
           mDead(false),
           mID(Physics::getUniqueID()) {}
 
-    static float fastInverseSqrt(float v) {
-        const float half = 0.5f * v;
-        int         i    = *reinterpret_cast<int*>(&v);
-        i                = 0x5f375a86 - (i >> 1);
-        v                = *reinterpret_cast<float*>(&i);
-        return v * (1.5f - half * v * v);
+    static float fastInverseSqrt(const float v) {
+        return Util::fastInverseSqrt(v);
     }
 
     PVector& position() {
@@ -81,20 +79,43 @@ public:
     }
 
     void apply(float pDeltaTime, Physics& pParticleSystem) override {
-        if (mStrength != 0) {
-            const auto& particles = pParticleSystem.particles();
-            for (const auto& mParticle: particles) {
-                if (!mParticle->fixed()) {
-                    PVector     mTemp     = PVector::sub(mPosition, mParticle->position());
-                    const float mDistance = fastInverseSqrt(1.0f / mTemp.magSq());
-                    if (mDistance < mRadius) {
-                        const float mFallOff = 1.0f - mDistance / mRadius;
-                        const float mForce   = mFallOff * mFallOff * mStrength;
-                        mTemp.mult(mForce / mDistance);
-                        mParticle->force().add(mTemp);
-                    }
+        apply(pDeltaTime, pParticleSystem, 0, pParticleSystem.particles().size());
+    }
+
+    void apply(float /* pDeltaTime */, Physics& pParticleSystem, const size_t pBegin, const size_t pEnd) override {
+        if (mStrength == 0) {
+            return;
+        }
+
+        if (ParticleStore* mStore = pParticleSystem.packed()) {
+            const PVector* mPositions = mStore->positions();
+            PVector*       mForces    = mStore->forces();
+            const uint8_t* mFlags     = mStore->flags();
+            for (size_t i = pBegin; i < pEnd; ++i) {
+                if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+                    attract(mPositions[i], mForces[i]);
                 }
             }
+            return;
+        }
+
+        const auto& particles = pParticleSystem.particles();
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            Particle* mParticle = particles[i];
+            if (!mParticle->fixed()) {
+                attract(mParticle->position(), mParticle->force());
+            }
+        }
+    }
+
+    void attract(const PVector& pPosition, PVector& pForce) const {
+        PVector     mTemp     = PVector::sub(mPosition, pPosition);
+        const float mDistance = Util::fastInverseSqrt(1.0f / mTemp.magSq());
+        if (mDistance < mRadius) {
+            const float mFallOff = 1.0f - mDistance / mRadius;
+            const float mForce   = mFallOff * mFallOff * mStrength;
+            mTemp.mult(mForce / mDistance);
+            pForce.add(mTemp);
         }
     }
 
@@ -0,0 +1,128 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Force.h"
+#include "ParticleForce.h"
+#include "PVector.h"
+
+class Physics;
+
+using namespace umgebung;
+
+/*
+ * a set of attractors that is applied in a single pass over the particles. every attractor behaves like an
+ * `Attractor`, i.e it pulls particles within `radius` towards its position with `strength * ( 1 - distance /
+ * radius )^2`. the particles are processed in blocks of `BLOCK_SIZE`, attractors that can not reach the bounding
+ * box of a block are skipped for the whole block. this is much faster than adding many `Attractor`s, which each
+ * iterate over all particles.
+ */
+class AttractorField final : public Force, public ParticleForce {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t BATCH_SIZE = 256;
+
+private:
+    std::vector<float> mX;
+    std::vector<float> mY;
+    std::vector<float> mZ;
+    std::vector<float> mRadii;
+    std::vector<float> mStrengths;
+    bool               mActive;
+    bool               mDead;
+    const long         mID;
+
+public:
+    AttractorField();
+
+    /* adds an attractor and returns its index */
+    size_t add(const PVector& pPosition, float pRadius = 100.0f, float pStrength = 1.0f);
+
+    /* removes the attractor at `pIndex`, the indices of all following attractors are decremented */
+    void remove(size_t pIndex);
+
+    void clear();
+
+    size_t size() const {
+        return mX.size();
+    }
+
+    PVector position(const size_t pIndex) const {
+        return {mX[pIndex], mY[pIndex], mZ[pIndex]};
+    }
+
+    void position(const size_t pIndex, const PVector& pPosition) {
+        mX[pIndex] = pPosition.x;
+        mY[pIndex] = pPosition.y;
+        mZ[pIndex] = pPosition.z;
+    }
+
+    float radius(const size_t pIndex) const {
+        return mRadii[pIndex];
+    }
+
+    void radius(const size_t pIndex, const float pRadius) {
+        mRadii[pIndex] = pRadius;
+    }
+
+    float strength(const size_t pIndex) const {
+        return mStrengths[pIndex];
+    }
+
+    void strength(const size_t pIndex, const float pStrength) {
+        mStrengths[pIndex] = pStrength;
+    }
+
+    void apply(float pDeltaTime, Physics& pParticleSystem) override;
+
+    void apply(float pDeltaTime, Physics& pParticleSystem, size_t pBegin, size_t pEnd) override;
+
+    bool dead() const override {
+        return mDead;
+    }
+
+    void dead(const bool pDead) override {
+        mDead = pDead;
+    }
+
+    bool active() const override {
+        return mActive;
+    }
+
+    void active(const bool pActiveState) override {
+        mActive = pActiveState;
+    }
+
+    long ID() const override {
+        return mID;
+    }
+
+    static AttractorField* make() {
+        return new AttractorField();
+    }
+};
@@ -45,20 +45,7 @@ class BasicParticle final : public Particle {
     PVector    mVelocity;
 
 public:
-    BasicParticle()
-        : mAge(0),
-          mDead(false),
-          mFixed(false),
-          mForce(0, 0, 0),
-          mID(0),
-          // mID(Physics::getUniqueID()),
-          mMass(1.0f),
-          mOldPosition(0, 0, 0),
-          mPosition(0, 0, 0),
-          mRadius(0.0f),
-          mStill(false),
-          mTagged(false),
-          mVelocity(0, 0, 0) {}
+    BasicParticle();
 
     bool     fixed() const override { return mFixed; }
     void     fixed(const bool pFixed) override { mFixed = pFixed; }
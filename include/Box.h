@@ -55,10 +55,18 @@ public:
         mTeleport = pTeleportState;
     }
 
+    bool teleport() const {
+        return mTeleport;
+    }
+
     void reflect(const bool pReflectState) {
         mReflectFlag = pReflectState;
     }
 
+    bool reflect() const {
+        return mReflectFlag;
+    }
+
     PVector& min() {
         return mMin;
     }
@@ -96,9 +104,4 @@ public:
     long ID() const override {
         return mID;
     }
-
-    static long getUniqueID() {
-        static long uniqueID = 0;
-        return uniqueID++;
-    }
 };
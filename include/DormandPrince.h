@@ -0,0 +1,93 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Physics.h"
+#include "Integrator.h"
+#include "PVector.h"
+
+/**
+ * adaptive embedded runge-kutta integrator ( dormand-prince 5(4) ). each frame is split into substeps whose size is
+ * chosen from the difference between the 5th and 4th order solutions. calm scenes advance in a single substep, stiff
+ * transients are subdivided until the local error is below `tolerance`. the substep size is kept across frames.
+ *
+ * unlike `RungeKutta` forces are cleared before every evaluation, so each stage sees only the forces of its own state.
+ */
+class DormandPrince final : public Integrator {
+    static constexpr int NUM_STAGES = 7;
+
+    float mTolerance = 0.001f;
+    float mMinStep   = 0.0001f;
+    float mMaxStep   = 1.0f / 30.0f;
+    float mSafety    = 0.9f;
+    float mStep      = 0.0f;
+
+    int mEvaluations = 0;
+    int mSubsteps    = 0;
+    int mRejected    = 0;
+
+    std::vector<PVector*> mPositions;
+    std::vector<PVector*> mVelocities;
+    std::vector<PVector*> mForces;
+    std::vector<float>    mInverseMasses;
+    std::vector<PVector>  mOriginalPositions;
+    std::vector<PVector>  mOriginalVelocities;
+    std::vector<PVector>  mKPositions[NUM_STAGES];
+    std::vector<PVector>  mKVelocities[NUM_STAGES];
+
+public:
+    void step(float pDeltaTime, Physics& pParticleSystem) override;
+
+    /* maximum accepted local error, mixed absolute and relative to the magnitude of positions and velocities */
+    float tolerance() const { return mTolerance; }
+    void  tolerance(const float pTolerance) { mTolerance = pTolerance; }
+
+    /* substeps never get smaller than `min_step`, a substep of this size is accepted regardless of its error */
+    float min_step() const { return mMinStep; }
+    void  min_step(const float pMinStep) { mMinStep = pMinStep; }
+
+    float max_step() const { return mMaxStep; }
+    void  max_step(const float pMaxStep) { mMaxStep = pMaxStep; }
+
+    float safety() const { return mSafety; }
+    void  safety(const float pSafety) { mSafety = pSafety; }
+
+    /* size of the next substep as proposed by the error control, `0` before the first step */
+    float substep() const { return mStep; }
+    void  substep(const float pStep) { mStep = pStep; }
+    void  reset() { mStep = 0.0f; }
+
+    /* statistics of the last call to `step` */
+    int evaluations() const { return mEvaluations; }
+    int substeps() const { return mSubsteps; }
+    int rejected() const { return mRejected; }
+
+private:
+    void  collect(Physics& pParticleSystem);
+    void  evaluate(float pDeltaTime, Physics& pParticleSystem, int pStage);
+    void  advance(float pDeltaTime, int pStage);
+    float error(float pDeltaTime) const;
+};
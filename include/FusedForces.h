@@ -0,0 +1,85 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "PVector.h"
+
+class Physics;
+class ParticleForce;
+class ParticleStore;
+
+using namespace umgebung;
+
+/*
+ * evaluates a batch of consecutive particle forces on a packed `ParticleStore` in one pass over the particles.
+ * the built-in forces `Gravity`, `ViscousDrag` and `Attractor` are translated into operations that run as tight
+ * loops over blocks of `BLOCK_SIZE` particles while the block is in cache, all other particle forces are applied
+ * to the block in between. the positions of a block are gathered once for all attractors, which are evaluated 8
+ * particles at a time when compiled with AVX2. every particle receives the forces in the same order and with the
+ * same arithmetic as when applying them one by one, so results are identical. while particles sleep a batch of
+ * built-in forces only visits the awake particles of the store.
+ */
+class FusedForces {
+public:
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    /* translates the forces of `pBatch`, returns false if none of them is a built-in force */
+    bool build(const std::vector<ParticleForce*>& pBatch, Physics& pParticleSystem);
+
+    /* applies the batch to the particles `[pBegin, pEnd)` of `pStore`, may be called from multiple threads */
+    void apply(float pDeltaTime, Physics& pParticleSystem, ParticleStore& pStore, size_t pBegin, size_t pEnd) const;
+
+    /* true if the batch consists of built-in forces only and can be applied with `applyAwake()` */
+    bool built_in() const { return mOnlyBuiltIn; }
+
+    /* applies the batch to the entries `[pBegin, pEnd)` of `ParticleStore::awake()`, may be called from multiple threads */
+    void applyAwake(ParticleStore& pStore, size_t pBegin, size_t pEnd) const;
+
+private:
+    enum Type {
+        GRAVITY,
+        VISCOUS_DRAG,
+        ATTRACTOR,
+        OTHER
+    };
+
+    struct Operation {
+        Type           type;
+        PVector        vector;
+        float          radius;
+        float          strength;
+        ParticleForce* force;
+    };
+
+    struct Block;
+
+    std::vector<Operation> mOperations;
+    bool                   mOnlyBuiltIn = false;
+
+    static void attract(const Operation& pOperation, ParticleStore& pStore, Block& pBlock);
+};
@@ -26,11 +26,12 @@
 #include <vector>
 
 #include "Force.h"
+#include "ParticleForce.h"
 #include "PVector.h"
 #include "Physics.h"
 #include "Particle.h"
 
-class Gravity final : public Force {
+class Gravity final : public Force, public ParticleForce {
 
     bool       mActive;
     bool       mDead;
@@ -51,8 +52,24 @@ public:
     }
 
     void apply(float pDeltaTime, Physics& pParticleSystem) override {
+        apply(pDeltaTime, pParticleSystem, 0, pParticleSystem.particles().size());
+    }
+
+    void apply(float /* pDeltaTime */, Physics& pParticleSystem, const size_t pBegin, const size_t pEnd) override {
+        if (ParticleStore* mStore = pParticleSystem.packed()) {
+            PVector*       mForces = mStore->forces();
+            const uint8_t* mFlags  = mStore->flags();
+            for (size_t i = pBegin; i < pEnd; ++i) {
+                if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+                    mForces[i].add(mForce);
+                }
+            }
+            return;
+        }
+
         const auto& particles = pParticleSystem.particles();
-        for (const auto& mParticle: particles) {
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            Particle* mParticle = particles[i];
             if (!mParticle->fixed()) {
                 mParticle->force().add(mForce);
             }
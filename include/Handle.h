@@ -0,0 +1,155 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * generational reference to an object registered with `Physics`. a handle consists of a stable slot index and the
+ * generation of the slot at the time the handle was issued. once the object is removed the generation of its slot
+ * is incremented, so stale handles resolve to `nullptr` even after the slot is reused.
+ */
+template<typename T>
+struct Handle {
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    uint32_t index      = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != INVALID_INDEX; }
+
+    bool operator==(const Handle& pOther) const { return index == pOther.index && generation == pOther.generation; }
+    bool operator!=(const Handle& pOther) const { return !(*this == pOther); }
+};
+
+/*
+ * slot table that issues handles for objects and resolves handles, object addresses and IDs in constant time.
+ * released slots are reused in LIFO order.
+ */
+template<typename T>
+class HandleTable {
+    struct Slot {
+        T*       object     = nullptr;
+        long     id         = 0;
+        uint32_t generation = 0;
+    };
+
+    std::vector<Slot>                      mSlots;
+    std::vector<uint32_t>                  mFreeSlots;
+    std::unordered_map<const T*, uint32_t> mSlotByObject;
+    std::unordered_map<long, uint32_t>     mSlotByID;
+
+public:
+    /* registers `pObject` and returns its handle. an object that is already registered keeps its handle. */
+    Handle<T> insert(T* pObject) {
+        const auto it = mSlotByObject.find(pObject);
+        if (it != mSlotByObject.end()) {
+            return {it->second, mSlots[it->second].generation};
+        }
+        uint32_t mIndex;
+        if (mFreeSlots.empty()) {
+            mIndex = static_cast<uint32_t>(mSlots.size());
+            mSlots.emplace_back();
+        } else {
+            mIndex = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        Slot& mSlot  = mSlots[mIndex];
+        mSlot.object = pObject;
+        mSlot.id     = pObject->ID();
+        mSlotByObject.emplace(pObject, mIndex);
+        mSlotByID[mSlot.id] = mIndex;
+        return {mIndex, mSlot.generation};
+    }
+
+    /* unregisters `pObject` without accessing it, so it may be called for objects that are already destroyed */
+    bool erase(const T* pObject) {
+        const auto it = mSlotByObject.find(pObject);
+        if (it == mSlotByObject.end()) {
+            return false;
+        }
+        const uint32_t mIndex = it->second;
+        mSlotByObject.erase(it);
+        Slot&      mSlot = mSlots[mIndex];
+        const auto mID   = mSlotByID.find(mSlot.id);
+        if (mID != mSlotByID.end() && mID->second == mIndex) {
+            mSlotByID.erase(mID);
+        }
+        mSlot.object = nullptr;
+        ++mSlot.generation;
+        mFreeSlots.push_back(mIndex);
+        return true;
+    }
+
+    T* get(const Handle<T>& pHandle) const {
+        if (pHandle.index >= mSlots.size()) {
+            return nullptr;
+        }
+        const Slot& mSlot = mSlots[pHandle.index];
+        return mSlot.generation == pHandle.generation ? mSlot.object : nullptr;
+    }
+
+    /* returns the handle of `pObject` or an invalid handle if it is not registered */
+    Handle<T> find(const T* pObject) const {
+        const auto it = mSlotByObject.find(pObject);
+        if (it == mSlotByObject.end()) {
+            return {};
+        }
+        return {it->second, mSlots[it->second].generation};
+    }
+
+    T* find(const long pID) const {
+        const auto it = mSlotByID.find(pID);
+        return it == mSlotByID.end() ? nullptr : mSlots[it->second].object;
+    }
+
+    bool contains(const T* pObject) const {
+        return mSlotByObject.count(pObject) > 0;
+    }
+
+    size_t size() const {
+        return mSlotByObject.size();
+    }
+
+    void reserve(const size_t pCapacity) {
+        mSlots.reserve(pCapacity);
+        mSlotByObject.reserve(pCapacity);
+        mSlotByID.reserve(pCapacity);
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i < mSlots.size(); ++i) {
+            if (mSlots[i].object != nullptr) {
+                mSlots[i].object = nullptr;
+                ++mSlots[i].generation;
+                mFreeSlots.push_back(i);
+            }
+        }
+        mSlotByObject.clear();
+        mSlotByID.clear();
+    }
+};
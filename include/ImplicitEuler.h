@@ -0,0 +1,86 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "Physics.h"
+#include "Integrator.h"
+#include "PVector.h"
+
+class Spring;
+
+/**
+ * backward euler integrator for stiff springs. all active two-way `Spring` forces in `Physics::forces()` are
+ * linearized around the current state and the resulting system `( M - h * df/dv - h^2 * df/dx ) dv = h * ( f + h *
+ * df/dx * v )` is solved with a matrix-free, jacobi-preconditioned conjugate gradient. all other forces, including
+ * one-way springs, are treated explicitly. stiff cloth stays stable with a single solve per frame, at the cost of
+ * some numerical damping.
+ */
+class ImplicitEuler final : public Integrator {
+    struct SpringBlock {
+        int   a;
+        int   b;
+        float xx, xy, xz, yy, yz, zz; /* stiffness jacobian `-df/dx` */
+        float dx, dy, dz;             /* damping jacobian `-df/dv`, diagonal */
+    };
+
+    int   mIterations     = 32;
+    float mTolerance      = 0.0001f;
+    int   mLastIterations = 0;
+
+    std::vector<PVector*>                     mPositions;
+    std::vector<PVector*>                     mVelocities;
+    std::vector<PVector*>                     mForces;
+    std::vector<float>                        mMasses;
+    std::unordered_map<const Particle*, int> mIndices;
+    std::vector<SpringBlock>                  mSprings;
+    std::vector<PVector>                      mDeltaVelocities;
+    std::vector<PVector>                      mResiduals;
+    std::vector<PVector>                      mDirections;
+    std::vector<PVector>                      mProducts;
+    std::vector<PVector>                      mPreconditioned;
+    std::vector<PVector>                      mInverseDiagonal;
+
+public:
+    void step(float pDeltaTime, Physics& pParticleSystem) override;
+
+    /* maximum number of conjugate gradient iterations per step */
+    int  iterations() const { return mIterations; }
+    void iterations(const int pIterations) { mIterations = pIterations; }
+
+    /* solve stops once the residual dropped below `tolerance` relative to the right-hand side */
+    float tolerance() const { return mTolerance; }
+    void  tolerance(const float pTolerance) { mTolerance = pTolerance; }
+
+    /* number of conjugate gradient iterations used by the last step */
+    int last_iterations() const { return mLastIterations; }
+
+private:
+    void collect(Physics& pParticleSystem);
+    void collectSprings(float pDeltaTime, Physics& pParticleSystem);
+    void multiply(float pDeltaTime, const std::vector<PVector>& pVector, std::vector<PVector>& pResult) const;
+    void solve(float pDeltaTime);
+};
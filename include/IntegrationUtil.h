@@ -25,8 +25,10 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
 
 #include "Particle.h"
+#include "ParticleStore.h"
 #include "Derivate3f.h"
 
 class IntegrationUtil {
@@ -52,6 +54,21 @@ public:
         }
     }
 
+    static void calculateDerivatives(ParticleStore& pStore, std::vector<Derivate3f>& pDerivates) {
+        const size_t   mSize       = std::min(pStore.size(), pDerivates.size());
+        const PVector* mVelocities = pStore.velocities();
+        const PVector* mForces     = pStore.forces();
+        const float*   mMasses     = pStore.masses();
+        for (size_t i = 0; i < mSize; ++i) {
+            pDerivates[i].px = mVelocities[i].x;
+            pDerivates[i].py = mVelocities[i].y;
+            pDerivates[i].pz = mVelocities[i].z;
+            pDerivates[i].vx = mForces[i].x / mMasses[i];
+            pDerivates[i].vy = mForces[i].y / mMasses[i];
+            pDerivates[i].vz = mForces[i].z / mMasses[i];
+        }
+    }
+
     template<typename T>
     static void checkContainerSize(const int pSize, std::vector<T>& pContainer) {
         int mDiff = pSize - static_cast<int>(pContainer.size());
@@ -34,4 +34,7 @@ class Midpoint final : public Integrator {
 
 public:
     void step(float pDeltaTime, Physics& pParticleSystem) override;
+
+private:
+    void step(float pDeltaTime, Physics& pParticleSystem, ParticleStore& pStore);
 };
\ No newline at end of file
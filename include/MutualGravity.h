@@ -0,0 +1,169 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Force.h"
+#include "PVector.h"
+
+class Physics;
+
+using namespace umgebung;
+
+/*
+ * mutual attraction between all particles of the particle system. every step an octree is built over the
+ * particles and distant groups of particles are approximated by their total mass at their center of mass
+ * ( Barnes-Hut ), which reduces the cost from O(n^2) to O(n log n). `theta` is the opening angle: groups whose
+ * extent divided by their distance is below `theta` are approximated, `0` computes all pairs exactly.
+ *
+ * with `FALLOFF_ATTRACTOR` every particle acts like an `Attractor` with `strength` scaled by its mass, i.e the
+ * force falls off with `( 1 - distance / radius )^2`. with `FALLOFF_INVERSE_SQUARE` particles attract each other
+ * with `strength * m1 * m2 / ( distance^2 + softening^2 )`. in both cases particles farther apart than `radius`
+ * do not interact. fixed particles attract others but are not moved.
+ */
+class MutualGravity final : public Force {
+public:
+    enum Falloff {
+        FALLOFF_ATTRACTOR,
+        FALLOFF_INVERSE_SQUARE
+    };
+
+    static constexpr uint32_t LEAF_SIZE           = 8;
+    static constexpr uint32_t MAX_DEPTH           = 32;
+    static constexpr size_t   PARALLEL_GRAIN_SIZE = 128;
+
+private:
+    struct Node {
+        PVector  center;
+        PVector  min;
+        PVector  max;
+        float    mass;
+        float    sizeSquared;
+        uint32_t next;
+        uint32_t begin;
+        uint32_t end;
+        bool     leaf;
+    };
+
+    float      mStrength;
+    float      mRadius;
+    float      mTheta;
+    float      mSoftening;
+    Falloff    mFalloff;
+    bool       mActive;
+    bool       mDead;
+    const long mID;
+
+    std::vector<Node>     mNodes;
+    std::vector<uint32_t> mOrder;
+    std::vector<PVector>  mPositions;
+    std::vector<float>    mMasses;
+
+public:
+    MutualGravity();
+
+    float strength() const {
+        return mStrength;
+    }
+
+    void strength(const float pStrength) {
+        mStrength = pStrength;
+    }
+
+    float radius() const {
+        return mRadius;
+    }
+
+    void radius(const float pRadius) {
+        mRadius = pRadius;
+    }
+
+    float theta() const {
+        return mTheta;
+    }
+
+    void theta(const float pTheta) {
+        mTheta = pTheta;
+    }
+
+    /* only used with `FALLOFF_INVERSE_SQUARE`, limits the force between close particles */
+    float softening() const {
+        return mSoftening;
+    }
+
+    void softening(const float pSoftening) {
+        mSoftening = pSoftening;
+    }
+
+    Falloff falloff() const {
+        return mFalloff;
+    }
+
+    void falloff(const Falloff pFalloff) {
+        mFalloff = pFalloff;
+    }
+
+    /* number of octree nodes built in the last step */
+    size_t nodes() const {
+        return mNodes.size();
+    }
+
+    void apply(float pDeltaTime, Physics& pParticleSystem) override;
+
+    bool dead() const override {
+        return mDead;
+    }
+
+    void dead(const bool pDead) override {
+        mDead = pDead;
+    }
+
+    bool active() const override {
+        return mActive;
+    }
+
+    void active(const bool pActiveState) override {
+        mActive = pActiveState;
+    }
+
+    long ID() const override {
+        return mID;
+    }
+
+    static MutualGravity* make() {
+        return new MutualGravity();
+    }
+
+private:
+    uint32_t build(uint32_t pBegin, uint32_t pEnd, uint32_t pDepth);
+
+    template<Falloff F>
+    void interact(const PVector& pPosition, const PVector& pCenter, float pMass, PVector& pForce) const;
+
+    template<Falloff F>
+    PVector attraction(uint32_t pParticle) const;
+};
@@ -0,0 +1,162 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+class ObjectPoolBase {
+public:
+    virtual ~ObjectPoolBase() = default;
+
+    /* destroys the object whose storage contains `pAddress` and recycles its slot. returns false if the pool does not own the address. */
+    virtual bool   release(const void* pAddress) = 0;
+    virtual bool   owns(const void* pAddress) const = 0;
+    virtual size_t size() const                     = 0;
+    virtual size_t capacity() const                 = 0;
+    virtual size_t footprint() const                = 0;
+};
+
+/*
+ * arena of fixed size chunks for objects of type `T`. objects are constructed in place and the slots of released
+ * objects are recycled by subsequent calls to `make()`. the address of any base class subobject can be used to
+ * release an object, which allows to release objects through `Particle*`, `Force*` or `Constraint*` pointers.
+ */
+template<typename T, size_t CHUNK_SIZE = 1024>
+class ObjectPool final : public ObjectPoolBase {
+    struct Slot {
+        alignas(T) unsigned char mData[sizeof(T)];
+    };
+
+    std::vector<Slot*>                         mChunks;
+    std::vector<std::pair<uintptr_t, size_t>>  mChunkRanges; // chunk start address and chunk index, sorted by address
+    std::vector<bool>                          mAlive;
+    std::vector<uint32_t>                      mFree;
+    size_t                                     mSize = 0;
+
+public:
+    ObjectPool() = default;
+
+    ObjectPool(const ObjectPool&)            = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() override {
+        for (size_t i = 0; i < mAlive.size(); ++i) {
+            if (mAlive[i]) {
+                object(static_cast<uint32_t>(i))->~T();
+            }
+        }
+        for (const auto& c: mChunks) {
+            delete[] c;
+        }
+    }
+
+    template<typename... Args>
+    T* make(Args&&... pArgs) {
+        if (mFree.empty()) {
+            grow();
+        }
+        const uint32_t mIndex  = mFree.back();
+        T*             mObject = new (object(mIndex)) T(std::forward<Args>(pArgs)...);
+        mFree.pop_back();
+        mAlive[mIndex] = true;
+        ++mSize;
+        return mObject;
+    }
+
+    bool release(const void* pAddress) override {
+        const uint32_t mIndex = find(pAddress);
+        if (mIndex == UINT32_MAX || !mAlive[mIndex]) {
+            return false;
+        }
+        object(mIndex)->~T();
+        mAlive[mIndex] = false;
+        mFree.push_back(mIndex);
+        --mSize;
+        return true;
+    }
+
+    bool owns(const void* pAddress) const override {
+        const uint32_t mIndex = find(pAddress);
+        return mIndex != UINT32_MAX && mAlive[mIndex];
+    }
+
+    void reserve(const size_t pCapacity) {
+        while (capacity() < pCapacity) {
+            grow();
+        }
+    }
+
+    size_t size() const override {
+        return mSize;
+    }
+
+    size_t capacity() const override {
+        return mChunks.size() * CHUNK_SIZE;
+    }
+
+    size_t footprint() const override {
+        return capacity() * sizeof(Slot) +
+               mChunks.capacity() * sizeof(Slot*) +
+               mChunkRanges.capacity() * sizeof(std::pair<uintptr_t, size_t>) +
+               mAlive.capacity() / 8 +
+               mFree.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    T* object(const uint32_t pIndex) const {
+        return reinterpret_cast<T*>(mChunks[pIndex / CHUNK_SIZE][pIndex % CHUNK_SIZE].mData);
+    }
+
+    uint32_t find(const void* pAddress) const {
+        const auto mAddress = reinterpret_cast<uintptr_t>(pAddress);
+        auto       it       = std::upper_bound(mChunkRanges.begin(), mChunkRanges.end(), mAddress,
+                                               [](const uintptr_t a, const std::pair<uintptr_t, size_t>& b) { return a < b.first; });
+        if (it == mChunkRanges.begin()) {
+            return UINT32_MAX;
+        }
+        --it;
+        const uintptr_t mOffset = mAddress - it->first;
+        if (mOffset >= CHUNK_SIZE * sizeof(Slot)) {
+            return UINT32_MAX;
+        }
+        return static_cast<uint32_t>(it->second * CHUNK_SIZE + mOffset / sizeof(Slot));
+    }
+
+    void grow() {
+        const size_t mChunk = mChunks.size();
+        const auto   mSlots = new Slot[CHUNK_SIZE];
+        mChunks.push_back(mSlots);
+        const std::pair<uintptr_t, size_t> mRange(reinterpret_cast<uintptr_t>(mSlots), mChunk);
+        mChunkRanges.insert(std::upper_bound(mChunkRanges.begin(), mChunkRanges.end(), mRange), mRange);
+        mAlive.resize(capacity(), false);
+        /* hand out slots in ascending order */
+        for (size_t i = CHUNK_SIZE; i > 0; --i) {
+            mFree.push_back(static_cast<uint32_t>(mChunk * CHUNK_SIZE + i - 1));
+        }
+    }
+};
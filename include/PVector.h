@@ -75,20 +75,29 @@ namespace umgebung {
             z = v.z;
         }
 
+        // Generator behind random2D and random3D, seeded from the clock unless seeded with randomSeed
+        static std::default_random_engine& random_generator() {
+            static std::default_random_engine generator(static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count()));
+            return generator;
+        }
+
+        // Seed the generator behind random2D and random3D to make their sequence reproducible
+        static void randomSeed(const unsigned seed) {
+            random_generator().seed(seed);
+        }
+
         // Make a new 2D unit vector with a random direction
         static PVector random2D() {
-            static std::default_random_engine            generator(static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count()));
-            static std::uniform_real_distribution<float> distribution(0.0, 1.0);
-            const auto                                   angle = static_cast<float>(distribution(generator) * 2 * M_PI);
+            std::uniform_real_distribution<float> distribution(0.0, 1.0);
+            const auto                            angle = static_cast<float>(distribution(random_generator()) * 2 * M_PI);
             return {(cos(angle)), (sin(angle))};
         }
 
         // Make a new 3D unit vector with a random direction
         static PVector random3D() {
-            static std::default_random_engine            generator(static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count()));
-            static std::uniform_real_distribution<float> distribution(0.0, 1.0);
-            const auto                                   angle1 = static_cast<float>(distribution(generator) * 2 * M_PI);
-            const auto                                   angle2 = static_cast<float>(distribution(generator) * 2 * M_PI);
+            std::uniform_real_distribution<float> distribution(0.0, 1.0);
+            const auto                            angle1 = static_cast<float>(distribution(random_generator()) * 2 * M_PI);
+            const auto                            angle2 = static_cast<float>(distribution(random_generator()) * 2 * M_PI);
             return {cos(angle1) * sin(angle2), sin(angle1) * sin(angle2), (cos(angle2))};
         }
 
@@ -51,4 +51,8 @@ public:
     virtual bool     still() const                            = 0;
     virtual void     still(bool pStill)                       = 0;
     virtual long     ID() const                               = 0;
+
+    /* only particles in a `ParticleStore` fall asleep ( see `Physics::useSleeping()` ) */
+    virtual bool sleeping() const { return false; }
+    virtual void wake() {}
 };
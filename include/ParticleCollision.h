@@ -0,0 +1,106 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "PVector.h"
+#include "Constraint.h"
+#include "SpatialHashGrid.h"
+
+class Physics;
+class Particle;
+
+using namespace umgebung;
+
+/*
+ * resolves overlaps between particles with a radius greater than zero. candidate pairs are found with a
+ * `SpatialHashGrid` broadphase, overlaps are then pushed apart in proportion to the inverse masses of both
+ * particles. the approaching part of the relative velocity is reflected with the coefficient of restitution as
+ * in `Util::reflect`. with a `Verlet` integrator the old positions are corrected, otherwise the velocities.
+ */
+class ParticleCollision final : public Constraint {
+    bool                               mActive = true;
+    float                              mCoefficientOfRestitution;
+    size_t                             mContacts = 0;
+    bool                               mDead     = false;
+    long                               mID;
+    int                                mIterations;
+    SpatialHashGrid                    mGrid;
+    std::vector<Particle*>             mCandidates;
+    std::vector<SpatialHashGrid::Pair> mPairs;
+    std::vector<float>                 mRadii;
+    std::vector<float>                 mInverseMasses;
+    std::vector<PVector>               mPositions;
+    std::vector<PVector>               mVelocities;
+    std::vector<uint8_t>               mTouched;
+
+public:
+    ParticleCollision();
+
+    void coefficientofrestitution(const float pCoefficientOfRestitution) {
+        mCoefficientOfRestitution = pCoefficientOfRestitution;
+    }
+
+    float coefficientofrestitution() const {
+        return mCoefficientOfRestitution;
+    }
+
+    /* number of relaxation passes over all colliding pairs per step */
+    void iterations(const int pIterations) {
+        mIterations = pIterations;
+    }
+
+    int iterations() const {
+        return mIterations;
+    }
+
+    /* number of overlapping pairs found in the last step */
+    size_t contacts() const {
+        return mContacts;
+    }
+
+    void apply(Physics& pParticleSystem) override;
+
+    bool active() const override {
+        return mActive;
+    }
+
+    void active(const bool pActiveState) override {
+        mActive = pActiveState;
+    }
+
+    bool dead() const override {
+        return mDead;
+    }
+
+    void dead(const bool pDead) override {
+        mDead = pDead;
+    }
+
+    long ID() const override {
+        return mID;
+    }
+};
@@ -0,0 +1,81 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "Particle.h"
+#include "ParticleStore.h"
+#include "PVector.h"
+
+using namespace umgebung;
+
+/*
+ * proxy that exposes a slot of a `ParticleStore` through the `Particle` interface. handles are created and kept
+ * up to date by the store. once a particle is removed from its store the handle is detached and reports itself
+ * as dead until the next step starts, it is then reused for new particles. all other fields of a detached
+ * handle must not be accessed anymore.
+ */
+class ParticleHandle final : public Particle {
+    ParticleStore* mStore;
+    uint32_t       mIndex;
+
+public:
+    ParticleHandle(ParticleStore* pStore, const uint32_t pIndex)
+        : mStore(pStore),
+          mIndex(pIndex) {}
+
+    uint32_t       index() const { return mIndex; }
+    void           index(const uint32_t pIndex) { mIndex = pIndex; }
+    bool           attached() const { return mIndex != ParticleStore::INVALID_INDEX; }
+    ParticleStore* store() const { return mStore; }
+
+    bool     fixed() const override { return mStore->flag(mIndex, ParticleStore::FIXED); }
+    void     fixed(const bool pFixed) override { mStore->flag(mIndex, ParticleStore::FIXED, pFixed); }
+    float    age() const override { return mStore->age(mIndex); }
+    void     age(const float pAge) override { mStore->age(mIndex, pAge); }
+    float    mass() const override { return mStore->mass(mIndex); }
+    void     mass(const float pMass) override { mStore->mass(mIndex, pMass); }
+    PVector& old_position() override { return mStore->old_position(mIndex); }
+    PVector& position() override { return mStore->position(mIndex); }
+    void     setPositionRef(const PVector& pPosition) override { mStore->position(mIndex) = pPosition; }
+    PVector& velocity() override { return mStore->velocity(mIndex); }
+    PVector& force() override { return mStore->force(mIndex); }
+    bool     dead() const override { return !attached() || mStore->flag(mIndex, ParticleStore::DEAD | ParticleStore::REMOVED); }
+    void     dead(const bool pDead) override { mStore->flag(mIndex, ParticleStore::DEAD, pDead); }
+    bool     tagged() const override { return mStore->flag(mIndex, ParticleStore::TAGGED); }
+    void     tag(const bool pTag) override { mStore->flag(mIndex, ParticleStore::TAGGED, pTag); }
+    float    radius() const override { return mStore->radius(mIndex); }
+    void     radius(const float pRadius) override { mStore->radius(mIndex, pRadius); }
+    bool     still() const override { return mStore->flag(mIndex, ParticleStore::STILL); }
+    void     still(const bool pStill) override { mStore->flag(mIndex, ParticleStore::STILL, pStill); }
+    long     ID() const override { return mStore->ID(mIndex); }
+    bool     sleeping() const override { return attached() && mStore->sleeping(mIndex); }
+    void     wake() override {
+        if (attached()) {
+            mStore->wake(mIndex);
+        }
+    }
+    void     accumulateInnerForce(float /* pDeltaTime */) override {}
+};
@@ -0,0 +1,237 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PVector.h"
+
+using namespace umgebung;
+
+class ParticleHandle;
+
+/*
+ * structure-of-arrays storage for particles. every particle field lives in its own contiguous array so that
+ * integrators and forces can run tight loops over the data. particles are exposed to the `Particle*` API through
+ * lightweight `ParticleHandle`s that refer to a slot in the store. slots are kept in creation order; removing
+ * particles compacts the arrays in a single stable pass and updates the slot indices of the affected handles.
+ * handles of removed particles stay detached until `recycle()` is called and are then reused for new particles, so a
+ * pointer to a removed particle may alias a new one. `Physics::handle()` issues generational handles that detect
+ * stale access.
+ */
+class ParticleStore {
+public:
+    static constexpr uint8_t  FIXED         = 1 << 0;
+    static constexpr uint8_t  DEAD          = 1 << 1;
+    static constexpr uint8_t  TAGGED        = 1 << 2;
+    static constexpr uint8_t  STILL         = 1 << 3;
+    static constexpr uint8_t  REMOVED       = 1 << 4;
+    /* set and cleared through `sleep()` and `wake()` only, so that the number of sleeping particles stays valid */
+    static constexpr uint8_t  SLEEPING      = 1 << 5;
+    /* particles connected by springs while `Physics::useIslands()` is enabled, they sleep and wake with their island */
+    static constexpr uint8_t  ISLAND        = 1 << 6;
+    /* particles that integrators and particle forces leave untouched */
+    static constexpr uint8_t  IMMOVABLE     = FIXED | SLEEPING;
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+private:
+    std::vector<PVector>         mPositions;
+    std::vector<PVector>         mOldPositions;
+    std::vector<PVector>         mVelocities;
+    std::vector<PVector>         mForces;
+    std::vector<float>           mMasses;
+    std::vector<float>           mInverseMasses;
+    std::vector<float>           mAges;
+    std::vector<float>           mRadii;
+    std::vector<float>           mRestTimes;
+    std::vector<uint8_t>         mFlags;
+    std::vector<long>            mIDs;
+    std::vector<ParticleHandle*> mHandles;
+    std::vector<ParticleHandle*> mDetachedHandles;
+    std::vector<ParticleHandle*> mFreeHandles;
+    std::vector<uint32_t>        mAwake;
+    std::vector<uint32_t>        mAwakeSlots;
+    uint64_t                     mRevision = 0;
+    uint64_t                     mWakes    = 0;
+    size_t                       mSleeping = 0;
+
+public:
+    /* particle fields as separate arrays, used to add particles in bulk with `append()` */
+    struct Columns {
+        const PVector* positions;
+        const PVector* old_positions;
+        const PVector* velocities;
+        const PVector* forces;
+        const float*   masses;
+        const float*   ages;
+        const float*   radii;
+        const float*   rest_times;
+        const uint8_t* flags;
+        const int64_t* ids;
+    };
+
+    ParticleStore() = default;
+    ~ParticleStore();
+
+    ParticleStore(const ParticleStore&)            = delete;
+    ParticleStore& operator=(const ParticleStore&) = delete;
+
+    ParticleHandle* make();
+
+    /*
+     * adds `pCount` particles with the fields of `pColumns` in one pass and returns the slot of the first one. only
+     * the flags `FIXED`, `DEAD`, `TAGGED`, `STILL` and `SLEEPING` are taken over.
+     */
+    uint32_t append(size_t pCount, const Columns& pColumns);
+
+    void reserve(size_t pCapacity);
+
+    /* makes the handles of removed particles available for reuse by `make()` */
+    void recycle();
+
+    /* memory held by the store in bytes */
+    size_t footprint() const;
+
+    /* removes the particle in slot `pIndex` while preserving the order of all other slots */
+    void remove(uint32_t pIndex);
+
+    /* removes all particles flagged as dead in a single stable pass. returns the number of removed particles. */
+    size_t removeDead() {
+        return removeFlagged(DEAD);
+    }
+
+    /* removes all particles with any of the flags in `pFlags` in a single stable pass */
+    size_t removeFlagged(uint8_t pFlags);
+
+    /* handles removed since the last call to `recycle()` */
+    const std::vector<ParticleHandle*>& detached() const { return mDetachedHandles; }
+
+    /* incremented whenever particles are removed and slot indices change */
+    uint64_t revision() const { return mRevision; }
+
+    size_t size() const { return mPositions.size(); }
+    bool   empty() const { return mPositions.empty(); }
+
+    PVector*               positions() { return mPositions.data(); }
+    PVector*               old_positions() { return mOldPositions.data(); }
+    PVector*               velocities() { return mVelocities.data(); }
+    PVector*               forces() { return mForces.data(); }
+    const float*           masses() const { return mMasses.data(); }
+    const float*           inverse_masses() const { return mInverseMasses.data(); }
+    float*                 ages() { return mAges.data(); }
+    float*                 radii() { return mRadii.data(); }
+    const uint8_t*         flags() const { return mFlags.data(); }
+    const long*            ids() const { return mIDs.data(); }
+    const float*           rest_times() const { return mRestTimes.data(); }
+    ParticleHandle* const* handles() const { return mHandles.data(); }
+
+    PVector& position(const uint32_t i) { return mPositions[i]; }
+    PVector& old_position(const uint32_t i) { return mOldPositions[i]; }
+    PVector& velocity(const uint32_t i) { return mVelocities[i]; }
+    PVector& force(const uint32_t i) { return mForces[i]; }
+    float    age(const uint32_t i) const { return mAges[i]; }
+    void     age(const uint32_t i, const float pAge) { mAges[i] = pAge; }
+    float    radius(const uint32_t i) const { return mRadii[i]; }
+    void     radius(const uint32_t i, const float pRadius) { mRadii[i] = pRadius; }
+    long     ID(const uint32_t i) const { return mIDs[i]; }
+    float    mass(const uint32_t i) const { return mMasses[i]; }
+
+    void mass(const uint32_t i, const float pMass) {
+        mMasses[i]        = pMass;
+        mInverseMasses[i] = 1.0f / pMass;
+    }
+
+    bool flag(const uint32_t i, const uint8_t pFlag) const {
+        return (mFlags[i] & pFlag) != 0;
+    }
+
+    void flag(const uint32_t i, const uint8_t pFlag, const bool pState) {
+        if (pState) {
+            mFlags[i] |= pFlag;
+        } else {
+            mFlags[i] &= static_cast<uint8_t>(~pFlag);
+        }
+    }
+
+    bool fixed(const uint32_t i) const {
+        return (mFlags[i] & FIXED) != 0;
+    }
+
+    bool immovable(const uint32_t i) const {
+        return (mFlags[i] & IMMOVABLE) != 0;
+    }
+
+    /* sleeping */
+
+    bool sleeping(const uint32_t i) const {
+        return (mFlags[i] & SLEEPING) != 0;
+    }
+
+    /* puts a movable particle to sleep and clears its velocity */
+    void sleep(uint32_t i);
+
+    void wake(uint32_t i);
+
+    void wakeAll();
+
+    /* number of sleeping particles, kept up to date by `sleep()`, `wake()` and removals */
+    size_t sleeping_count() const { return mSleeping; }
+
+    /* incremented whenever sleeping particles are woken up */
+    uint64_t wakes() const { return mWakes; }
+
+    /*
+     * slots of all particles that are not sleeping in no particular order. the list is updated by `sleep()` and
+     * `wake()` and only rebuilt when particles are removed.
+     */
+    const uint32_t* awake() const { return mAwake.data(); }
+    size_t          awake_count() const { return mAwake.size(); }
+
+    /* calls `pFunction(i)` for every slot that is not sleeping, visits the awake list only while particles sleep */
+    template<typename F>
+    void forEachAwake(F&& pFunction) const {
+        if (mSleeping == 0) {
+            const auto mSize = static_cast<uint32_t>(size());
+            for (uint32_t i = 0; i < mSize; ++i) {
+                pFunction(i);
+            }
+        } else {
+            for (const uint32_t i: mAwake) {
+                pFunction(i);
+            }
+        }
+    }
+
+    /* time a particle has been resting, see `Physics::useSleeping()` */
+    float rest_time(const uint32_t i) const { return mRestTimes[i]; }
+    void  rest_time(const uint32_t i, const float pRestTime) { mRestTimes[i] = pRestTime; }
+
+private:
+    void move(uint32_t pFrom, uint32_t pTo);
+    void truncate(size_t pSize);
+    void rebuildAwake();
+    /* reuses a recycled handle or creates a new one */
+    ParticleHandle* acquireHandle(uint32_t pIndex);
+};
@@ -23,68 +23,258 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "Particle.h"
 #include "Force.h"
+#include "FusedForces.h"
+#include "ParticleForce.h"
 #include "Constraint.h"
 #include "Integrator.h"
 #include "BasicParticle.h"
+#include "Handle.h"
+#include "ObjectPool.h"
+#include "ParticleStore.h"
+#include "PhysicsConfig.h"
+#include "ParticleHandle.h"
 #include "PVector.h"
+#include "Replay.h"
 #include "Spring.h"
+#include "SpringSystem.h"
+#include "SpringColoring.h"
+#include "SpringIndex.h"
+#include "SpringIslands.h"
+#include "SpatialHashGrid.h"
+#include "ThreadPool.h"
 
 using namespace umgebung;
 
 class Physics {
 public:
-    static bool            VERBOSE;
-    static constexpr float EPSILON = 0.001f;
-    static bool            HINT_UPDATE_OLD_POSITION;
-    static long            oID;
+    static bool              VERBOSE;
+    static constexpr float   EPSILON = 0.001f;
+    static bool              HINT_UPDATE_OLD_POSITION;
+    static std::atomic<long> oID;
 
     bool HINT_OPTIMIZE_STILL                      = true;
     bool HINT_RECOVER_NAN                         = true;
     bool HINT_REMOVE_DEAD                         = true;
     bool HINT_SET_VELOCITY_FROM_PREVIOUS_POSITION = true;
+    /* when applying forces on multiple threads, accumulate spring forces in the same order as a single thread would */
+    bool HINT_DETERMINISTIC_REDUCTION = false;
+    /* when applying forces on multiple threads, apply springs in batches of springs that share no particle */
+    bool HINT_COLOR_SPRINGS = true;
+    /* evaluate consecutive built-in particle forces on the particle store in one pass ( see `FusedForces` ) */
+    bool HINT_FUSE_PARTICLE_FORCES = true;
+
+    /* minimum number of particles or springs per thread when applying forces in parallel */
+    static constexpr size_t PARALLEL_GRAIN_SIZE = 1024;
+    /* number of particles consecutive particle forces are applied to before moving on, the block of `FusedForces` */
+    static constexpr size_t PARTICLE_FORCE_BLOCK_SIZE = FusedForces::BLOCK_SIZE;
 
 private:
     std::vector<Constraint*> mConstraints;
     std::vector<Force*>      mForces;
     std::vector<Particle*>   mParticles;
     Integrator*              mIntegrator;
+    bool                     mOwnsIntegrator;
+    ParticleStore            mStore;
+    bool                     mUseParticleStore = false;
+    float                    mDeltaTime        = 0.0f;
+    float                    mFixedTimeStep    = 1.0f / 60.0f;
+    int                      mMaxSubsteps      = 8;
+    float                    mAccumulator      = 0.0f;
+    std::vector<long>        mPreviousIDs;
+    std::vector<PVector>     mPreviousPositions;
+    bool                     mUseSleeping    = false;
+    float                    mSleepThreshold = 1.0f;
+    float                    mWakeThreshold  = 2.0f;
+    float                    mSleepDelay     = 0.5f;
+
+    std::unordered_map<std::type_index, std::unique_ptr<ObjectPoolBase>> mPools;
+
+    HandleTable<Particle>   mParticleHandles;
+    HandleTable<Force>      mForceHandles;
+    HandleTable<Constraint> mConstraintHandles;
+    SpringIndex             mSpringIndex;
+
+    std::unique_ptr<SpatialHashGrid> mSpatialHashGrid;
+    bool                             mSpatialHashGridValid = false;
+
+    /* objects removed via `remove()` are dropped and released in a single pass during the next step */
+    std::vector<const Particle*>    mRemovedParticles;
+    std::vector<const Force*>       mRemovedForces;
+    std::vector<const Constraint*>  mRemovedConstraints;
+    std::unordered_set<const void*> mRemovedSet;
+    /*
+     * particles passed to `remove()` that are released or detached from the store during the next step. forces and
+     * constraints connected to them are dropped first, whether `HINT_REMOVE_DEAD` is set or not.
+     */
+    std::unordered_set<const Particle*> mReleasedParticles;
+
+    struct SpringContribution {
+        static constexpr uint8_t ADD_A       = 1 << 0;
+        static constexpr uint8_t SUB_B       = 1 << 1;
+        static constexpr uint8_t ADD_B       = 1 << 2;
+        static constexpr uint8_t ACCUMULATED = 1 << 3;
+
+        const Spring* spring = nullptr;
+        Particle*     a      = nullptr;
+        Particle*     b      = nullptr;
+        uint32_t      ia     = ParticleStore::INVALID_INDEX;
+        uint32_t      ib     = ParticleStore::INVALID_INDEX;
+        /* `ParticleStore::revision()` when `ia` and `ib` were looked up */
+        uint64_t      revision = 0;
+        PVector       force;
+        uint8_t       targets = 0;
+    };
+
+    std::unique_ptr<ThreadPool>       mThreadPool;
+    std::vector<ParticleForce*>       mParticleForceBatch;
+    FusedForces                       mFusedForces;
+    bool                              mFusedForcesValid = false;
+    std::vector<Spring*>              mSpringBatch;
+    std::vector<SpringContribution>   mSpringContributions;
+    std::vector<std::vector<PVector>> mThreadForces;
+    SpringColoring                    mSpringColoring;
+    bool                              mSpringColoringValid = false;
+    std::vector<std::vector<Spring*>> mStaleColoredSprings;
+    SpringIslands                     mIslands;
+    bool                              mUseIslands = false;
+    /* `ParticleStore::wakes()` when the sleeping islands were last updated */
+    uint64_t                          mIslandWakes = 0;
+    std::vector<Particle*>            mDetachedIslandParticles;
+    ReplayRecorder*                   mReplayRecorder = nullptr;
+
+    /* replays steps with the recorded flags */
+    friend class Replayer;
 
 public:
     Physics();
+    virtual ~Physics();
 
+    Physics(const Physics&)            = delete;
+    Physics& operator=(const Physics&) = delete;
+
+    /* thread-safe, unique across all `Physics` instances */
     static long getUniqueID() {
         return ++oID;
     }
 
-    bool add(Particle* pParticle, const bool pPreventDuplicates = false) {
-        if (pPreventDuplicates) {
-            const auto it = std::find(mParticles.begin(), mParticles.end(), pParticle);
-            if (it != mParticles.end()) {
-                return false;
+    /* handles */
+
+    /*
+     * every particle, force and constraint added to `Physics` is issued a generational handle. handles resolve in
+     * constant time and resolve to `nullptr` once the object is removed, even if its memory is reused.
+     */
+    Handle<Particle> handle(const Particle* pParticle) const {
+        return mParticleHandles.find(pParticle);
+    }
+
+    Handle<Force> handle(const Force* pForce) const {
+        return mForceHandles.find(pForce);
+    }
+
+    Handle<Constraint> handle(const Constraint* pConstraint) const {
+        return mConstraintHandles.find(pConstraint);
+    }
+
+    Particle* get(const Handle<Particle>& pHandle) const {
+        return mParticleHandles.get(pHandle);
+    }
+
+    Force* get(const Handle<Force>& pHandle) const {
+        return mForceHandles.get(pHandle);
+    }
+
+    Constraint* get(const Handle<Constraint>& pHandle) const {
+        return mConstraintHandles.get(pHandle);
+    }
+
+    template<typename T>
+    void remove(const Handle<T>& pHandle) {
+        if (const auto mObject = get(pHandle)) {
+            remove(mObject);
+        }
+    }
+
+    Particle* findParticle(const long pID) const {
+        return mParticleHandles.find(pID);
+    }
+
+    Force* findForce(const long pID) const {
+        return mForceHandles.find(pID);
+    }
+
+    Constraint* findConstraint(const long pID) const {
+        return mConstraintHandles.find(pID);
+    }
+
+    /* object pools */
+
+    /*
+     * particles, springs, forces and constraints created with the `make*` methods are allocated from typed pools
+     * owned by `Physics`. they are destroyed and their slots are recycled once they die or are removed. objects
+     * passed in via `add()` remain owned by the caller.
+     */
+    template<typename T>
+    ObjectPool<T>& pool() {
+        auto& mPool = mPools[std::type_index(typeid(T))];
+        if (mPool == nullptr) {
+            mPool = std::make_unique<ObjectPool<T>>();
+        }
+        return static_cast<ObjectPool<T>&>(*mPool);
+    }
+
+    /* returns true if the object was created by one of the `make*` methods and is still alive */
+    bool owns(const void* pObject) const {
+        for (const auto& p: mPools) {
+            if (p.second->owns(pObject)) {
+                return true;
             }
         }
+        return false;
+    }
+
+    /* memory held by the particle store and all object pools in bytes */
+    size_t footprint() const;
+
+    bool add(Particle* pParticle, const bool pPreventDuplicates = false) {
+        if (pPreventDuplicates && mParticleHandles.contains(pParticle)) {
+            return false;
+        }
         mParticles.push_back(pParticle);
+        particleAdded(pParticle);
         return true;
     }
 
     void add(Particle* pParticle) {
         mParticles.push_back(pParticle);
+        particleAdded(pParticle);
     }
 
     void add(const std::vector<Particle*>& pParticles) {
         mParticles.insert(mParticles.end(), pParticles.begin(), pParticles.end());
+        for (const auto& p: pParticles) {
+            particleAdded(p);
+        }
     }
 
-    void remove(Particle* pParticle) {
-        mParticles.erase(std::remove(mParticles.begin(), mParticles.end(), pParticle), mParticles.end());
-    }
+    /* removal is deferred, the particle remains in `particles()` until the next step */
+    void remove(Particle* pParticle);
 
     void remove(const std::vector<Particle*>& pParticles) {
+        mRemovedParticles.reserve(mRemovedParticles.size() + pParticles.size());
         for (const auto& p: pParticles) {
             remove(p);
         }
@@ -98,40 +288,185 @@ public:
         return mParticles.at(pIndex);
     }
 
-    BasicParticle* makeParticle() {
-        const auto mParticle = new BasicParticle();
+    /* threading */
+
+    /*
+     * number of threads used to apply forces. forces implementing `ParticleForce` are split into particle ranges,
+     * consecutive springs are evaluated in parallel. with `HINT_DETERMINISTIC_REDUCTION` spring forces are
+     * accumulated in spring order ( or island by island with `useIslands()` ) and results match a single threaded
+     * run bit for bit, otherwise they are accumulated in per-thread buffers which are reduced afterwards. with
+     * `HINT_COLOR_SPRINGS` all springs are instead applied color by color from a cached graph coloring ( see
+     * `SpringColoring` ), which needs neither buffers nor atomics. `0` selects the number of hardware threads.
+     */
+    void threads(size_t pThreads);
+
+    size_t threads() const {
+        return mThreadPool == nullptr ? 1 : mThreadPool->threads();
+    }
+
+    /* returns the thread pool or `nullptr` if physics runs on a single thread */
+    ThreadPool* threadpool() const {
+        return mThreadPool.get();
+    }
+
+    /* cached coloring of all springs, valid while physics runs on multiple threads with `HINT_COLOR_SPRINGS` */
+    const SpringColoring& spring_coloring() const {
+        return mSpringColoring;
+    }
+
+    /* particle store */
+
+    /*
+     * when enabled particles created with `makeParticle()` are kept in a structure-of-arrays `ParticleStore` and
+     * exposed as `ParticleHandle`s. integrators and built-in forces run tight loops over the store as long as all
+     * particles in the system live in it ( see `packed()` ).
+     */
+    void useParticleStore(const bool pUseParticleStore) {
+        mUseParticleStore = pUseParticleStore;
+    }
+
+    bool usesParticleStore() const {
+        return mUseParticleStore;
+    }
+
+    ParticleStore& store() {
+        return mStore;
+    }
+
+    /* returns the particle store if every particle of the system lives in it ( in the same order ), `nullptr` otherwise */
+    ParticleStore* packed() {
+        return mStore.size() == mParticles.size() ? &mStore : nullptr;
+    }
+
+    /* spatial hash grid */
+
+    /*
+     * when enabled a `SpatialHashGrid` over all particles answers radius, nearest neighbor and pair queries. the
+     * grid is rebuilt on first use after particles were added or moved by a step. `pCellSize` should be close to
+     * the typical query radius.
+     */
+    void useSpatialHashGrid(bool pUseSpatialHashGrid, float pCellSize = 10.0f);
+
+    bool usesSpatialHashGrid() const {
+        return mSpatialHashGrid != nullptr;
+    }
+
+    /* returns the up-to-date grid or `nullptr` if the spatial hash grid is disabled */
+    SpatialHashGrid* spatial_hash_grid();
+
+    /* sleeping */
+
+    /*
+     * when enabled particles in the particle store that move slower than `sleep_threshold()` for `sleep_delay()`
+     * seconds fall asleep. integrators and particle forces skip sleeping particles, springs between two sleeping
+     * particles are skipped. a sleeping particle wakes up once the forces on it would change its velocity by more
+     * than `wake_threshold()` in one step, once its velocity is changed ( e.g. by a collision ) or when
+     * `Particle::wake()` is called, which should follow any edit of its position. adding a particle force wakes all
+     * particles, adding a spring wakes its end points. after changing the parameters of a force call
+     * `store().wakeAll()`. sleep and wake are decided in the pass over all particles that runs every step anyway,
+     * integrators and fused particle forces only visit `ParticleStore::awake()` while particles sleep. sleeping
+     * requires `HINT_OPTIMIZE_STILL` and a packed system ( see `packed()` ), otherwise all particles are kept awake.
+     */
+    void useSleeping(const bool pUseSleeping) {
+        mUseSleeping = pUseSleeping;
+    }
+
+    bool usesSleeping() const {
+        return mUseSleeping;
+    }
+
+    float sleep_threshold() const {
+        return mSleepThreshold;
+    }
+
+    void sleep_threshold(const float pSleepThreshold) {
+        mSleepThreshold = pSleepThreshold;
+    }
+
+    float wake_threshold() const {
+        return mWakeThreshold;
+    }
+
+    void wake_threshold(const float pWakeThreshold) {
+        mWakeThreshold = pWakeThreshold;
+    }
+
+    float sleep_delay() const {
+        return mSleepDelay;
+    }
+
+    void sleep_delay(const float pSleepDelay) {
+        mSleepDelay = pSleepDelay;
+    }
+
+    /* islands */
+
+    /*
+     * when enabled physics keeps track of the connected components of its spring network ( see `SpringIslands` ).
+     * on multiple threads all springs are then applied island by island, each island by one thread, instead of
+     * color by color ( see `HINT_COLOR_SPRINGS` ). as long as one island holds more than `1 / threads()` of all
+     * springs it would keep one thread busy while the others idle, springs are then still applied color by color
+     * unless `HINT_COLOR_SPRINGS` is disabled or `HINT_DETERMINISTIC_REDUCTION` is set, which always applies springs
+     * island by island like a single thread does. with sleeping enabled the particles of an island fall asleep once
+     * all of them are at rest and all of them wake up as soon as one of them wakes up.
+     */
+    void useIslands(bool pUseIslands);
+
+    bool usesIslands() const {
+        return mUseIslands;
+    }
+
+    /* returns the up-to-date islands, empty unless islands are enabled */
+    const SpringIslands& islands() {
+        mIslands.update();
+        return mIslands;
+    }
+
+    /*
+     * `makeParticle()` and its overloads return `Particle*` instead of `BasicParticle*` since the particle is a
+     * `ParticleHandle` while the particle store is enabled. code that relies on a `BasicParticle*` should call
+     * `makeParticle<BasicParticle>()`, which always returns a pooled `BasicParticle`.
+     */
+    Particle* makeParticle() {
+        Particle* mParticle;
+        if (mUseParticleStore) {
+            mParticle = mStore.make();
+        } else {
+            mParticle = pool<BasicParticle>().make();
+        }
         mParticles.push_back(mParticle);
+        particleAdded(mParticle);
         return mParticle;
     }
 
-    BasicParticle* makeParticle(const PVector& pPosition) {
+    Particle* makeParticle(const PVector& pPosition) {
         const auto mParticle = makeParticle();
         mParticle->setPositionRef(pPosition);
         mParticle->old_position() = mParticle->position();
         return mParticle;
     }
 
-    BasicParticle* makeParticle(const float x, const float y) {
+    Particle* makeParticle(const float x, const float y) {
         const auto mParticle = makeParticle();
         mParticle->position().set(x, y);
         mParticle->old_position() = mParticle->position();
         return mParticle;
     }
 
-    BasicParticle* makeParticle(const float x, const float y, const float z) {
+    Particle* makeParticle(const float x, const float y, const float z) {
         const auto mParticle = makeParticle();
         mParticle->position().set(x, y, z);
         mParticle->old_position() = mParticle->position();
         return mParticle;
     }
 
-    BasicParticle* makeParticle(const float x, const float y, const float z, const float pMass) {
+    Particle* makeParticle(const float x, const float y, const float z, const float pMass) {
         const auto mParticle = makeParticle(x, y, z);
         mParticle->mass(pMass);
         return mParticle;
     }
 
-    BasicParticle* makeParticle(const PVector& pPosition, const float pMass) {
+    Particle* makeParticle(const PVector& pPosition, const float pMass) {
         const auto mParticle = makeParticle(pPosition);
         mParticle->mass(pMass);
         return mParticle;
@@ -139,11 +474,20 @@ public:
 
     template<typename T>
     T* makeParticle() {
-        auto mParticle = new T();
+        auto mParticle = pool<T>().make();
         mParticles.push_back(mParticle);
+        particleAdded(mParticle);
         return mParticle;
     }
 
+    /*
+     * adds `pCount` particles with the fields of `pColumns` to the particle store in one pass ( see
+     * `ParticleStore::append` ) and returns the index of the first of them in `particles()`. the particles keep their
+     * IDs if none of them can collide with an ID issued before ( e.g. when a snapshot is loaded into a new process ),
+     * later IDs are issued above them. otherwise all of them are issued new IDs.
+     */
+    size_t appendParticles(size_t pCount, const ParticleStore::Columns& pColumns);
+
     void removeTags() const {
         for (const auto& p: mParticles) {
             p->tag(false);
@@ -153,28 +497,47 @@ public:
     /* force management */
 
     bool add(Spring* pSpring, const bool pPreventDuplicates = false) {
-        if (pPreventDuplicates) {
-            for (const auto& f: mForces) {
-                auto s = dynamic_cast<Spring*>(f);
-                if (s && (s == pSpring || (s->a() == pSpring->a() && s->b() == pSpring->b()) || (s->b() == pSpring->a() && s->a() == pSpring->b()))) {
-                    return false;
-                }
-            }
+        if (pPreventDuplicates && (mForceHandles.contains(pSpring) || findSpring(pSpring->a(), pSpring->b()) != nullptr)) {
+            return false;
         }
         mForces.push_back(pSpring);
+        forceAdded(pSpring);
         return true;
     }
 
     void add(Force* pForce) {
         mForces.push_back(pForce);
+        forceAdded(pForce);
+    }
+
+    /* returns a spring connecting `pA` and `pB` in either direction or `nullptr` */
+    Spring* findSpring(const Particle* pA, const Particle* pB) const {
+        return mSpringIndex.find(pA, pB);
     }
 
     void addForces(std::vector<Force*>& pForces) {
-        mForces.insert(mForces.end(), pForces.begin(), pForces.end());
+        for (const auto& f: pForces) {
+            add(f);
+        }
     }
 
+    /* removal is deferred, the force remains in `forces()` until the next step */
     void remove(Force* pForce) {
-        mForces.erase(std::remove(mForces.begin(), mForces.end(), pForce), mForces.end());
+        if (mReplayRecorder != nullptr) {
+            mReplayRecorder->removed(pForce);
+        }
+        if (const auto mSpring = dynamic_cast<Spring*>(pForce)) {
+            springRemoved(mSpring);
+        }
+        mForceHandles.erase(pForce);
+        mRemovedForces.push_back(pForce);
+    }
+
+    void remove(const std::vector<Force*>& pForces) {
+        mRemovedForces.reserve(mRemovedForces.size() + pForces.size());
+        for (const auto& f: pForces) {
+            remove(f);
+        }
     }
 
     const std::vector<Force*>& forces() const {
@@ -185,26 +548,15 @@ public:
         return mForces.at(pIndex);
     }
 
-    void applyForces(const float pDeltaTime) {
-        for (const auto& p: mParticles) {
-            if (!p->fixed()) {
-                p->accumulateInnerForce(pDeltaTime);
-            }
-        }
-
-        for (const auto& f: mForces) {
-            if (f->active()) {
-                f->apply(pDeltaTime, *this);
-            }
-        }
-    }
+    void applyForces(float pDeltaTime);
 
     template<typename T>
     T* makeForce() {
         T* mForce;
         try {
-            mForce = new T();
+            mForce = pool<T>().make();
             mForces.push_back(mForce);
+            forceAdded(mForce);
         } catch (const std::exception& ex) {
             (void) ex;
             mForce = nullptr;
@@ -213,39 +565,83 @@ public:
     }
 
     Spring* makeSpring(Particle* pA, Particle* pB) {
-        const auto mSpring = new Spring(pA, pB);
+        const auto mSpring = pool<Spring>().make(pA, pB);
         mForces.push_back(mSpring);
+        forceAdded(mSpring);
         return mSpring;
     }
 
     Spring* makeSpring(Particle* pA, Particle* pB, float pRestLength) {
-        const auto mSpring = new Spring(pA, pB, pRestLength);
+        const auto mSpring = pool<Spring>().make(pA, pB, pRestLength);
         mForces.push_back(mSpring);
+        forceAdded(mSpring);
         return mSpring;
     }
 
     Spring* makeSpring(Particle* pA, Particle* pB, float pSpringConstant, float pSpringDamping) {
-        const auto mSpring = new Spring(pA, pB, pSpringConstant, pSpringDamping);
+        const auto mSpring = pool<Spring>().make(pA, pB, pSpringConstant, pSpringDamping);
         mForces.push_back(mSpring);
+        forceAdded(mSpring);
         return mSpring;
     }
 
     Spring* makeSpring(Particle* pA, Particle* pB, float pSpringConstant, float pSpringDamping, float pRestLength) {
-        const auto mSpring = new Spring(pA, pB, pSpringConstant, pSpringDamping, pRestLength);
+        const auto mSpring = pool<Spring>().make(pA, pB, pSpringConstant, pSpringDamping, pRestLength);
         mForces.push_back(mSpring);
+        forceAdded(mSpring);
         return mSpring;
     }
 
+    /* springs created in a `SpringSystem` are evaluated in one batched pass. returns the index of the spring in the system. */
+    uint32_t makeSpring(SpringSystem* pSpringSystem, Particle* pA, Particle* pB) {
+        return pSpringSystem->make(pA, pB);
+    }
+
+    uint32_t makeSpring(SpringSystem* pSpringSystem, Particle* pA, Particle* pB, float pRestLength) {
+        return pSpringSystem->make(pA, pB, pRestLength);
+    }
+
+    uint32_t makeSpring(SpringSystem* pSpringSystem, Particle* pA, Particle* pB, float pSpringConstant, float pSpringDamping) {
+        return pSpringSystem->make(pA, pB, pSpringConstant, pSpringDamping);
+    }
+
+    uint32_t makeSpring(SpringSystem* pSpringSystem, Particle* pA, Particle* pB, float pSpringConstant, float pSpringDamping, float pRestLength) {
+        return pSpringSystem->make(pA, pB, pSpringConstant, pSpringDamping, pRestLength);
+    }
+
+    template<typename T>
+    T* makeConstraint() {
+        T* mConstraint;
+        try {
+            mConstraint = pool<T>().make();
+            mConstraints.push_back(mConstraint);
+            constraintAdded(mConstraint);
+        } catch (const std::exception& ex) {
+            (void) ex;
+            mConstraint = nullptr;
+        }
+        return mConstraint;
+    }
+
     void add(Constraint* pConstraint) {
         mConstraints.push_back(pConstraint);
+        constraintAdded(pConstraint);
     }
 
     void addConstraints(const std::vector<Constraint*>& pConstraints) {
         mConstraints.insert(mConstraints.end(), pConstraints.begin(), pConstraints.end());
+        for (const auto& c: pConstraints) {
+            constraintAdded(c);
+        }
     }
 
+    /* removal is deferred, the constraint remains in `constraints()` until the next step */
     void remove(const Constraint* pConstraint) {
-        mConstraints.erase(std::remove(mConstraints.begin(), mConstraints.end(), pConstraint), mConstraints.end());
+        if (mReplayRecorder != nullptr) {
+            mReplayRecorder->removed(pConstraint);
+        }
+        mConstraintHandles.erase(pConstraint);
+        mRemovedConstraints.push_back(pConstraint);
     }
 
     const std::vector<Constraint*>& constraints() const {
@@ -256,17 +652,26 @@ public:
         return mConstraints.at(pIndex);
     }
 
+    /* sets an integrator that remains owned by the caller */
     void setIntegratorRef(Integrator* pIntegrator) {
-        mIntegrator = pIntegrator;
+        if (mOwnsIntegrator) {
+            delete mIntegrator;
+        }
+        mIntegrator     = pIntegrator;
+        mOwnsIntegrator = false;
     }
 
     Integrator* getIntegrator() const {
         return mIntegrator;
     }
 
+    /* sets an integrator that is owned and eventually deleted by `Physics` */
     void replace_integrator(Integrator* pIntegrator) {
-        delete mIntegrator;
-        mIntegrator = pIntegrator;
+        if (mOwnsIntegrator) {
+            delete mIntegrator;
+        }
+        mIntegrator     = pIntegrator;
+        mOwnsIntegrator = true;
     }
 
     void step(const float pDeltaTime, const int pIterations) {
@@ -276,16 +681,236 @@ public:
     }
 
     void step(const float pDeltaTime) {
-        handleForces();
-        mIntegrator->step(pDeltaTime, *this);
-        handleParticles(pDeltaTime);
-        handleConstraints();
-        postHandleParticles(pDeltaTime);
+        advanceStep(pDeltaTime, hints());
+    }
+
+    /*
+     * steps with the flags of the configuration `C` ( see `PhysicsConfig` ) instead of the `HINT_*` members. the
+     * `finishStep` instantiation for the flags is called directly, the integrator through `integrator()`.
+     */
+    template<typename C>
+    void step(const float pDeltaTime) {
+        advance(pDeltaTime, *mIntegrator, C::FLAGS, [this](const float pStepDeltaTime) { finishStep<C::FLAGS>(pStepDeltaTime); });
+    }
+
+    /* duration of the step in progress, constraints use it to turn position corrections into velocities */
+    float delta_time() const {
+        return mDeltaTime;
+    }
+
+    /* fixed timestep */
+
+    /*
+     * `update` decouples the simulation rate from the render rate: the elapsed wall time is accumulated and consumed
+     * in steps of `fixed_timestep()`. at most `max_substeps()` steps run per call, time beyond that is dropped so a
+     * slow frame can not cause ever longer frames. the remainder is exposed as `alpha()` to interpolate particle
+     * positions between the last two steps for rendering.
+     */
+    int update(const float pElapsedTime) {
+        return accumulate(pElapsedTime, [this](const float pDeltaTime) { step(pDeltaTime); });
+    }
+
+    float fixed_timestep() const {
+        return mFixedTimeStep;
+    }
+
+    void fixed_timestep(const float pFixedTimeStep) {
+        mFixedTimeStep = pFixedTimeStep;
+    }
+
+    int max_substeps() const {
+        return mMaxSubsteps;
+    }
+
+    void max_substeps(const int pMaxSubsteps) {
+        mMaxSubsteps = pMaxSubsteps;
+    }
+
+    /* time accumulated but not yet simulated, always less than one fixed timestep after `update` */
+    float accumulator() const {
+        return mAccumulator;
+    }
+
+    void accumulator(const float pAccumulator) {
+        mAccumulator = pAccumulator;
+    }
+
+    /* fraction of a fixed timestep between the last simulated state and the current time, in [0, 1) */
+    float alpha() const {
+        return mFixedTimeStep > 0.0f ? mAccumulator / mFixedTimeStep : 0.0f;
+    }
+
+    /* position of the particle `particles()[i]` interpolated with `alpha()` between the last two steps */
+    PVector interpolated_position(size_t i) const;
+
+    /* interpolated positions of all particles in the order of `particles()` */
+    void interpolate(std::vector<PVector>& pPositions) const;
+
+    /* replay */
+
+    /* the recorder logging this system ( see `ReplayRecorder` ), set by the recorder itself */
+    void replay_recorder(ReplayRecorder* pReplayRecorder) {
+        mReplayRecorder = pReplayRecorder;
+    }
+
+    ReplayRecorder* replay_recorder() const {
+        return mReplayRecorder;
+    }
+
+protected:
+    /* `HINT_*` members as `PhysicsFlags` bits, `step()` runs with them and `step<C>()` with `C::FLAGS` instead */
+    uint8_t hints() const {
+        return (HINT_REMOVE_DEAD ? PhysicsFlags::FLAG_REMOVE_DEAD : 0) |
+               (HINT_RECOVER_NAN ? PhysicsFlags::FLAG_RECOVER_NAN : 0) |
+               (HINT_OPTIMIZE_STILL ? PhysicsFlags::FLAG_OPTIMIZE_STILL : 0) |
+               (HINT_SET_VELOCITY_FROM_PREVIOUS_POSITION ? PhysicsFlags::FLAG_SET_VELOCITY_FROM_PREVIOUS_POSITION : 0) |
+               (HINT_UPDATE_OLD_POSITION ? PhysicsFlags::FLAG_UPDATE_OLD_POSITION : 0);
+    }
+
+    /* runs as many steps of `fixed_timestep()` with `pStep` as `pElapsedTime` allows ( see `update` ) */
+    template<typename S>
+    int accumulate(const float pElapsedTime, S&& pStep) {
+        if (mFixedTimeStep <= 0.0f) {
+            return 0;
+        }
+        mAccumulator += std::max(pElapsedTime, 0.0f);
+        const int mSteps = static_cast<int>(std::min(mAccumulator / mFixedTimeStep, static_cast<float>(std::max(mMaxSubsteps, 0))));
+        for (int i = 0; i < mSteps; ++i) {
+            if (i == mSteps - 1) {
+                capturePreviousPositions();
+            }
+            pStep(mFixedTimeStep);
+            mAccumulator -= mFixedTimeStep;
+        }
+        /* spiral of death: drop what could not be simulated within `max_substeps()` */
+        if (mAccumulator >= mFixedTimeStep) {
+            mAccumulator = std::fmod(mAccumulator, mFixedTimeStep);
+        }
+        return mSteps;
+    }
+
+    /* advances the system by one step with the current integrator, all `step` and `update` variants end up here */
+    virtual void advanceStep(const float pDeltaTime, const uint8_t pFlags) {
+        advance(pDeltaTime, *mIntegrator, pFlags);
+    }
+
+    /* advances the system by one step with `pIntegrator`, a concrete integrator type dispatches statically */
+    template<typename I>
+    void advance(const float pDeltaTime, I& pIntegrator, const uint8_t pFlags) {
+        advance(pDeltaTime, pIntegrator, pFlags, [this, pFlags](const float pStepDeltaTime) { finishStep(pStepDeltaTime, pFlags); });
+    }
+
+    /* as above, `pFinish` runs everything after integration ( see `finishStep` ) */
+    template<typename I, typename F>
+    void advance(const float pDeltaTime, I& pIntegrator, const uint8_t pFlags, F pFinish) {
+        const bool mRemoveDead = pFlags & PhysicsFlags::FLAG_REMOVE_DEAD;
+        mDeltaTime             = pDeltaTime;
+        if (mReplayRecorder != nullptr) {
+            mReplayRecorder->stepping(pDeltaTime, pFlags);
+        }
+        beginStep(mRemoveDead);
+        handleForces(mRemoveDead);
+        removeDeadParticles(mRemoveDead);
+        pIntegrator.step(pDeltaTime, *this);
+        mSpatialHashGridValid = false;
+        pFinish(pDeltaTime);
+        mSpatialHashGridValid = false;
+        if (mReplayRecorder != nullptr) {
+            mReplayRecorder->stepped();
+        }
+    }
+
+    /* true if `pParticle` is released or detached from the store during the current or next step */
+    bool released(const Particle* pParticle) const {
+        return mReleasedParticles.count(pParticle) > 0;
+    }
+
+    bool connected(const Particle* pA, const Particle* pB) const {
+        return !mReleasedParticles.empty() && (released(pA) || released(pB));
+    }
+
+    /* true if `pForce` is a spring connected to a particle that is released */
+    bool connected(Force* pForce) const;
+
+    /* called by `advance` before removed and dead objects are dropped ( see `TypedPhysics` ) */
+    virtual void beginStep(bool /* pRemoveDead */) {}
+
+    /* registers a spring that is not part of `forces()` with `findSpring` */
+    void indexSpring(Spring* pSpring) {
+        mSpringIndex.add(pSpring);
+    }
+
+    void unindexSpring(const Spring* pSpring) {
+        mSpringIndex.remove(pSpring);
+    }
+
+    /* called by `applyForces` before the forces of the force list are applied ( see `TypedPhysics` ) */
+    virtual void applyTypedForces(float pDeltaTime) {
+        (void) pDeltaTime;
+    }
+
+    /* called before the constraints of the constraint list are applied */
+    virtual void applyTypedConstraints() {}
+
+    virtual bool hasTypedConstraints() const {
+        return false;
     }
 
 private:
-    void handleForces();
+    void particleAdded(Particle* pParticle) {
+        mParticleHandles.insert(pParticle);
+        mSpatialHashGridValid = false;
+        if (mReplayRecorder != nullptr) {
+            mReplayRecorder->added(pParticle);
+        }
+    }
+
+    void constraintAdded(Constraint* pConstraint) {
+        mConstraintHandles.insert(pConstraint);
+        if (mReplayRecorder != nullptr) {
+            mReplayRecorder->added(pConstraint);
+        }
+    }
+
+    void handleForces(bool pRemoveDead);
+    void removeDeadParticles(bool pRemoveDead);
+    template<typename T>
+    void collectRemoved(std::vector<const T*>& pRemoved);
+    /* collects the consecutive active particle forces starting at `pIndex` and advances `pIndex` past them */
+    bool collectParticleForces(size_t& pIndex);
+    void applyParticleForces(float pDeltaTime);
+    void applyParticleForces(float pDeltaTime, size_t pBegin, size_t pEnd);
+    void applySprings();
+    void applyColoredSprings(float pDeltaTime);
+    void applyIslandSprings(float pDeltaTime);
+    /* true if no island holds more than its share of `1 / threads()` of all springs */
+    bool balancedIslands();
+    /* puts islands to sleep or wakes them as a whole */
+    void updateSleepingIslands();
+    /* marks `pParticle` as member of an island if it lives in the particle store */
+    void islandMember(Particle* pParticle, bool pMember);
+    void forceAdded(Force* pForce);
+    void springAdded(Spring* pSpring);
+    void springRemoved(const Spring* pSpring);
+    void release(const void* pObject);
+    /* positions before the last step of `accumulate`, the base of `interpolated_position` */
+    void capturePreviousPositions();
+    /* runs everything after integration, dispatches to the `finishStep` instantiation for `pFlags` */
+    void finishStep(float pDeltaTime, uint8_t pFlags);
+    template<uint8_t FLAGS>
+    void finishStep(float pDeltaTime);
+    template<size_t... FLAGS>
+    static constexpr std::array<void (Physics::*)(float), sizeof...(FLAGS)> finishSteps(std::index_sequence<FLAGS...>) {
+        return {&Physics::finishStep<FLAGS>...};
+    }
+    template<uint8_t FLAGS>
     void handleParticles(float pDeltaTime);
-    void handleConstraints();
-    void postHandleParticles(float pDeltaTime) const;
+    template<uint8_t FLAGS>
+    void handleParticles(ParticleStore& pStore, float pDeltaTime);
+    void handleConstraints(bool pRemoveDead);
+    template<uint8_t FLAGS>
+    void postHandleParticles(float pDeltaTime);
+    /* `handleParticles` and `postHandleParticles` in one pass, valid if no constraint runs in between */
+    template<uint8_t FLAGS>
+    void handleParticlesFused(float pDeltaTime);
 };
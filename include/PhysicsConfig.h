@@ -0,0 +1,58 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+/* flag bits of a step, shared by `PhysicsConfig` and the `HINT_*` members ( see `Physics::hints()` ) */
+struct PhysicsFlags {
+    static constexpr uint8_t FLAG_REMOVE_DEAD                         = 1 << 0;
+    static constexpr uint8_t FLAG_RECOVER_NAN                         = 1 << 1;
+    static constexpr uint8_t FLAG_OPTIMIZE_STILL                      = 1 << 2;
+    static constexpr uint8_t FLAG_SET_VELOCITY_FROM_PREVIOUS_POSITION = 1 << 3;
+    static constexpr uint8_t FLAG_UPDATE_OLD_POSITION                 = 1 << 4;
+    static constexpr uint8_t NUM_FLAGS                                = 5;
+};
+
+/*
+ * compile time configuration of `Physics::step<C>()`. every flag replaces the `HINT_*` member of the same name,
+ * the per-particle loops of the step are instantiated for exactly this combination and contain no branches for
+ * disabled features.
+ *
+ *     using FastConfig = PhysicsConfig<true, false, false, true, true>;
+ *     mPhysics.step<FastConfig>(pDeltaTime);
+ */
+template<bool REMOVE_DEAD                         = true,
+         bool RECOVER_NAN                         = true,
+         bool OPTIMIZE_STILL                      = true,
+         bool SET_VELOCITY_FROM_PREVIOUS_POSITION = true,
+         bool UPDATE_OLD_POSITION                 = true>
+struct PhysicsConfig {
+    static constexpr uint8_t FLAGS = (REMOVE_DEAD ? PhysicsFlags::FLAG_REMOVE_DEAD : 0) |
+                                     (RECOVER_NAN ? PhysicsFlags::FLAG_RECOVER_NAN : 0) |
+                                     (OPTIMIZE_STILL ? PhysicsFlags::FLAG_OPTIMIZE_STILL : 0) |
+                                     (SET_VELOCITY_FROM_PREVIOUS_POSITION ? PhysicsFlags::FLAG_SET_VELOCITY_FROM_PREVIOUS_POSITION : 0) |
+                                     (UPDATE_OLD_POSITION ? PhysicsFlags::FLAG_UPDATE_OLD_POSITION : 0);
+};
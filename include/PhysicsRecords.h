@@ -0,0 +1,151 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "PVector.h"
+
+class Physics;
+class Particle;
+class Force;
+class Constraint;
+class Integrator;
+
+using namespace umgebung;
+
+/*
+ * fixed size records of the forces, constraints, integrator and settings of a `Physics` system as written by
+ * `Snapshot` and `ReplayRecorder`. records are zero initialized and have no implicit padding, so they can be
+ * written and compared byte for byte. springs, `Gravity`, `Attractor`, `ViscousDrag`, `Box`, `Teleporter` and the
+ * built-in integrators are matched by their exact type, derived types are not captured. springs refer to their
+ * particles by indices that are assigned and resolved by the caller.
+ */
+class PhysicsRecords {
+public:
+    static constexpr uint32_t NO_PARTICLE = UINT32_MAX;
+
+    enum ForceType : uint32_t {
+        FORCE_SPRING = 1,
+        FORCE_GRAVITY,
+        FORCE_ATTRACTOR,
+        FORCE_VISCOUS_DRAG
+    };
+
+    enum ConstraintType : uint32_t {
+        CONSTRAINT_BOX = 1,
+        CONSTRAINT_TELEPORTER
+    };
+
+    enum IntegratorType : uint32_t {
+        INTEGRATOR_OTHER = 0,
+        INTEGRATOR_MIDPOINT,
+        INTEGRATOR_RUNGE_KUTTA,
+        INTEGRATOR_VERLET,
+        INTEGRATOR_DORMAND_PRINCE,
+        INTEGRATOR_IMPLICIT_EULER
+    };
+
+    struct ForceRecord {
+        uint32_t type;
+        uint32_t a;
+        uint32_t b;
+        PVector  vector;
+        float    rest_length;
+        float    strength;
+        float    damping;
+        float    radius;
+        uint8_t  active;
+        uint8_t  dead;
+        uint8_t  oneway;
+        uint8_t  reserved;
+    };
+
+    struct ConstraintRecord {
+        uint32_t type;
+        PVector  min;
+        PVector  max;
+        float    restitution;
+        uint8_t  active;
+        uint8_t  dead;
+        uint8_t  reflect;
+        uint8_t  teleport;
+    };
+
+    struct IntegratorRecord {
+        uint32_t type;
+        int32_t  iterations;
+        float    damping;
+        float    tolerance;
+        float    min_step;
+        float    max_step;
+        float    safety;
+        float    substep;
+    };
+
+    struct SettingsRecord {
+        uint8_t  optimize_still;
+        uint8_t  recover_nan;
+        uint8_t  remove_dead;
+        uint8_t  velocity_from_previous_position;
+        uint8_t  deterministic_reduction;
+        uint8_t  color_springs;
+        uint8_t  fuse_particle_forces;
+        uint8_t  particle_store;
+        uint8_t  sleeping;
+        uint8_t  islands;
+        uint8_t  reserved[2];
+        float    sleep_threshold;
+        float    wake_threshold;
+        float    sleep_delay;
+        float    fixed_timestep;
+        float    accumulator;
+        int32_t  max_substeps;
+        uint32_t threads;
+    };
+
+    /* fills `pRecord` except for the particles of a spring, returns false if the type of `pForce` is not recorded */
+    static bool capture(Force* pForce, ForceRecord& pRecord);
+
+    /* creates the force of `pRecord` in `pPhysics`, springs connect `pA` and `pB`. returns `nullptr` if it can not be created */
+    static Force* make(Physics& pPhysics, const ForceRecord& pRecord, Particle* pA = nullptr, Particle* pB = nullptr);
+
+    /* applies `pRecord` to a force of its type, springs are moved to `pA` and `pB` unless these are `nullptr` */
+    static void apply(Force* pForce, const ForceRecord& pRecord, Particle* pA = nullptr, Particle* pB = nullptr);
+
+    static bool        capture(Constraint* pConstraint, ConstraintRecord& pRecord);
+    static Constraint* make(Physics& pPhysics, const ConstraintRecord& pRecord);
+    static void        apply(Constraint* pConstraint, const ConstraintRecord& pRecord);
+
+    /* integrators other than the built-in ones are captured as `INTEGRATOR_OTHER` */
+    static void capture(Integrator* pIntegrator, IntegratorRecord& pRecord);
+
+    /* creates the integrator of `pRecord`, `nullptr` for `INTEGRATOR_OTHER` */
+    static Integrator* make(const IntegratorRecord& pRecord);
+
+    static void capture(Physics& pPhysics, SettingsRecord& pRecord);
+
+    /* applies all settings except for the number of threads, which is up to the caller */
+    static void apply(Physics& pPhysics, const SettingsRecord& pRecord);
+};
@@ -0,0 +1,275 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "PhysicsRecords.h"
+#include "PVector.h"
+
+class Physics;
+class Particle;
+class Force;
+class Constraint;
+class Integrator;
+
+using namespace umgebung;
+
+/*
+ * objects of one kind in the order they were added to a recorded or replayed session. recorder and replayer refer
+ * to an object by its index, which stays valid for the whole session.
+ */
+template<typename T>
+class ReplayTable {
+public:
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+private:
+    std::vector<T*>                        mObjects;
+    std::unordered_map<const T*, uint32_t> mIndices;
+
+public:
+    uint32_t add(T* pObject) {
+        const auto mIndex = static_cast<uint32_t>(mObjects.size());
+        mObjects.push_back(pObject);
+        mIndices[pObject] = mIndex;
+        return mIndex;
+    }
+
+    void erase(const uint32_t pIndex) {
+        if (pIndex < mObjects.size() && mObjects[pIndex] != nullptr) {
+            mIndices.erase(mObjects[pIndex]);
+            mObjects[pIndex] = nullptr;
+        }
+    }
+
+    T* get(const uint32_t pIndex) const {
+        return pIndex < mObjects.size() ? mObjects[pIndex] : nullptr;
+    }
+
+    uint32_t find(const T* pObject) const {
+        const auto it = mIndices.find(pObject);
+        return it == mIndices.end() ? INVALID_INDEX : it->second;
+    }
+
+    size_t size() const {
+        return mObjects.size();
+    }
+
+    /* calls `pVisit(index, object)` for the objects of `pObjects` in the table and drops those no longer in it */
+    template<typename F>
+    void update(const std::vector<T*>& pObjects, F&& pVisit) {
+        size_t mFound = 0;
+        for (const auto& o: pObjects) {
+            const uint32_t mIndex = find(o);
+            if (mIndex != INVALID_INDEX) {
+                pVisit(mIndex, o);
+                ++mFound;
+            }
+        }
+        if (mFound != mIndices.size()) {
+            const std::unordered_set<const T*> mPresent(pObjects.begin(), pObjects.end());
+            for (auto it = mIndices.begin(); it != mIndices.end();) {
+                if (mPresent.count(it->first) == 0) {
+                    mObjects[it->second] = nullptr;
+                    it                   = mIndices.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+};
+
+/*
+ * logs a session of `Physics` so that `Replayer` can reproduce it bit for bit. the recorder attaches itself to the
+ * system, logs the objects it finds as additions and from then on every addition, removal and step with the number
+ * of the step it precedes. changes made to objects, the settings or the integrator in between steps are found by
+ * comparing them to their state after the last step, which costs a pass over all objects per step.
+ * `PVector::random2D/3D` are seeded with the seed of the session.
+ *
+ * particles, springs, `Gravity`, `Attractor`, `ViscousDrag`, `Box` and `Teleporter` are recorded, other forces and
+ * constraints as well as the typed objects of `TypedPhysics` are not. particles outside of the particle store are
+ * replayed as `BasicParticle`. results depend on the number of threads, the replay runs with the recorded number.
+ */
+class ReplayRecorder {
+public:
+    static constexpr uint32_t VERSION = 2;
+
+    enum EventType : uint32_t {
+        EVENT_SETTINGS = 1,
+        EVENT_INTEGRATOR,
+        EVENT_ADD_PARTICLE,
+        EVENT_ADD_FORCE,
+        EVENT_ADD_CONSTRAINT,
+        EVENT_SET_PARTICLE,
+        EVENT_SET_FORCE,
+        EVENT_SET_CONSTRAINT,
+        EVENT_REMOVE_PARTICLE,
+        EVENT_REMOVE_FORCE,
+        EVENT_REMOVE_CONSTRAINT,
+        EVENT_STEP,
+        NUM_EVENT_TYPES
+    };
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t seed;
+        uint32_t reserved;
+    };
+
+    /* precedes the record of every event, `step` is the number of the step the event is applied before */
+    struct Event {
+        uint32_t type;
+        uint32_t index;
+        uint64_t step;
+    };
+
+    struct ParticleRecord {
+        PVector position;
+        PVector old_position;
+        PVector velocity;
+        PVector force;
+        float   mass;
+        float   age;
+        float   radius;
+        float   rest_time;
+        uint8_t flags;
+        uint8_t stored;
+        uint8_t reserved[2];
+    };
+
+    /* springs refer to their particles by the indices of the session */
+    using ForceRecord      = PhysicsRecords::ForceRecord;
+    using ConstraintRecord = PhysicsRecords::ConstraintRecord;
+    using IntegratorRecord = PhysicsRecords::IntegratorRecord;
+    using SettingsRecord   = PhysicsRecords::SettingsRecord;
+
+    struct StepRecord {
+        float    delta_time;
+        uint32_t flags;
+    };
+
+    /* size of the record following an event of type `pType` */
+    static size_t record_size(uint32_t pType);
+
+private:
+    Physics&                      mPhysics;
+    std::FILE*                    mFile;
+    const uint32_t                mSeed;
+    uint64_t                      mSteps    = 0;
+    uint64_t                      mEvents   = 0;
+    bool                          mGood     = false;
+    bool                          mStepping = false;
+    ReplayTable<Particle>         mParticles;
+    ReplayTable<Force>            mForces;
+    ReplayTable<Constraint>       mConstraints;
+    std::vector<ParticleRecord>   mParticleStates;
+    std::vector<ForceRecord>      mForceStates;
+    std::vector<ConstraintRecord> mConstraintStates;
+    SettingsRecord                mSettings{};
+    IntegratorRecord              mIntegratorState{};
+    const Integrator*             mIntegrator = nullptr;
+
+public:
+    /* starts logging `pPhysics` to `pFilePath` and seeds `PVector::random2D/3D` with `pSeed` */
+    ReplayRecorder(Physics& pPhysics, const std::string& pFilePath, uint32_t pSeed = 0);
+    ~ReplayRecorder();
+
+    ReplayRecorder(const ReplayRecorder&)            = delete;
+    ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+    /* detaches from the system and closes the file, called by the destructor */
+    void close();
+
+    /* false if the file could not be opened or a write failed */
+    bool good() const { return mGood; }
+
+    uint32_t seed() const { return mSeed; }
+    uint64_t steps() const { return mSteps; }
+    uint64_t events() const { return mEvents; }
+
+    /* called by `Physics` */
+    void added(Particle* pParticle);
+    void added(Force* pForce);
+    void added(Constraint* pConstraint);
+    void removed(const Particle* pParticle);
+    void removed(const Force* pForce);
+    void removed(const Constraint* pConstraint);
+    void stepping(float pDeltaTime, uint8_t pFlags);
+    void stepped();
+
+private:
+    void write(uint32_t pType, uint32_t pIndex, const void* pRecord);
+    void capture(Particle* pParticle, ParticleRecord& pRecord) const;
+    bool capture(Force* pForce, ForceRecord& pRecord) const;
+    /* logs the settings if they changed since they were last logged */
+    void settings();
+};
+
+/*
+ * reproduces a session logged by `ReplayRecorder` on a system that is empty when the replay starts. steps run as
+ * fast as they can be computed, independent of the durations they were recorded with.
+ */
+class Replayer {
+    std::FILE*              mFile = nullptr;
+    uint32_t                mSeed = 0;
+    uint64_t                mStep = 0;
+    ReplayTable<Particle>   mParticles;
+    ReplayTable<Force>      mForces;
+    ReplayTable<Constraint> mConstraints;
+
+public:
+    /* opens the session at `pFilePath` and seeds `PVector::random2D/3D` with its seed */
+    explicit Replayer(const std::string& pFilePath);
+    ~Replayer();
+
+    Replayer(const Replayer&)            = delete;
+    Replayer& operator=(const Replayer&) = delete;
+
+    /* false if the file could not be opened or holds no session */
+    bool good() const { return mFile != nullptr; }
+
+    uint32_t seed() const { return mSeed; }
+
+    /* number of steps replayed so far */
+    uint64_t steps() const { return mStep; }
+
+    /* applies the events logged before the next step to `pPhysics` and runs the step, false at the end of the session */
+    bool next(Physics& pPhysics);
+
+    /* replays all remaining steps and returns their number */
+    uint64_t run(Physics& pPhysics);
+
+private:
+    void apply(Physics& pPhysics, const ReplayRecorder::Event& pEvent, const uint8_t* pRecord);
+    static void apply(Particle* pParticle, const ReplayRecorder::ParticleRecord& pRecord);
+};
@@ -29,7 +29,7 @@
 #include "Physics.h"
 #include "IntegrationUtil.h"
 
-class RungeKutta : public Integrator {
+class RungeKutta final : public Integrator {
     std::vector<PVector> mK1Forces;
     std::vector<PVector> mK1Velocities;
     std::vector<PVector> mK2Forces;
@@ -57,8 +57,13 @@ public:
         IntegrationUtil::checkContainerSize(mSize, mK4Forces);
         IntegrationUtil::checkContainerSize(mSize, mK4Velocities);
 
+        if (ParticleStore* mStore = pParticleSystem.packed()) {
+            step(pDeltaTime, pParticleSystem, *mStore);
+            return;
+        }
+
         // Save original positions and velocities
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 mOriginalPositions[i].set(mParticle->position());
@@ -70,7 +75,7 @@ public:
         pParticleSystem.applyForces(pDeltaTime);
 
         // Save intermediate forces (k1)
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 mK1Forces[i].set(mParticle->force());
@@ -79,7 +84,7 @@ public:
         }
 
         // Get k2 values
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 const PVector& originalPosition = mOriginalPositions[i];
@@ -101,7 +106,7 @@ public:
         pParticleSystem.applyForces(pDeltaTime);
 
         // Save intermediate forces (k2)
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 mK2Forces[i].set(mParticle->force());
@@ -110,7 +115,7 @@ public:
         }
 
         // Get k3 values
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 const PVector& originalPosition = mOriginalPositions[i];
@@ -132,7 +137,7 @@ public:
         pParticleSystem.applyForces(pDeltaTime);
 
         // Save intermediate forces (k3)
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 mK3Forces[i].set(mParticle->force());
@@ -141,7 +146,7 @@ public:
         }
 
         // Get k4 values
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 const PVector& originalPosition = mOriginalPositions[i];
@@ -163,7 +168,7 @@ public:
         pParticleSystem.applyForces(pDeltaTime);
 
         // Save intermediate forces (k4)
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 mK4Forces[i].set(mParticle->force());
@@ -172,7 +177,7 @@ public:
         }
 
         // Final integration step
-        for (int i = 0; i < pParticleSystem.particles().size(); ++i) {
+        for (size_t i = 0; i < pParticleSystem.particles().size(); ++i) {
             Particle* mParticle = pParticleSystem.particles()[i];
             if (!mParticle->fixed()) {
                 // Update position
@@ -199,4 +204,74 @@ public:
             }
         }
     }
+
+private:
+    /* moves every free and awake particle to `original + k * pScale` in position and velocity */
+    void evaluate(ParticleStore&              pStore,
+                  const std::vector<PVector>& pVelocities,
+                  const std::vector<PVector>& pForces,
+                  const float                 pScale) const {
+        PVector*     mPositions  = pStore.positions();
+        PVector*     mVelocities = pStore.velocities();
+        const float* mMasses     = pStore.masses();
+        pStore.forEachAwake([&](const uint32_t i) {
+            if (!pStore.fixed(i)) {
+                mPositions[i].x  = mOriginalPositions[i].x + pVelocities[i].x * pScale;
+                mPositions[i].y  = mOriginalPositions[i].y + pVelocities[i].y * pScale;
+                mPositions[i].z  = mOriginalPositions[i].z + pVelocities[i].z * pScale;
+                mVelocities[i].x = mOriginalVelocities[i].x + pForces[i].x * pScale / mMasses[i];
+                mVelocities[i].y = mOriginalVelocities[i].y + pForces[i].y * pScale / mMasses[i];
+                mVelocities[i].z = mOriginalVelocities[i].z + pForces[i].z * pScale / mMasses[i];
+            }
+        });
+    }
+
+    static void save(const ParticleStore& pStore, const PVector* pSource, std::vector<PVector>& pTarget) {
+        pStore.forEachAwake([&](const uint32_t i) {
+            if (!pStore.fixed(i)) {
+                pTarget[i] = pSource[i];
+            }
+        });
+    }
+
+    void step(const float pDeltaTime, Physics& pParticleSystem, ParticleStore& pStore) {
+        save(pStore, pStore.positions(), mOriginalPositions);
+        save(pStore, pStore.velocities(), mOriginalVelocities);
+
+        pParticleSystem.applyForces(pDeltaTime);
+        save(pStore, pStore.forces(), mK1Forces);
+        save(pStore, pStore.velocities(), mK1Velocities);
+        evaluate(pStore, mK1Velocities, mK1Forces, 0.5f * pDeltaTime);
+
+        pParticleSystem.applyForces(pDeltaTime);
+        save(pStore, pStore.forces(), mK2Forces);
+        save(pStore, pStore.velocities(), mK2Velocities);
+        evaluate(pStore, mK2Velocities, mK2Forces, 0.5f * pDeltaTime);
+
+        pParticleSystem.applyForces(pDeltaTime);
+        save(pStore, pStore.forces(), mK3Forces);
+        save(pStore, pStore.velocities(), mK3Velocities);
+        evaluate(pStore, mK3Velocities, mK3Forces, pDeltaTime);
+
+        pParticleSystem.applyForces(pDeltaTime);
+        save(pStore, pStore.forces(), mK4Forces);
+        save(pStore, pStore.velocities(), mK4Velocities);
+
+        PVector*     mPositions  = pStore.positions();
+        PVector*     mVelocities = pStore.velocities();
+        const float* mMasses     = pStore.masses();
+        pStore.forEachAwake([&](const uint32_t i) {
+            if (!pStore.fixed(i)) {
+                const float mPositionScale = pDeltaTime / 6.0f;
+                mPositions[i].x            = mOriginalPositions[i].x + mPositionScale * (mK1Velocities[i].x + 2.0f * mK2Velocities[i].x + 2.0f * mK3Velocities[i].x + mK4Velocities[i].x);
+                mPositions[i].y            = mOriginalPositions[i].y + mPositionScale * (mK1Velocities[i].y + 2.0f * mK2Velocities[i].y + 2.0f * mK3Velocities[i].y + mK4Velocities[i].y);
+                mPositions[i].z            = mOriginalPositions[i].z + mPositionScale * (mK1Velocities[i].z + 2.0f * mK2Velocities[i].z + 2.0f * mK3Velocities[i].z + mK4Velocities[i].z);
+
+                const float mVelocityScale = pDeltaTime / (6.0f * mMasses[i]);
+                mVelocities[i].x           = mOriginalVelocities[i].x + mVelocityScale * (mK1Forces[i].x + 2.0f * mK2Forces[i].x + 2.0f * mK3Forces[i].x + mK4Forces[i].x);
+                mVelocities[i].y           = mOriginalVelocities[i].y + mVelocityScale * (mK1Forces[i].y + 2.0f * mK2Forces[i].y + 2.0f * mK3Forces[i].y + mK4Forces[i].y);
+                mVelocities[i].z           = mOriginalVelocities[i].z + mVelocityScale * (mK1Forces[i].z + 2.0f * mK2Forces[i].z + 2.0f * mK3Forces[i].z + mK4Forces[i].z);
+            }
+        });
+    }
 };
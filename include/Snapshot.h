@@ -0,0 +1,62 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Physics;
+
+/*
+ * versioned binary checkpoint of a `Physics` world. a snapshot holds all particle fields, springs with references
+ * to their particles, the forces `Gravity`, `Attractor` and `ViscousDrag`, the constraints `Box` and `Teleporter`,
+ * the integrator with its parameters and state as well as the settings of the system. other forces and
+ * constraints, including types derived from the ones above, are skipped.
+ *
+ * a snapshot starts with a header ( magic, version, byte order marker, number of sections ) followed by a table of
+ * sections. every section is an array of fixed size elements aligned to 64 bytes. particles are written as one
+ * section per field in the layout of `ParticleStore`, so a world is loaded by mapping the file into memory and
+ * copying every field in bulk. forces, constraints, the integrator and the settings are stored as
+ * `PhysicsRecords`. readers skip sections of unknown type, snapshots of another version or of a different byte
+ * order are rejected. a loaded world continues bit for bit like the saved one on the same number of threads,
+ * except with islands, which apply springs in an order that depends on the history of the spring network.
+ */
+class Snapshot {
+public:
+    static constexpr uint32_t VERSION = 2;
+
+    /* writes the world of `pPhysics` to `pFilePath`, returns false if the file could not be written */
+    static bool save(Physics& pPhysics, const std::string& pFilePath);
+
+    /*
+     * adds the world stored in `pFilePath` to `pPhysics` and replaces its settings and integrator. particles keep
+     * their saved IDs unless these may collide with IDs issued before ( see `Physics::appendParticles` ). returns
+     * false if the file could not be read or is no valid snapshot, `pPhysics` is left unchanged in that case.
+     */
+    static bool load(Physics& pPhysics, const std::string& pFilePath);
+
+    /* loads a snapshot from `pSize` bytes at `pData` ( see `load` ) */
+    static bool load(Physics& pPhysics, const void* pData, size_t pSize);
+};
@@ -0,0 +1,231 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Particle.h"
+#include "PVector.h"
+
+using namespace umgebung;
+
+class ThreadPool;
+
+/*
+ * uniform grid over hashed cells for neighbor and proximity queries. particles are sorted by cell with a counting
+ * sort, so the particles of a cell are contiguous in memory. queries see the positions at the time of the last
+ * `build()`. different cells may share a hash bucket, queries therefore always test the actual distance.
+ */
+class SpatialHashGrid {
+public:
+    static constexpr size_t PARALLEL_GRAIN_SIZE = 4096;
+
+    /* pair of indices into `particles()` */
+    struct Pair {
+        uint32_t a;
+        uint32_t b;
+    };
+
+private:
+    struct Cell {
+        int32_t x;
+        int32_t y;
+        int32_t z;
+    };
+
+    float                              mCellSize;
+    float                              mInverseCellSize;
+    uint32_t                           mMask = 0;
+    Cell                               mMin{0, 0, 0};
+    Cell                               mMax{-1, -1, -1};
+    std::vector<uint32_t>              mCellStart;
+    std::vector<uint32_t>              mHashes;
+    std::vector<Particle*>             mParticles;
+    std::vector<PVector>               mPositions;
+    std::vector<std::vector<uint32_t>> mCounts;
+    std::vector<Cell>                  mChunkMin;
+    std::vector<Cell>                  mChunkMax;
+    std::vector<std::vector<Pair>>     mChunkPairs;
+
+public:
+    explicit SpatialHashGrid(float pCellSize = 10.0f);
+
+    float cell_size() const {
+        return mCellSize;
+    }
+
+    /* takes effect with the next `build()` */
+    void cell_size(float pCellSize);
+
+    /* sorts `pParticles` into the grid. the counting sort runs on `pThreadPool` if one is passed. */
+    void build(const std::vector<Particle*>& pParticles, ThreadPool* pThreadPool = nullptr);
+
+    void clear();
+
+    size_t size() const {
+        return mParticles.size();
+    }
+
+    bool empty() const {
+        return mParticles.empty();
+    }
+
+    /* particles in cell order */
+    const std::vector<Particle*>& particles() const {
+        return mParticles;
+    }
+
+    /* positions in cell order at the time of the last `build()` */
+    const std::vector<PVector>& positions() const {
+        return mPositions;
+    }
+
+    /* calls `pCallback(Particle*, float pDistanceSquared)` for every particle closer than `pRadius` to `pPosition` */
+    template<typename F>
+    void query(const PVector& pPosition, const float pRadius, F&& pCallback) const {
+        const float mRadiusSquared = pRadius * pRadius;
+        buckets(cell(pPosition, -pRadius), cell(pPosition, pRadius), [&](const uint32_t pBucket) {
+            for (uint32_t i = mCellStart[pBucket]; i < mCellStart[pBucket + 1]; ++i) {
+                const float mDistanceSquared = distanceSquared(pPosition, mPositions[i]);
+                if (mDistanceSquared < mRadiusSquared) {
+                    pCallback(mParticles[i], mDistanceSquared);
+                }
+            }
+        });
+    }
+
+    /* collects all particles closer than `pRadius` to `pPosition` into `pResult`. returns the number of particles found. */
+    size_t query(const PVector& pPosition, float pRadius, std::vector<Particle*>& pResult) const;
+
+    /* returns the particle closest to `pPosition` that is closer than `pMaxRadius` or `nullptr` */
+    Particle* nearest(const PVector& pPosition, float pMaxRadius = std::numeric_limits<float>::max()) const;
+
+    /* calls `pCallback(Particle*, Particle*, float pDistanceSquared)` once for every pair of particles closer than `pRadius` */
+    template<typename F>
+    void pairs(const float pRadius, F&& pCallback) const {
+        const float mRadiusSquared = pRadius * pRadius;
+        for (uint32_t i = 0; i < mPositions.size(); ++i) {
+            const PVector& mPosition = mPositions[i];
+            buckets(cell(mPosition, -pRadius), cell(mPosition, pRadius), [&](const uint32_t pBucket) {
+                for (uint32_t j = std::max(mCellStart[pBucket], i + 1); j < mCellStart[pBucket + 1]; ++j) {
+                    const float mDistanceSquared = distanceSquared(mPosition, mPositions[j]);
+                    if (mDistanceSquared < mRadiusSquared) {
+                        pCallback(mParticles[i], mParticles[j], mDistanceSquared);
+                    }
+                }
+            });
+        }
+    }
+
+    /*
+     * collects all pairs of particles closer than `pRadius` into `pPairs`. the search runs on `pThreadPool` if one
+     * is passed, the order of the pairs does not depend on the number of threads.
+     */
+    void pairs(float pRadius, std::vector<Pair>& pPairs, ThreadPool* pThreadPool = nullptr);
+
+private:
+    static float distanceSquared(const PVector& p0, const PVector& p1) {
+        const float dx = p0.x - p1.x;
+        const float dy = p0.y - p1.y;
+        const float dz = p0.z - p1.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    int32_t coordinate(const float v) const {
+        /* clamped so that far away or NaN positions still map to a valid cell */
+        const float   c = std::max(-1.0e9f, std::min(1.0e9f, v * mInverseCellSize));
+        const int32_t i = static_cast<int32_t>(c);
+        return c < static_cast<float>(i) ? i - 1 : i;
+    }
+
+    Cell cell(const PVector& pPosition, const float pOffset = 0.0f) const {
+        return {coordinate(pPosition.x + pOffset), coordinate(pPosition.y + pOffset), coordinate(pPosition.z + pOffset)};
+    }
+
+    /* neighboring cells along x map to neighboring buckets, which keeps rows of cells close in memory */
+    uint32_t bucket(const int32_t x, const int32_t y, const int32_t z) const {
+        return (static_cast<uint32_t>(x) +
+                static_cast<uint32_t>(y) * 0x9e3779b1u +
+                static_cast<uint32_t>(z) * 0x85ebca77u) &
+               mMask;
+    }
+
+    /* calls `pCallback` once for every bucket that holds cells in `[pMin, pMax]`, clamped to the occupied cells */
+    template<typename F>
+    void buckets(Cell pMin, Cell pMax, F&& pCallback) const {
+        if (mParticles.empty()) {
+            return;
+        }
+        pMin = {std::max(pMin.x, mMin.x), std::max(pMin.y, mMin.y), std::max(pMin.z, mMin.z)};
+        pMax = {std::min(pMax.x, mMax.x), std::min(pMax.y, mMax.y), std::min(pMax.z, mMax.z)};
+        if (pMin.x > pMax.x || pMin.y > pMax.y || pMin.z > pMax.z) {
+            return;
+        }
+        const uint64_t mCells = static_cast<uint64_t>(pMax.x - pMin.x + 1) *
+                                static_cast<uint64_t>(pMax.y - pMin.y + 1) *
+                                static_cast<uint64_t>(pMax.z - pMin.z + 1);
+        if (mCells > mMask) {
+            for (uint32_t b = 0; b <= mMask; ++b) {
+                pCallback(b);
+            }
+            return;
+        }
+        /* cells that share a bucket must not be visited twice */
+        static constexpr size_t MAX_LOCAL_BUCKETS = 64;
+        uint32_t                mLocal[MAX_LOCAL_BUCKETS];
+        std::vector<uint32_t>   mVisited;
+        size_t                  mCount = 0;
+        for (int32_t z = pMin.z; z <= pMax.z; ++z) {
+            for (int32_t y = pMin.y; y <= pMax.y; ++y) {
+                for (int32_t x = pMin.x; x <= pMax.x; ++x) {
+                    const uint32_t b = bucket(x, y, z);
+                    if (mCellStart[b] == mCellStart[b + 1]) {
+                        continue;
+                    }
+                    if (mCells <= MAX_LOCAL_BUCKETS) {
+                        if (std::find(mLocal, mLocal + mCount, b) != mLocal + mCount) {
+                            continue;
+                        }
+                        mLocal[mCount++] = b;
+                        pCallback(b);
+                    } else {
+                        mVisited.push_back(b);
+                    }
+                }
+            }
+        }
+        if (!mVisited.empty()) {
+            std::sort(mVisited.begin(), mVisited.end());
+            mVisited.erase(std::unique(mVisited.begin(), mVisited.end()), mVisited.end());
+            for (const auto& b: mVisited) {
+                pCallback(b);
+            }
+        }
+    }
+};
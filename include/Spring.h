@@ -28,6 +28,8 @@
 #include "Particle.h"
 #include "PVector.h"
 
+class SpringIndex;
+
 class Spring final : public Force, public Connection {
 
     Particle* mA;
@@ -39,6 +41,10 @@ class Spring final : public Force, public Connection {
     float      mSpringConstant;
     float      mSpringDamping;
     const long mID;
+    /* index that is notified when the particles of the spring are exchanged, set by `SpringIndex` */
+    SpringIndex* mIndex = nullptr;
+
+    friend class SpringIndex;
 
 public:
 #define USE_FAST_SQRT 1
@@ -62,6 +68,8 @@ public:
     Spring(Particle* pA, Particle* pB, const float pSpringConstant, const float pSpringDamping)
         : Spring(pA, pB, pSpringConstant, pSpringDamping, PVector::dist(pA->position(), pB->position())) {}
 
+    ~Spring() override;
+
     void setRestLengthByPosition() {
         restlength(PVector::dist(mA->position(), mB->position()));
     }
@@ -82,13 +90,9 @@ public:
         return mB;
     }
 
-    Particle* a(Particle* pA) {
-        return mA = pA;
-    }
+    Particle* a(Particle* pA);
 
-    Particle* b(Particle* pB) {
-        return mB = pB;
-    }
+    Particle* b(Particle* pB);
 
     float currentLength() const {
         return PVector::dist(mA->position(), mB->position());
@@ -114,6 +118,13 @@ public:
         mOneWay = pOneWayState;
     }
 
+    bool oneway() const {
+        return mOneWay;
+    }
+
+    /* computes the force the spring exerts on particle `a`. returns false if the spring exerts no force. */
+    bool calculateForce(PVector& pForce) const;
+
     void apply(float pDeltaTime, Physics& pParticleSystem) override ;
 
     bool dead() const override {
@@ -0,0 +1,91 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Particle;
+class Spring;
+
+/*
+ * greedy edge coloring of a spring network. springs of the same color share no particle, so all springs of one
+ * color can be applied in parallel without synchronization. colors are assigned incrementally as springs are
+ * added or removed. springs that cannot be assigned one of the `MAX_COLORS` colors ( e.g springs connected to a
+ * particle with many springs ) are kept in an overflow list that must be applied sequentially.
+ */
+class SpringColoring {
+public:
+    static constexpr uint32_t MAX_COLORS = 64;
+    static constexpr uint32_t OVERFLOW   = MAX_COLORS;
+
+    struct Entry {
+        Spring*   spring;
+        Particle* a;
+        Particle* b;
+    };
+
+private:
+    struct Location {
+        uint32_t color;
+        uint32_t slot;
+    };
+
+    std::vector<std::vector<Entry>>               mColors;
+    std::vector<Entry>                            mOverflow;
+    std::unordered_map<const Spring*, Location>   mLocations;
+    std::unordered_map<const Particle*, uint64_t> mUsedColors;
+
+public:
+    void add(Spring* pSpring);
+    void remove(const Spring* pSpring);
+    void clear();
+
+    bool contains(const Spring* pSpring) const {
+        return mLocations.find(pSpring) != mLocations.end();
+    }
+
+    size_t size() const {
+        return mLocations.size();
+    }
+
+    /* number of colors in use, not counting the overflow list */
+    size_t colors() const {
+        return mColors.size();
+    }
+
+    const std::vector<Entry>& color(const size_t pColor) const {
+        return mColors[pColor];
+    }
+
+    const std::vector<Entry>& overflow() const {
+        return mOverflow;
+    }
+
+private:
+    std::vector<Entry>& list(uint32_t pColor);
+    void                release(const Particle* pParticle, uint32_t pColor);
+};
@@ -0,0 +1,100 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+
+class Particle;
+class Spring;
+
+/*
+ * hashed index of springs keyed on the unordered pair of particles they connect. indexed springs notify their index
+ * when their particles are exchanged via `Spring::a(Particle*)` or `Spring::b(Particle*)` and are re-keyed right
+ * away, springs that are destroyed remove themselves. a spring is part of at most one index at a time.
+ */
+class SpringIndex {
+    struct Edge {
+        const Particle* a;
+        const Particle* b;
+
+        bool operator==(const Edge& pOther) const {
+            return a == pOther.a && b == pOther.b;
+        }
+    };
+
+    struct EdgeHash {
+        size_t operator()(const Edge& pEdge) const {
+            const size_t mA = std::hash<const Particle*>()(pEdge.a);
+            const size_t mB = std::hash<const Particle*>()(pEdge.b);
+            return mA ^ (mB + 0x9e3779b97f4a7c15ULL + (mA << 6) + (mA >> 2));
+        }
+    };
+
+    std::unordered_multimap<Edge, Spring*, EdgeHash> mSprings;
+    std::unordered_map<const Spring*, Edge>          mEdges;
+
+public:
+    SpringIndex() = default;
+    ~SpringIndex();
+
+    SpringIndex(const SpringIndex&)            = delete;
+    SpringIndex& operator=(const SpringIndex&) = delete;
+
+    void add(Spring* pSpring);
+    void remove(const Spring* pSpring);
+    void clear();
+
+    /* re-keys `pSpring` after its particles were exchanged, called by `Spring` */
+    void update(Spring* pSpring);
+
+    /* returns a spring connecting `pA` and `pB` in either direction or `nullptr` */
+    Spring* find(const Particle* pA, const Particle* pB) const {
+        const auto it = mSprings.find(edge(pA, pB));
+        return it == mSprings.end() ? nullptr : it->second;
+    }
+
+    bool contains(const Spring* pSpring) const {
+        return mEdges.find(pSpring) != mEdges.end();
+    }
+
+    size_t size() const {
+        return mEdges.size();
+    }
+
+    void reserve(const size_t pCapacity) {
+        mSprings.reserve(pCapacity);
+        mEdges.reserve(pCapacity);
+    }
+
+private:
+    /* erases `pSpring` from the springs with edge `pEdge` and returns it */
+    Spring* unlink(const Edge& pEdge, const Spring* pSpring);
+
+    static Edge edge(const Particle* pA, const Particle* pB) {
+        return std::less<const Particle*>()(pA, pB) ? Edge{pA, pB} : Edge{pB, pA};
+    }
+};
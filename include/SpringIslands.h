@@ -0,0 +1,136 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Particle;
+class Spring;
+
+/*
+ * connected components ( islands ) of a spring network. particles joined by springs belong to the same island, so
+ * different islands share neither particles nor springs and can be processed on different threads without
+ * synchronization or put to sleep as a whole. adding a spring merges the islands of its particles by moving the
+ * smaller island into the larger one. removing a spring only marks its island, islands are split by `update()`
+ * with a search over the marked islands. particles without springs belong to no island. like `SpringColoring`
+ * springs are registered with the particles they connect at the time they are added.
+ */
+class SpringIslands {
+public:
+    static constexpr uint32_t INVALID_ISLAND = UINT32_MAX;
+
+    struct Entry {
+        Spring*   spring;
+        Particle* a;
+        Particle* b;
+    };
+
+    struct Island {
+        std::vector<Particle*> particles;
+        std::vector<Entry>     springs;
+        bool                   split    = false;
+        /* set by the owner of the islands, cleared whenever the island changes */
+        bool                   sleeping = false;
+    };
+
+    struct Statistics {
+        size_t islands   = 0;
+        size_t particles = 0;
+        size_t springs   = 0;
+        size_t smallest  = 0;
+        size_t largest   = 0;
+        /* `histogram[k]` counts the islands with `[2^k, 2^(k+1))` particles */
+        std::vector<size_t> histogram;
+    };
+
+private:
+    struct Node {
+        uint32_t             island;
+        uint32_t             slot;
+        std::vector<Spring*> springs;
+    };
+
+    struct Location {
+        uint32_t island;
+        uint32_t slot;
+    };
+
+    std::unordered_map<const Particle*, Node>   mNodes;
+    std::unordered_map<const Spring*, Location> mLocations;
+    std::vector<Island>                         mIslands;
+    std::vector<uint32_t>                       mFreeIslands;
+    std::vector<uint32_t>                       mSplitIslands;
+    size_t                                      mCount = 0;
+
+public:
+    void add(Spring* pSpring);
+    /* particles left without springs are appended to `pDetached` */
+    void remove(const Spring* pSpring, std::vector<Particle*>* pDetached = nullptr);
+    void clear();
+
+    /* splits the islands that lost springs since the last update */
+    void update();
+
+    bool contains(const Spring* pSpring) const {
+        return mLocations.find(pSpring) != mLocations.end();
+    }
+
+    bool contains(const Particle* pParticle) const {
+        return mNodes.find(pParticle) != mNodes.end();
+    }
+
+    /* island of `pParticle` or `INVALID_ISLAND` if it is not connected by any spring */
+    uint32_t island(const Particle* pParticle) const {
+        const auto it = mNodes.find(pParticle);
+        return it == mNodes.end() ? INVALID_ISLAND : it->second.island;
+    }
+
+    /* number of islands */
+    size_t size() const {
+        return mCount;
+    }
+
+    /* all islands by index, unused indices hold empty islands */
+    const std::vector<Island>& islands() const {
+        return mIslands;
+    }
+
+    void sleeping(const uint32_t pIsland, const bool pSleeping) {
+        mIslands[pIsland].sleeping = pSleeping;
+    }
+
+    Statistics statistics() const;
+
+private:
+    uint32_t makeIsland();
+    void     freeIsland(uint32_t pIsland);
+    Node&    node(Particle* pParticle);
+    void     insert(uint32_t pIsland, Particle* pParticle, Node& pNode);
+    void     erase(const Particle* pParticle);
+    void     merge(uint32_t pFrom, uint32_t pTo);
+    void     split(uint32_t pIsland);
+};
@@ -0,0 +1,145 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "Force.h"
+#include "Particle.h"
+#include "PVector.h"
+
+class Physics;
+class ParticleStore;
+
+/*
+ * batch of springs stored as contiguous arrays of particle indices, rest lengths, spring constants and damping
+ * values. all springs are evaluated in a single pass with the same semantics as `Spring::apply`: relative
+ * positions and velocities are gathered into scratch arrays, forces are computed in a vectorized kernel and
+ * finally accumulated into the particles in spring order.
+ *
+ * indices refer to slots of the `ParticleStore` of the particle system. if the system is not packed ( see
+ * `Physics::packed()` ) springs are evaluated through their `Particle*` endpoints instead. springs whose
+ * endpoints died are removed together with the particles, which shifts the indices of subsequent springs.
+ */
+class SpringSystem final : public Force {
+    std::vector<Particle*> mParticlesA;
+    std::vector<Particle*> mParticlesB;
+    std::vector<uint32_t>  mA;
+    std::vector<uint32_t>  mB;
+    std::vector<float>     mRestLengths;
+    std::vector<float>     mSpringConstants;
+    std::vector<float>     mSpringDampings;
+    std::vector<uint8_t>   mOneWay;
+
+    /* scratch buffers of the vectorized kernel */
+    std::vector<float> mDX;
+    std::vector<float> mDY;
+    std::vector<float> mDZ;
+    std::vector<float> mDVX;
+    std::vector<float> mDVY;
+    std::vector<float> mDVZ;
+    std::vector<float> mFX;
+    std::vector<float> mFY;
+    std::vector<float> mFZ;
+
+    const ParticleStore* mStore;
+    uint64_t             mStoreRevision;
+    bool                 mIndicesValid;
+    bool                 mActive;
+    bool                 mDead;
+    const long           mID;
+
+public:
+    static constexpr float DEFAULT_SPRING_CONSTANT = 2.0f;
+    static constexpr float DEFAULT_SPRING_DAMPING  = 0.1f;
+
+    SpringSystem();
+
+    uint32_t make(Particle* pA, Particle* pB);
+    uint32_t make(Particle* pA, Particle* pB, float pRestLength);
+    uint32_t make(Particle* pA, Particle* pB, float pSpringConstant, float pSpringDamping);
+    uint32_t make(Particle* pA, Particle* pB, float pSpringConstant, float pSpringDamping, float pRestLength);
+
+    static SpringSystem* make() {
+        return new SpringSystem();
+    }
+
+    /* removes a spring while preserving the order of all other springs */
+    void remove(uint32_t pIndex);
+
+    /* removes all springs connected to a dead particle. returns the number of removed springs. */
+    size_t removeDead();
+
+    /* removes all springs connected to one of `pParticles`. returns the number of removed springs. */
+    size_t removeConnected(const std::unordered_set<const Particle*>& pParticles);
+
+    void reserve(size_t pCapacity);
+
+    size_t size() const { return mRestLengths.size(); }
+
+    Particle* a(const uint32_t i) const { return mParticlesA[i]; }
+    Particle* b(const uint32_t i) const { return mParticlesB[i]; }
+    float     restlength(const uint32_t i) const { return mRestLengths[i]; }
+    void      restlength(const uint32_t i, const float pRestLength) { mRestLengths[i] = pRestLength; }
+    float     strength(const uint32_t i) const { return mSpringConstants[i]; }
+    void      strength(const uint32_t i, const float pSpringConstant) { mSpringConstants[i] = pSpringConstant; }
+    float     damping(const uint32_t i) const { return mSpringDampings[i]; }
+    void      damping(const uint32_t i, const float pSpringDamping) { mSpringDampings[i] = pSpringDamping; }
+    bool      oneway(const uint32_t i) const { return mOneWay[i] != 0; }
+    void      setOneWay(const uint32_t i, const bool pOneWayState) { mOneWay[i] = pOneWayState ? 1 : 0; }
+
+    void apply(float pDeltaTime, Physics& pParticleSystem) override;
+
+    bool dead() const override { return mDead; }
+    void dead(const bool pDead) override { mDead = pDead; }
+    bool active() const override { return mActive; }
+    void active(const bool pActiveState) override { mActive = pActiveState; }
+    long ID() const override { return mID; }
+
+private:
+    template<typename P>
+    size_t removeIf(P pRemoved);
+
+    /* computes the spring forces of `pCount` springs from relative positions and velocities */
+    static void computeForces(size_t       pCount,
+                              const float* pDX,
+                              const float* pDY,
+                              const float* pDZ,
+                              const float* pDVX,
+                              const float* pDVY,
+                              const float* pDVZ,
+                              const float* pRestLengths,
+                              const float* pSpringConstants,
+                              const float* pSpringDampings,
+                              float*       pFX,
+                              float*       pFY,
+                              float*       pFZ);
+
+    bool updateIndices(const ParticleStore& pStore);
+    void applyPacked(ParticleStore& pStore);
+    void applyIndirect();
+    void resizeScratch();
+};
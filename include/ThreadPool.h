@@ -0,0 +1,81 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * fixed set of worker threads that split index ranges into contiguous chunks. the calling thread works on the
+ * first chunk, so a pool with `N` threads runs `N - 1` workers. chunks are assigned statically, which makes the
+ * partitioning of a range reproducible for a given thread count.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t pBegin, size_t pEnd, size_t pThread)>;
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::mutex               mMutex;
+    std::condition_variable  mStart;
+    std::condition_variable  mDone;
+    const Task*              mTask       = nullptr;
+    size_t                   mCount      = 0;
+    size_t                   mChunks     = 0;
+    size_t                   mGeneration = 0;
+    size_t                   mPending    = 0;
+    bool                     mStop       = false;
+
+public:
+    explicit ThreadPool(size_t pThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t threads() const {
+        return mWorkers.size() + 1;
+    }
+
+    /*
+     * calls `pTask` for contiguous chunks of `[0, pCount)` and returns once all chunks are done. ranges are only
+     * split if every chunk holds at least `pGrainSize` elements.
+     */
+    void run(size_t pCount, size_t pGrainSize, const Task& pTask);
+
+    /* number of chunks `run()` splits a range of `pCount` elements into */
+    size_t chunks(size_t pCount, size_t pGrainSize) const;
+
+    /* range of chunk `pChunk` when splitting `pCount` elements into `pChunks` chunks */
+    static void chunk(size_t pCount, size_t pChunks, size_t pChunk, size_t& pBegin, size_t& pEnd) {
+        pBegin = pCount * pChunk / pChunks;
+        pEnd   = pCount * (pChunk + 1) / pChunks;
+    }
+
+private:
+    void work(size_t pThread);
+};
@@ -0,0 +1,194 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PVector.h"
+
+class Physics;
+
+using namespace umgebung;
+
+/*
+ * streams the particle positions ( and optionally velocities ) of every recorded step to a file. components are
+ * quantized to multiples of `precision()` and stored as differences to a prediction from the previous frames, the
+ * previous frame moved on by the motion between the two frames before. differences are compressed with a run
+ * length coding of correctly predicted components and variable length integers. every `keyframe_interval()`
+ * frames, and whenever the number of particles changes, a keyframe with absolute values is written instead.
+ *
+ * `record` only copies the particles into one of `capacity()` frame buffers, encoding and writing happens on a
+ * background thread. if all buffers are still waiting to be written the frame is dropped instead of blocking the
+ * simulation. frames carry the number of the `record` call they were captured by, so dropped frames show up as
+ * gaps ( see `TrajectoryReader` ).
+ */
+class TrajectoryRecorder {
+public:
+    static constexpr uint32_t VERSION = 1;
+
+private:
+    struct Frame {
+        uint64_t             step = 0;
+        std::vector<PVector> positions;
+        std::vector<PVector> velocities;
+    };
+
+    std::FILE*              mFile;
+    const bool              mVelocities;
+    const float             mPrecision;
+    const uint32_t          mKeyframeInterval;
+    std::vector<Frame>      mFrames;
+    std::vector<size_t>     mFree;
+    std::deque<size_t>      mQueue;
+    std::mutex              mMutex;
+    std::condition_variable mQueued;
+    std::condition_variable mWritten;
+    bool                    mWriting = false;
+    bool                    mStop    = false;
+    uint64_t                mSteps   = 0;
+    std::atomic<uint64_t>   mRecorded{0};
+    std::atomic<uint64_t>   mDropped{0};
+    std::atomic<uint64_t>   mBytes{0};
+    std::atomic<bool>       mGood{false};
+    /* used on the background thread only */
+    std::vector<int32_t>    mQuantized;
+    std::vector<int32_t>    mLast;
+    std::vector<int32_t>    mBeforeLast;
+    std::vector<int32_t>    mPrediction;
+    std::vector<uint8_t>    mEncoded;
+    uint64_t                mDepth = 0;
+    std::thread             mWriter;
+
+public:
+    /*
+     * opens `pFilePath` for writing. components are quantized to multiples of `pPrecision`, at most `pCapacity`
+     * frames wait to be written at any time.
+     */
+    explicit TrajectoryRecorder(const std::string& pFilePath,
+                                bool               pVelocities       = false,
+                                float              pPrecision        = 0.001f,
+                                uint32_t           pKeyframeInterval = 60,
+                                size_t             pCapacity         = 4);
+    ~TrajectoryRecorder();
+
+    TrajectoryRecorder(const TrajectoryRecorder&)            = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    /* captures all particles of `pPhysics` in the order of `particles()`, returns false if the frame was dropped */
+    bool record(Physics& pPhysics);
+
+    /* blocks until all captured frames are written */
+    void flush();
+
+    /* writes all captured frames and closes the file, called by the destructor */
+    void close();
+
+    /* false if the file could not be opened or a write failed */
+    bool good() const { return mGood; }
+
+    bool     velocities() const { return mVelocities; }
+    float    precision() const { return mPrecision; }
+    uint32_t keyframe_interval() const { return mKeyframeInterval; }
+    size_t   capacity() const { return mFrames.size(); }
+
+    /* number of frames written, dropped and bytes written so far */
+    uint64_t recorded() const { return mRecorded; }
+    uint64_t dropped() const { return mDropped; }
+    uint64_t bytes() const { return mBytes; }
+
+private:
+    void write();
+    void encode(const Frame& pFrame);
+};
+
+/*
+ * reads files written by `TrajectoryRecorder`. opening a file indexes all frames, so any frame can be reached by
+ * decoding forward from the keyframe before it.
+ */
+class TrajectoryReader {
+    struct Entry {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t step;
+        uint32_t count;
+        bool     keyframe;
+    };
+
+    std::FILE*           mFile       = nullptr;
+    bool                 mVelocities = false;
+    float                mPrecision  = 0.0f;
+    std::vector<Entry>   mEntries;
+    std::vector<size_t>  mKeyframes;
+    size_t               mFrame = SIZE_MAX;
+    uint64_t             mDepth = 0;
+    std::vector<int32_t> mQuantized;
+    std::vector<int32_t> mBeforeLast;
+    std::vector<int32_t> mPrediction;
+    std::vector<uint8_t> mEncoded;
+    std::vector<PVector> mPositions;
+    std::vector<PVector> mVelocityValues;
+
+public:
+    explicit TrajectoryReader(const std::string& pFilePath);
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&)            = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    /* false if the file could not be opened or is no trajectory */
+    bool good() const { return mFile != nullptr; }
+
+    float precision() const { return mPrecision; }
+
+    /* number of complete frames in the file, a frame cut off by a crash is ignored */
+    size_t frames() const { return mEntries.size(); }
+
+    /* index of the last keyframe at or before frame `pFrame` */
+    size_t keyframe(size_t pFrame) const;
+
+    /* decodes frame `pFrame`, continuing from the current frame or starting at the keyframe before `pFrame` */
+    bool seek(size_t pFrame);
+
+    /* decodes the frame after the current one */
+    bool next() { return seek(mFrame == SIZE_MAX ? 0 : mFrame + 1); }
+
+    /* index of the decoded frame and the number of the `record` call that captured it */
+    size_t   frame() const { return mFrame; }
+    uint64_t step() const { return mEntries[mFrame].step; }
+
+    /* values of the decoded frame, velocities are empty unless they were recorded */
+    const std::vector<PVector>& positions() const { return mPositions; }
+    const std::vector<PVector>& velocities() const { return mVelocityValues; }
+
+private:
+    bool decode(size_t pFrame);
+};
@@ -0,0 +1,294 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "Constraint.h"
+#include "Force.h"
+#include "Integrator.h"
+#include "ParticleForce.h"
+#include "Physics.h"
+#include "Spring.h"
+#include "SpringColoring.h"
+
+/*
+ * physics with a composition that is known at compile time. `I` is the integrator, `Ts` are the force and
+ * constraint types of the scene. every type is kept in its own container and applied with statically dispatched
+ * calls, which allows the compiler to inline them into the loops over particles. forces that implement
+ * `ParticleForce` are applied block by block to ranges of particles ( in parallel if physics runs on multiple
+ * threads ), all other forces and constraints are applied in the order of `Ts`.
+ *
+ *     TypedPhysics<Verlet, Gravity, Attractor, Spring, Box> mPhysics;
+ *     mPhysics.make<Gravity>(0, 9.81f, 0);
+ *     mPhysics.make<Spring>(a, b);
+ *
+ * typed forces are applied before and typed constraints before the objects of the dynamic force and constraint
+ * lists, which can still be used for all other types via `add()`. typed objects are not issued handles and are
+ * not part of `forces()` or `constraints()`. typed springs are found by `findSpring()` and colored like the
+ * springs of the force list, but they are not part of islands.
+ *
+ * `step()` and `update()` of `Physics` integrate with `I` unless another integrator is set with
+ * `replace_integrator()` or `setIntegratorRef()`, which is then dispatched dynamically like in `Physics`.
+ */
+template<typename I, typename... Ts>
+class TypedPhysics final : public Physics {
+    static_assert(std::is_base_of<Integrator, I>::value, "`I` must be an `Integrator`");
+    static_assert(std::conjunction<std::disjunction<std::is_base_of<Force, Ts>, std::is_base_of<Constraint, Ts>>...>::value,
+                  "`Ts` must be `Force`s or `Constraint`s");
+
+    template<typename T>
+    using Typed = std::enable_if_t<std::disjunction<std::is_same<T, Ts>...>::value, int>;
+
+    template<typename T>
+    static constexpr bool PARTICLE_FORCE = std::is_base_of<Force, T>::value && std::is_base_of<ParticleForce, T>::value;
+
+    template<typename T, typename = void>
+    struct Connecting : std::false_type {};
+
+    template<typename T>
+    struct Connecting<T, std::void_t<decltype(std::declval<T&>().a()), decltype(std::declval<T&>().b())>> : std::true_type {};
+
+    I                                 mTypedIntegrator;
+    std::tuple<std::vector<Ts*>...>   mObjects;
+    std::unordered_set<const void*>   mTypedRemoved;
+    SpringColoring                    mTypedSpringColoring;
+    std::vector<std::vector<Spring*>> mStaleTypedSprings;
+
+public:
+    template<typename... Args>
+    explicit TypedPhysics(Args&&... pArgs) : mTypedIntegrator(std::forward<Args>(pArgs)...) {
+        setIntegratorRef(&mTypedIntegrator);
+    }
+
+    I& integrator() {
+        return mTypedIntegrator;
+    }
+
+    /* creates an object of type `T` that is owned by physics */
+    template<typename T, typename... Args, Typed<T> = 0>
+    T* make(Args&&... pArgs) {
+        T* mObject = pool<T>().make(std::forward<Args>(pArgs)...);
+        typedAdded(mObject);
+        return mObject;
+    }
+
+    using Physics::add;
+
+    /* adds an object of type `T` that remains owned by the caller */
+    template<typename T, Typed<T> = 0>
+    void add(T* pObject) {
+        typedAdded(pObject);
+    }
+
+    using Physics::remove;
+
+    /* removes an object of type `T` at the beginning of the next step */
+    template<typename T, Typed<T> = 0>
+    void remove(T* pObject) {
+        if constexpr (std::is_same<T, Spring>::value) {
+            unindexSpring(pObject);
+        }
+        mTypedRemoved.insert(pObject);
+    }
+
+    template<typename T, Typed<T> = 0>
+    std::vector<T*>& objects() {
+        return std::get<std::vector<T*>>(mObjects);
+    }
+
+    template<typename T, Typed<T> = 0>
+    const std::vector<T*>& objects() const {
+        return std::get<std::vector<T*>>(mObjects);
+    }
+
+protected:
+    void advanceStep(const float pDeltaTime, const uint8_t pFlags) override {
+        if (getIntegrator() == &mTypedIntegrator) {
+            advance(pDeltaTime, mTypedIntegrator, pFlags);
+        } else {
+            Physics::advanceStep(pDeltaTime, pFlags);
+        }
+    }
+
+    void beginStep(const bool pRemoveDead) override {
+        removeTyped(pRemoveDead);
+    }
+
+    void applyTypedForces(const float pDeltaTime) override {
+        if constexpr (std::disjunction<std::bool_constant<PARTICLE_FORCE<Ts>>...>::value) {
+            const size_t mCount = particles().size();
+            if (ThreadPool* mThreadPool = threadpool()) {
+                mThreadPool->run(mCount, PARALLEL_GRAIN_SIZE, [&](const size_t pBegin, const size_t pEnd, size_t) {
+                    applyTypedParticleForces(pDeltaTime, pBegin, pEnd);
+                });
+            } else {
+                applyTypedParticleForces(pDeltaTime, 0, mCount);
+            }
+        }
+        forEach([&](auto& pObjects) {
+            using T = std::remove_pointer_t<typename std::decay_t<decltype(pObjects)>::value_type>;
+            if constexpr (std::is_same<T, Spring>::value) {
+                if (threadpool() != nullptr && HINT_COLOR_SPRINGS && !HINT_DETERMINISTIC_REDUCTION) {
+                    applyColoredTypedSprings(pDeltaTime);
+                    return;
+                }
+            }
+            if constexpr (std::is_base_of<Force, T>::value && !PARTICLE_FORCE<T>) {
+                for (T* f: pObjects) {
+                    if (f->active()) {
+                        f->T::apply(pDeltaTime, *this);
+                    }
+                }
+            }
+        });
+    }
+
+    bool hasTypedConstraints() const override {
+        bool mConstraints = false;
+        std::apply([&](const auto&... pObjects) {
+            ((mConstraints |= std::is_base_of<Constraint, std::remove_pointer_t<typename std::decay_t<decltype(pObjects)>::value_type>>::value &&
+                              !pObjects.empty()),
+             ...);
+        }, mObjects);
+        return mConstraints;
+    }
+
+    void applyTypedConstraints() override {
+        forEach([&](auto& pObjects) {
+            using T = std::remove_pointer_t<typename std::decay_t<decltype(pObjects)>::value_type>;
+            if constexpr (std::is_base_of<Constraint, T>::value) {
+                for (T* c: pObjects) {
+                    c->T::apply(*this);
+                }
+            }
+        });
+    }
+
+private:
+    template<typename F>
+    void forEach(F&& pFunction) {
+        std::apply([&](auto&... pObjects) { (pFunction(pObjects), ...); }, mObjects);
+    }
+
+    template<typename T>
+    void typedAdded(T* pObject) {
+        objects<T>().push_back(pObject);
+        if constexpr (std::is_same<T, Spring>::value) {
+            indexSpring(pObject);
+            mTypedSpringColoring.add(pObject);
+        }
+    }
+
+    template<typename T>
+    void typedRemoved(T* pObject) {
+        if constexpr (std::is_same<T, Spring>::value) {
+            unindexSpring(pObject);
+            mTypedSpringColoring.remove(pObject);
+        }
+        pool<T>().release(pObject);
+    }
+
+    /* applies typed springs color by color in parallel, springs whose particles were exchanged are recolored */
+    void applyColoredTypedSprings(const float pDeltaTime) {
+        ThreadPool* mThreadPool = threadpool();
+        mStaleTypedSprings.resize(mThreadPool->threads());
+        for (size_t c = 0; c < mTypedSpringColoring.colors(); ++c) {
+            const auto& mColor = mTypedSpringColoring.color(c);
+            mThreadPool->run(mColor.size(), PARALLEL_GRAIN_SIZE, [&](const size_t pBegin, const size_t pEnd, const size_t pThread) {
+                for (size_t j = pBegin; j < pEnd; ++j) {
+                    const SpringColoring::Entry& e = mColor[j];
+                    if (e.spring->a() != e.a || e.spring->b() != e.b) {
+                        mStaleTypedSprings[pThread].push_back(e.spring);
+                    } else if (e.spring->active()) {
+                        e.spring->Spring::apply(pDeltaTime, *this);
+                    }
+                }
+            });
+        }
+        for (const auto& e: mTypedSpringColoring.overflow()) {
+            if (e.spring->a() != e.a || e.spring->b() != e.b) {
+                mStaleTypedSprings[0].push_back(e.spring);
+            } else if (e.spring->active()) {
+                e.spring->Spring::apply(pDeltaTime, *this);
+            }
+        }
+        for (auto& mStale: mStaleTypedSprings) {
+            for (const auto& mSpring: mStale) {
+                mTypedSpringColoring.remove(mSpring);
+                mTypedSpringColoring.add(mSpring);
+                if (mSpring->active()) {
+                    mSpring->Spring::apply(pDeltaTime, *this);
+                }
+            }
+            mStale.clear();
+        }
+    }
+
+    /* applies all typed particle forces to one block of particles before moving on to the next block */
+    void applyTypedParticleForces(const float pDeltaTime, const size_t pBegin, const size_t pEnd) {
+        for (size_t mBlock = pBegin; mBlock < pEnd; mBlock += PARTICLE_FORCE_BLOCK_SIZE) {
+            const size_t mBlockEnd = std::min(mBlock + PARTICLE_FORCE_BLOCK_SIZE, pEnd);
+            forEach([&](auto& pObjects) {
+                using T = std::remove_pointer_t<typename std::decay_t<decltype(pObjects)>::value_type>;
+                if constexpr (PARTICLE_FORCE<T>) {
+                    for (T* f: pObjects) {
+                        if (f->active()) {
+                            f->T::apply(pDeltaTime, *this, mBlock, mBlockEnd);
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    /*
+     * drops removed and dead objects, objects created with `make()` are destroyed. objects connecting a removed
+     * particle are dropped before the particle is released, whether dead objects are removed or not.
+     */
+    void removeTyped(const bool pRemoveDead) {
+        forEach([&](auto& pObjects) {
+            using T       = std::remove_pointer_t<typename std::decay_t<decltype(pObjects)>::value_type>;
+            size_t mWrite = 0;
+            for (T* o: pObjects) {
+                bool mConnected = false;
+                if constexpr (Connecting<T>::value) {
+                    mConnected = connected(o->a(), o->b());
+                }
+                if (mConnected || mTypedRemoved.count(o) > 0 || (pRemoveDead && o->T::dead())) {
+                    typedRemoved(o);
+                } else {
+                    pObjects[mWrite++] = o;
+                }
+            }
+            pObjects.resize(mWrite);
+        });
+        mTypedRemoved.clear();
+    }
+};
@@ -25,6 +25,8 @@
 
 #include <vector>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <random>
 
 #include "PVector.h"
@@ -77,11 +79,13 @@ public:
         p.z /= pVector.z;
     }
 
+    /* approximate `1 / sqrt(v)` with one newton iteration, the bits are copied instead of punned through pointers */
     static float fastInverseSqrt(float v) {
         const float half = 0.5f * v;
-        int         i    = *reinterpret_cast<int*>(&v);
-        i                = 0x5f375a86 - (i >> 1);
-        v                = *reinterpret_cast<float*>(&i);
+        int32_t     i;
+        std::memcpy(&i, &v, sizeof(float));
+        i = 0x5f375a86 - (i >> 1);
+        std::memcpy(&v, &i, sizeof(float));
         return v * (1.5f - half * v * v);
     }
 
@@ -93,22 +97,13 @@ public:
     }
 
     static Particle* findParticleByProximity(const std::vector<Particle*>& pParticles, const PVector& pPosition, float pSelectionRadius) {
-        std::vector<Particle*> mCloseParticles;
+        Particle* mClosestParticle        = nullptr;
+        float     mClosestDistanceSquared = pSelectionRadius * pSelectionRadius;
         for (const auto& p: pParticles) {
-            if (PVector::dist(pPosition, p->position()) < pSelectionRadius) {
-                mCloseParticles.push_back(p);
-            }
-        }
-        if (mCloseParticles.empty()) {
-            return nullptr;
-        }
-        Particle* mClosestParticle = mCloseParticles[0];
-        float     mClosestDistance = PVector::dist(pPosition, mClosestParticle->position());
-        for (size_t i = 1; i < mCloseParticles.size(); i++) {
-            const float mDistance = PVector::dist(pPosition, mCloseParticles[i]->position());
-            if (mDistance < mClosestDistance) {
-                mClosestDistance = mDistance;
-                mClosestParticle = mCloseParticles[i];
+            const float mDistanceSquared = distanceSquared(pPosition, p->position());
+            if (mDistanceSquared < mClosestDistanceSquared) {
+                mClosestDistanceSquared = mDistanceSquared;
+                mClosestParticle        = p;
             }
         }
         return mClosestParticle;
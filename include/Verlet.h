@@ -50,24 +50,30 @@ public:
 
     void step(float pDeltaTime, Physics& pParticleSystem) override {
         pParticleSystem.applyForces(pDeltaTime);
-        const auto& particles = pParticleSystem.particles();
+        if (ParticleStore* mStore = pParticleSystem.packed()) {
+            integrate(pDeltaTime, *mStore);
+            return;
+        }
+        const float mInverseDelta = 1.0f / pDeltaTime;
+        const float mDeltaSquared = pDeltaTime * pDeltaTime;
+        const auto& particles     = pParticleSystem.particles();
         for (const auto& mParticle: particles) {
             if (!mParticle->fixed()) {
-                integrate(pDeltaTime, *mParticle);
+                integrate(mInverseDelta, mDeltaSquared, *mParticle);
             }
         }
     }
 
 private:
-    void integrate(float pDeltaTime, Particle& pParticle) {
+    void integrate(const float pInverseDelta, const float pDeltaSquared, Particle& pParticle) {
         const PVector mOldPosition = pParticle.position();
 
         pParticle.velocity().set(PVector::sub(pParticle.position(), pParticle.old_position()));
-        pParticle.velocity().mult(1.0f / pDeltaTime);
+        pParticle.velocity().mult(pInverseDelta);
 
         temp1.set(pParticle.force());
         temp1.mult(1.0f / pParticle.mass());
-        temp1.mult(pDeltaTime * pDeltaTime);
+        temp1.mult(pDeltaSquared);
 
         temp2.set(PVector::sub(pParticle.position(), pParticle.old_position()));
         temp2.mult(mDamping);
@@ -77,4 +83,7 @@ private:
 
         pParticle.old_position().set(mOldPosition);
     }
+
+    /* integrates all particles of the store, 8 particles per iteration when compiled with AVX2 */
+    void integrate(float pDeltaTime, ParticleStore& pStore) const;
 };
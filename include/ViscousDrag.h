@@ -24,11 +24,12 @@
 #pragma once
 
 #include "Force.h"
+#include "ParticleForce.h"
 #include "Physics.h"
 #include "Particle.h"
 #include "Verlet.h"
 
-class ViscousDrag : public Force {
+class ViscousDrag : public Force, public ParticleForce {
 public:
     float      coefficient;
     bool       mActive;
@@ -41,20 +42,41 @@ public:
     ViscousDrag() : ViscousDrag(1.0f) {}
 
     void apply(float pDeltaTime, Physics& pParticleSystem) override {
+        apply(pDeltaTime, pParticleSystem, 0, pParticleSystem.particles().size());
+    }
+
+    void apply(float /* pDeltaTime */, Physics& pParticleSystem, const size_t pBegin, const size_t pEnd) override {
         if (dynamic_cast<Verlet*>(pParticleSystem.getIntegrator()) != nullptr) {
             return;
         }
 
-        if (coefficient != 0) {
-            const auto& particles = pParticleSystem.particles();
-            for (const auto& mParticle: particles) {
-                if (!mParticle->fixed()) {
-                    mParticle->force().add(
-                        mParticle->velocity().x * -coefficient,
-                        mParticle->velocity().y * -coefficient,
-                        mParticle->velocity().z * -coefficient);
+        if (coefficient == 0) {
+            return;
+        }
+
+        if (ParticleStore* mStore = pParticleSystem.packed()) {
+            PVector*       mForces     = mStore->forces();
+            const PVector* mVelocities = mStore->velocities();
+            const uint8_t* mFlags      = mStore->flags();
+            for (size_t i = pBegin; i < pEnd; ++i) {
+                if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+                    mForces[i].add(mVelocities[i].x * -coefficient,
+                                   mVelocities[i].y * -coefficient,
+                                   mVelocities[i].z * -coefficient);
                 }
             }
+            return;
+        }
+
+        const auto& particles = pParticleSystem.particles();
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            Particle* mParticle = particles[i];
+            if (!mParticle->fixed()) {
+                mParticle->force().add(
+                    mParticle->velocity().x * -coefficient,
+                    mParticle->velocity().y * -coefficient,
+                    mParticle->velocity().z * -coefficient);
+            }
         }
     }
 
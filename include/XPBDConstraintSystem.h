@@ -0,0 +1,127 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "Constraint.h"
+#include "Particle.h"
+#include "PVector.h"
+
+class Physics;
+class ParticleStore;
+class Spring;
+
+/*
+ * batch of XPBD distance constraints ( see `XPBDDistanceConstraint` ) stored as contiguous arrays. every step all
+ * constraints are relaxed together in `iterations` gauss-seidel passes, which propagates corrections through
+ * chains and cloth much faster than relaxing each constraint on its own.
+ *
+ * indices refer to slots of the `ParticleStore` of the particle system. if the system is not packed ( see
+ * `Physics::packed()` ) constraints are relaxed through their `Particle*` endpoints instead. constraints whose
+ * endpoints died are removed before the particles are released.
+ */
+class XPBDConstraintSystem final : public Constraint {
+    std::vector<Particle*> mParticlesA;
+    std::vector<Particle*> mParticlesB;
+    std::vector<uint32_t>  mA;
+    std::vector<uint32_t>  mB;
+    std::vector<float>     mRestLengths;
+    std::vector<float>     mCompliances;
+    std::vector<float>     mDampings;
+    std::vector<float>     mLambdas;
+
+    const ParticleStore* mStore;
+    uint64_t             mStoreRevision;
+    bool                 mIndicesValid;
+    int                  mIterations;
+    bool                 mActive;
+    bool                 mDead;
+    const long           mID;
+
+public:
+    XPBDConstraintSystem();
+
+    uint32_t make(Particle* pA, Particle* pB);
+    uint32_t make(Particle* pA, Particle* pB, float pRestLength, float pCompliance = 0.0f, float pDamping = 0.0f);
+
+    /* adds the equivalent of `pSpring`, compliance is the inverse of its spring constant */
+    uint32_t make(Spring* pSpring);
+
+    static XPBDConstraintSystem* make() {
+        return new XPBDConstraintSystem();
+    }
+
+    /*
+     * replaces all active two-way `Spring`s of `pParticleSystem` with constraints of this system. the springs are
+     * removed from the system. returns the number of converted springs.
+     */
+    size_t convert(Physics& pParticleSystem);
+
+    /* removes a constraint while preserving the order of all other constraints */
+    void remove(uint32_t pIndex);
+
+    /* removes all constraints connected to a dead particle. returns the number of removed constraints. */
+    size_t removeDead();
+
+    /* removes all constraints connected to one of `pParticles`. returns the number of removed constraints. */
+    size_t removeConnected(const std::unordered_set<const Particle*>& pParticles);
+
+    void reserve(size_t pCapacity);
+
+    size_t size() const { return mRestLengths.size(); }
+
+    Particle* a(const uint32_t i) const { return mParticlesA[i]; }
+    Particle* b(const uint32_t i) const { return mParticlesB[i]; }
+    float     restlength(const uint32_t i) const { return mRestLengths[i]; }
+    void      restlength(const uint32_t i, const float pRestLength) { mRestLengths[i] = pRestLength; }
+    float     compliance(const uint32_t i) const { return mCompliances[i]; }
+    void      compliance(const uint32_t i, const float pCompliance) { mCompliances[i] = pCompliance; }
+    float     damping(const uint32_t i) const { return mDampings[i]; }
+    void      damping(const uint32_t i, const float pDamping) { mDampings[i] = pDamping; }
+
+    /* lagrange multiplier of a constraint after the last step, `lambda / dt^2` is the magnitude of its force */
+    float lambda(const uint32_t i) const { return mLambdas[i]; }
+
+    /* number of gauss-seidel passes over all constraints per step */
+    int  iterations() const { return mIterations; }
+    void iterations(const int pIterations) { mIterations = pIterations; }
+
+    void apply(Physics& pParticleSystem) override;
+
+    bool dead() const override { return mDead; }
+    void dead(const bool pDead) override { mDead = pDead; }
+    bool active() const override { return mActive; }
+    void active(const bool pActiveState) override { mActive = pActiveState; }
+    long ID() const override { return mID; }
+
+private:
+    template<typename P>
+    size_t removeIf(P pRemoved);
+    bool   updateIndices(const ParticleStore& pStore);
+    void   applyPacked(ParticleStore& pStore, float pDeltaTime, bool pUpdateVelocities);
+    void   applyIndirect(float pDeltaTime, bool pUpdateVelocities);
+};
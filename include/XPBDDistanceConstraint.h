@@ -0,0 +1,118 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#pragma once
+
+#include "PVector.h"
+#include "Constraint.h"
+
+class Physics;
+class Particle;
+class Spring;
+
+using namespace umgebung;
+
+/*
+ * extended position based dynamics ( XPBD ) distance constraint. keeps two particles at `restlength` by moving
+ * their positions in proportion to their inverse masses. `compliance` is the inverse stiffness, `0` is rigid and
+ * `1 / k` behaves like a `Spring` with spring constant `k` but stays stable at any time step. position corrections
+ * are added to the velocities, with a `Verlet` integrator velocities follow from the positions anyway.
+ *
+ * a single constraint is relaxed `iterations` times on its own, many constraints should go into an
+ * `XPBDConstraintSystem` which relaxes all of them together.
+ */
+class XPBDDistanceConstraint final : public Constraint {
+    Particle*  mA;
+    Particle*  mB;
+    float      mRestLength;
+    float      mCompliance;
+    float      mDamping;
+    int        mIterations;
+    bool       mActive;
+    bool       mDead;
+    const long mID;
+
+public:
+    XPBDDistanceConstraint(Particle* pA, Particle* pB);
+
+    XPBDDistanceConstraint(Particle* pA, Particle* pB, float pRestLength, float pCompliance = 0.0f);
+
+    /* equivalent of `pSpring`, compliance is the inverse of its spring constant, damping is taken over as is */
+    explicit XPBDDistanceConstraint(Spring* pSpring);
+
+    Particle* a() const { return mA; }
+    Particle* b() const { return mB; }
+
+    float restlength() const { return mRestLength; }
+    void  restlength(const float pRestLength) { mRestLength = pRestLength; }
+
+    float compliance() const { return mCompliance; }
+    void  compliance(const float pCompliance) { mCompliance = pCompliance; }
+
+    float damping() const { return mDamping; }
+    void  damping(const float pDamping) { mDamping = pDamping; }
+
+    int  iterations() const { return mIterations; }
+    void iterations(const int pIterations) { mIterations = pIterations; }
+
+    void apply(Physics& pParticleSystem) override;
+
+    bool dead() const override;
+
+    void dead(const bool pDead) override { mDead = pDead; }
+
+    bool active() const override { return mActive; }
+
+    void active(const bool pActiveState) override { mActive = pActiveState; }
+
+    long ID() const override { return mID; }
+
+    /*
+     * one XPBD projection of a distance constraint. moves both positions, and velocities if `pUpdateVelocities` is
+     * set, and returns the lagrange multiplier `pLambda` accumulated over the current step.
+     */
+    static float project(PVector& pPositionA,
+                         PVector& pPositionB,
+                         PVector& pVelocityA,
+                         PVector& pVelocityB,
+                         float    pInverseMassA,
+                         float    pInverseMassB,
+                         float    pRestLength,
+                         float    pCompliance,
+                         float    pDamping,
+                         float    pLambda,
+                         float    pDeltaTime,
+                         bool     pUpdateVelocities);
+
+    static XPBDDistanceConstraint* make(Particle* pA, Particle* pB) {
+        return new XPBDDistanceConstraint(pA, pB);
+    }
+
+    static XPBDDistanceConstraint* make(Particle* pA, Particle* pB, float pRestLength, float pCompliance = 0.0f) {
+        return new XPBDDistanceConstraint(pA, pB, pRestLength, pCompliance);
+    }
+
+    static XPBDDistanceConstraint* make(Spring* pSpring) {
+        return new XPBDDistanceConstraint(pSpring);
+    }
+};
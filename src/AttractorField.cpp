@@ -0,0 +1,276 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include <algorithm>
+
+#include "AttractorField.h"
+#include "Physics.h"
+#include "Util.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+AttractorField::AttractorField()
+    : mActive(true),
+      mDead(false),
+      mID(Physics::getUniqueID()) {}
+
+size_t AttractorField::add(const PVector& pPosition, const float pRadius, const float pStrength) {
+    mX.push_back(pPosition.x);
+    mY.push_back(pPosition.y);
+    mZ.push_back(pPosition.z);
+    mRadii.push_back(pRadius);
+    mStrengths.push_back(pStrength);
+    return mX.size() - 1;
+}
+
+void AttractorField::remove(const size_t pIndex) {
+    mX.erase(mX.begin() + pIndex);
+    mY.erase(mY.begin() + pIndex);
+    mZ.erase(mZ.begin() + pIndex);
+    mRadii.erase(mRadii.begin() + pIndex);
+    mStrengths.erase(mStrengths.begin() + pIndex);
+}
+
+void AttractorField::clear() {
+    mX.clear();
+    mY.clear();
+    mZ.clear();
+    mRadii.clear();
+    mStrengths.clear();
+}
+
+void AttractorField::apply(const float pDeltaTime, Physics& pParticleSystem) {
+    apply(pDeltaTime, pParticleSystem, 0, pParticleSystem.particles().size());
+}
+
+namespace {
+    /* the attractors of one batch that can reach the current block, padded to a multiple of 8 */
+    struct alignas(32) Batch {
+        float x[AttractorField::BATCH_SIZE];
+        float y[AttractorField::BATCH_SIZE];
+        float z[AttractorField::BATCH_SIZE];
+        float radiusSquared[AttractorField::BATCH_SIZE];
+        float inverseRadius[AttractorField::BATCH_SIZE];
+        float strength[AttractorField::BATCH_SIZE];
+    };
+
+#if defined(__AVX2__)
+    float sum(const __m256 v) {
+        const __m128 mLow  = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        const __m128 mHigh = _mm_movehl_ps(mLow, mLow);
+        const __m128 mPair = _mm_add_ps(mLow, mHigh);
+        return _mm_cvtss_f32(_mm_add_ss(mPair, _mm_shuffle_ps(mPair, mPair, 1)));
+    }
+#endif
+
+    /*
+     * sums the attraction of the first `pCount` attractors of `pBatch` on the particle at `pX, pY, pZ`. the AVX2
+     * path evaluates 8 attractors per iteration with a refined `rsqrt`, the scalar path uses
+     * `Util::fastInverseSqrt`.
+     */
+    void attract(const Batch& pBatch, const size_t pCount, const float pX, const float pY, const float pZ, float& pFX, float& pFY, float& pFZ) {
+        size_t j  = 0;
+        float  fx = 0;
+        float  fy = 0;
+        float  fz = 0;
+#if defined(__AVX2__)
+        const __m256 mPX        = _mm256_set1_ps(pX);
+        const __m256 mPY        = _mm256_set1_ps(pY);
+        const __m256 mPZ        = _mm256_set1_ps(pZ);
+        const __m256 mZero      = _mm256_setzero_ps();
+        const __m256 mOne       = _mm256_set1_ps(1.0f);
+        const __m256 mHalf      = _mm256_set1_ps(0.5f);
+        const __m256 mThreeHalf = _mm256_set1_ps(1.5f);
+        __m256       mFX        = mZero;
+        __m256       mFY        = mZero;
+        __m256       mFZ        = mZero;
+        for (; j + 8 <= pCount; j += 8) {
+            const __m256 mDX              = _mm256_sub_ps(_mm256_load_ps(pBatch.x + j), mPX);
+            const __m256 mDY              = _mm256_sub_ps(_mm256_load_ps(pBatch.y + j), mPY);
+            const __m256 mDZ              = _mm256_sub_ps(_mm256_load_ps(pBatch.z + j), mPZ);
+            const __m256 mDistanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mDX, mDX), _mm256_mul_ps(mDY, mDY)), _mm256_mul_ps(mDZ, mDZ));
+            const __m256 mValid           = _mm256_and_ps(_mm256_cmp_ps(mDistanceSquared, _mm256_load_ps(pBatch.radiusSquared + j), _CMP_LT_OQ),
+                                                          _mm256_cmp_ps(mDistanceSquared, mZero, _CMP_GT_OQ));
+            if (_mm256_movemask_ps(mValid) == 0) {
+                continue;
+            }
+            __m256 mInvDistance = _mm256_rsqrt_ps(mDistanceSquared);
+            mInvDistance        = _mm256_mul_ps(mInvDistance,
+                                                _mm256_sub_ps(mThreeHalf, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(mHalf, mDistanceSquared), mInvDistance), mInvDistance)));
+            const __m256 mDistance = _mm256_mul_ps(mDistanceSquared, mInvDistance);
+            const __m256 mFallOff  = _mm256_sub_ps(mOne, _mm256_mul_ps(mDistance, _mm256_load_ps(pBatch.inverseRadius + j)));
+            const __m256 mForce    = _mm256_and_ps(mValid,
+                                                   _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(mFallOff, mFallOff), _mm256_load_ps(pBatch.strength + j)), mInvDistance));
+            mFX = _mm256_add_ps(mFX, _mm256_mul_ps(mDX, mForce));
+            mFY = _mm256_add_ps(mFY, _mm256_mul_ps(mDY, mForce));
+            mFZ = _mm256_add_ps(mFZ, _mm256_mul_ps(mDZ, mForce));
+        }
+        fx = sum(mFX);
+        fy = sum(mFY);
+        fz = sum(mFZ);
+#endif
+        for (; j < pCount; ++j) {
+            const float mDX              = pBatch.x[j] - pX;
+            const float mDY              = pBatch.y[j] - pY;
+            const float mDZ              = pBatch.z[j] - pZ;
+            const float mDistanceSquared = mDX * mDX + mDY * mDY + mDZ * mDZ;
+            if (mDistanceSquared >= pBatch.radiusSquared[j] || mDistanceSquared <= 0.0f) {
+                continue;
+            }
+            const float mInvDistance = Util::fastInverseSqrt(mDistanceSquared);
+            const float mFallOff     = 1.0f - mDistanceSquared * mInvDistance * pBatch.inverseRadius[j];
+            const float mForce       = mFallOff * mFallOff * pBatch.strength[j] * mInvDistance;
+            fx += mDX * mForce;
+            fy += mDY * mForce;
+            fz += mDZ * mForce;
+        }
+        pFX += fx;
+        pFY += fy;
+        pFZ += fz;
+    }
+} // namespace
+
+void AttractorField::apply(float pDeltaTime, Physics& pParticleSystem, const size_t pBegin, const size_t pEnd) {
+    (void) pDeltaTime;
+    if (mX.empty()) {
+        return;
+    }
+
+    const std::vector<Particle*>& mParticles = pParticleSystem.particles();
+    ParticleStore*                mStore     = pParticleSystem.packed();
+
+    Batch    mBatch;
+    uint32_t mIndices[BLOCK_SIZE];
+    float    mPX[BLOCK_SIZE];
+    float    mPY[BLOCK_SIZE];
+    float    mPZ[BLOCK_SIZE];
+    float    mFX[BLOCK_SIZE];
+    float    mFY[BLOCK_SIZE];
+    float    mFZ[BLOCK_SIZE];
+
+    for (size_t mBlock = pBegin; mBlock < pEnd; mBlock += BLOCK_SIZE) {
+        const size_t mBlockEnd = std::min(mBlock + BLOCK_SIZE, pEnd);
+
+        /* gather the positions of all movable particles of the block */
+        size_t mCount = 0;
+        if (mStore != nullptr) {
+            const PVector* mPositions = mStore->positions();
+            const uint8_t* mFlags     = mStore->flags();
+            for (size_t i = mBlock; i < mBlockEnd; ++i) {
+                if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+                    mIndices[mCount] = static_cast<uint32_t>(i - mBlock);
+                    mPX[mCount]      = mPositions[i].x;
+                    mPY[mCount]      = mPositions[i].y;
+                    mPZ[mCount]      = mPositions[i].z;
+                    ++mCount;
+                }
+            }
+        } else {
+            for (size_t i = mBlock; i < mBlockEnd; ++i) {
+                Particle* mParticle = mParticles[i];
+                if (!mParticle->fixed()) {
+                    const PVector& mPosition = mParticle->position();
+                    mIndices[mCount]         = static_cast<uint32_t>(i - mBlock);
+                    mPX[mCount]              = mPosition.x;
+                    mPY[mCount]              = mPosition.y;
+                    mPZ[mCount]              = mPosition.z;
+                    ++mCount;
+                }
+            }
+        }
+        if (mCount == 0) {
+            continue;
+        }
+
+        PVector mMin(mPX[0], mPY[0], mPZ[0]);
+        PVector mMax(mMin);
+        for (size_t k = 1; k < mCount; ++k) {
+            mMin.x = std::min(mMin.x, mPX[k]);
+            mMin.y = std::min(mMin.y, mPY[k]);
+            mMin.z = std::min(mMin.z, mPZ[k]);
+            mMax.x = std::max(mMax.x, mPX[k]);
+            mMax.y = std::max(mMax.y, mPY[k]);
+            mMax.z = std::max(mMax.z, mPZ[k]);
+        }
+        std::fill_n(mFX, mCount, 0.0f);
+        std::fill_n(mFY, mCount, 0.0f);
+        std::fill_n(mFZ, mCount, 0.0f);
+
+        for (size_t mFirst = 0; mFirst < mX.size(); mFirst += BATCH_SIZE) {
+            const size_t mLast = std::min(mFirst + BATCH_SIZE, mX.size());
+
+            /* skip attractors whose radius does not reach the bounding box of the block */
+            size_t mActiveCount = 0;
+            for (size_t j = mFirst; j < mLast; ++j) {
+                const float mRadius = mRadii[j];
+                if (mStrengths[j] == 0 || mRadius <= 0) {
+                    continue;
+                }
+                const float mDX = std::max({mMin.x - mX[j], 0.0f, mX[j] - mMax.x});
+                const float mDY = std::max({mMin.y - mY[j], 0.0f, mY[j] - mMax.y});
+                const float mDZ = std::max({mMin.z - mZ[j], 0.0f, mZ[j] - mMax.z});
+                if (mDX * mDX + mDY * mDY + mDZ * mDZ >= mRadius * mRadius) {
+                    continue;
+                }
+                mBatch.x[mActiveCount]             = mX[j];
+                mBatch.y[mActiveCount]             = mY[j];
+                mBatch.z[mActiveCount]             = mZ[j];
+                mBatch.radiusSquared[mActiveCount] = mRadius * mRadius;
+                mBatch.inverseRadius[mActiveCount] = 1.0f / mRadius;
+                mBatch.strength[mActiveCount]      = mStrengths[j];
+                ++mActiveCount;
+            }
+            if (mActiveCount == 0) {
+                continue;
+            }
+            /* padding attractors never reach a particle */
+            for (; mActiveCount % 8 != 0; ++mActiveCount) {
+                mBatch.x[mActiveCount]             = 0;
+                mBatch.y[mActiveCount]             = 0;
+                mBatch.z[mActiveCount]             = 0;
+                mBatch.radiusSquared[mActiveCount] = 0;
+                mBatch.inverseRadius[mActiveCount] = 0;
+                mBatch.strength[mActiveCount]      = 0;
+            }
+
+            for (size_t k = 0; k < mCount; ++k) {
+                attract(mBatch, mActiveCount, mPX[k], mPY[k], mPZ[k], mFX[k], mFY[k], mFZ[k]);
+            }
+        }
+
+        /* scatter the accumulated forces */
+        if (mStore != nullptr) {
+            PVector* mForces = mStore->forces() + mBlock;
+            for (size_t k = 0; k < mCount; ++k) {
+                mForces[mIndices[k]].add(mFX[k], mFY[k], mFZ[k]);
+            }
+        } else {
+            for (size_t k = 0; k < mCount; ++k) {
+                mParticles[mBlock + mIndices[k]]->force().add(mFX[k], mFY[k], mFZ[k]);
+            }
+        }
+    }
+}
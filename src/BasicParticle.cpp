@@ -0,0 +1,40 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include "BasicParticle.h"
+#include "Physics.h"
+
+BasicParticle::BasicParticle()
+    : mAge(0),
+      mDead(false),
+      mFixed(false),
+      mForce(0, 0, 0),
+      mID(Physics::getUniqueID()),
+      mMass(1.0f),
+      mOldPosition(0, 0, 0),
+      mPosition(0, 0, 0),
+      mRadius(0.0f),
+      mStill(false),
+      mTagged(false),
+      mVelocity(0, 0, 0) {}
@@ -0,0 +1,224 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "DormandPrince.h"
+
+namespace {
+    /* butcher tableau of dormand-prince 5(4), the last row equals the 5th order weights */
+    constexpr float A[7][6] = {
+        {},
+        {1.0f / 5.0f},
+        {3.0f / 40.0f, 9.0f / 40.0f},
+        {44.0f / 45.0f, -56.0f / 15.0f, 32.0f / 9.0f},
+        {19372.0f / 6561.0f, -25360.0f / 2187.0f, 64448.0f / 6561.0f, -212.0f / 729.0f},
+        {9017.0f / 3168.0f, -355.0f / 33.0f, 46732.0f / 5247.0f, 49.0f / 176.0f, -5103.0f / 18656.0f},
+        {35.0f / 384.0f, 0.0f, 500.0f / 1113.0f, 125.0f / 192.0f, -2187.0f / 6784.0f, 11.0f / 84.0f},
+    };
+
+    /* difference between the 5th and the embedded 4th order weights */
+    constexpr float E[7] = {
+        71.0f / 57600.0f, 0.0f, -71.0f / 16695.0f, 71.0f / 1920.0f, -17253.0f / 339200.0f, 22.0f / 525.0f,
+        -1.0f / 40.0f};
+
+    constexpr float MIN_FACTOR = 0.2f;
+    constexpr float MAX_FACTOR = 5.0f;
+
+    float scale(const float pTolerance, const float a, const float b) {
+        return pTolerance * (1.0f + std::max(std::abs(a), std::abs(b)));
+    }
+} // namespace
+
+void DormandPrince::step(const float pDeltaTime, Physics& pParticleSystem) {
+    mEvaluations = 0;
+    mSubsteps    = 0;
+    mRejected    = 0;
+
+    collect(pParticleSystem);
+    if (mPositions.empty() || pDeltaTime <= 0.0f) {
+        pParticleSystem.applyForces(pDeltaTime);
+        return;
+    }
+
+    const size_t mSize = mPositions.size();
+    for (auto& k: mKPositions) {
+        k.resize(mSize);
+    }
+    for (auto& k: mKVelocities) {
+        k.resize(mSize);
+    }
+    mOriginalPositions.resize(mSize);
+    mOriginalVelocities.resize(mSize);
+    for (size_t i = 0; i < mSize; ++i) {
+        mOriginalPositions[i]  = *mPositions[i];
+        mOriginalVelocities[i] = *mVelocities[i];
+    }
+
+    float mSubstep  = std::clamp(mStep > 0.0f ? mStep : pDeltaTime, mMinStep, mMaxStep);
+    float mTime     = 0.0f;
+    bool  mHasFirst = false;
+    bool  mRetry    = false;
+    while (mTime < pDeltaTime) {
+        float      h     = mSubstep;
+        const bool mLast = mTime + h >= pDeltaTime * (1.0f - 1e-5f);
+        if (mLast) {
+            h = pDeltaTime - mTime;
+        }
+
+        /* first same as last: the final stage of an accepted substep is the first stage of the next */
+        if (!mHasFirst) {
+            evaluate(h, pParticleSystem, 0);
+            mHasFirst = true;
+        }
+        for (int s = 1; s < NUM_STAGES; ++s) {
+            advance(h, s);
+            evaluate(h, pParticleSystem, s);
+        }
+
+        const float mError  = error(h);
+        float       mFactor = mError > 0.0f ? mSafety * std::pow(mError, -0.2f) : mError == 0.0f ? MAX_FACTOR : MIN_FACTOR;
+        mFactor             = std::clamp(mFactor, MIN_FACTOR, MAX_FACTOR);
+
+        if (mError <= 1.0f || h <= mMinStep) {
+            mTime += h;
+            mSubsteps++;
+            std::swap(mKPositions[0], mKPositions[NUM_STAGES - 1]);
+            std::swap(mKVelocities[0], mKVelocities[NUM_STAGES - 1]);
+            for (size_t i = 0; i < mSize; ++i) {
+                mOriginalPositions[i]  = *mPositions[i];
+                mOriginalVelocities[i] = *mVelocities[i];
+            }
+            if (mRetry) {
+                mFactor = std::min(mFactor, 1.0f);
+                mRetry  = false;
+            }
+            /* a substep shortened to end the frame does not limit the next one */
+            const float mNext = h * mFactor;
+            mSubstep          = std::clamp(mLast && h < mSubstep ? std::min(mSubstep, mNext) : mNext, mMinStep, mMaxStep);
+            if (mLast) {
+                break;
+            }
+        } else {
+            mRejected++;
+            mRetry = true;
+            for (size_t i = 0; i < mSize; ++i) {
+                *mPositions[i]  = mOriginalPositions[i];
+                *mVelocities[i] = mOriginalVelocities[i];
+            }
+            mSubstep = std::max(h * mFactor, mMinStep);
+        }
+    }
+    mStep = mSubstep;
+}
+
+void DormandPrince::collect(Physics& pParticleSystem) {
+    mPositions.clear();
+    mVelocities.clear();
+    mForces.clear();
+    mInverseMasses.clear();
+    if (ParticleStore* mStore = pParticleSystem.packed()) {
+        const uint8_t* mFlags         = mStore->flags();
+        const float*   mInverseMass   = mStore->inverse_masses();
+        PVector*       mStorePosition = mStore->positions();
+        PVector*       mStoreVelocity = mStore->velocities();
+        PVector*       mStoreForce    = mStore->forces();
+        for (size_t i = 0; i < mStore->size(); ++i) {
+            if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+                mPositions.push_back(&mStorePosition[i]);
+                mVelocities.push_back(&mStoreVelocity[i]);
+                mForces.push_back(&mStoreForce[i]);
+                mInverseMasses.push_back(mInverseMass[i]);
+            }
+        }
+        return;
+    }
+    for (const auto& mParticle: pParticleSystem.particles()) {
+        if (!mParticle->fixed()) {
+            mPositions.push_back(&mParticle->position());
+            mVelocities.push_back(&mParticle->velocity());
+            mForces.push_back(&mParticle->force());
+            mInverseMasses.push_back(1.0f / mParticle->mass());
+        }
+    }
+}
+
+void DormandPrince::evaluate(const float pDeltaTime, Physics& pParticleSystem, const int pStage) {
+    for (auto* mForce: mForces) {
+        mForce->set(0, 0, 0);
+    }
+    pParticleSystem.applyForces(pDeltaTime);
+    mEvaluations++;
+    PVector* mKPosition = mKPositions[pStage].data();
+    PVector* mKVelocity = mKVelocities[pStage].data();
+    for (size_t i = 0; i < mPositions.size(); ++i) {
+        const PVector& f = *mForces[i];
+        mKPosition[i]    = *mVelocities[i];
+        mKVelocity[i].set(f.x * mInverseMasses[i], f.y * mInverseMasses[i], f.z * mInverseMasses[i]);
+    }
+}
+
+void DormandPrince::advance(const float pDeltaTime, const int pStage) {
+    const float* a = A[pStage];
+    for (size_t i = 0; i < mPositions.size(); ++i) {
+        PVector p = mOriginalPositions[i];
+        PVector v = mOriginalVelocities[i];
+        for (int j = 0; j < pStage; ++j) {
+            const float    w  = a[j] * pDeltaTime;
+            const PVector& kp = mKPositions[j][i];
+            const PVector& kv = mKVelocities[j][i];
+            p.add(kp.x * w, kp.y * w, kp.z * w);
+            v.add(kv.x * w, kv.y * w, kv.z * w);
+        }
+        *mPositions[i]  = p;
+        *mVelocities[i] = v;
+    }
+}
+
+float DormandPrince::error(const float pDeltaTime) const {
+    float mError = 0.0f;
+    for (size_t i = 0; i < mPositions.size(); ++i) {
+        PVector ep, ev;
+        for (int j = 0; j < NUM_STAGES; ++j) {
+            const PVector& kp = mKPositions[j][i];
+            const PVector& kv = mKVelocities[j][i];
+            ep.add(kp.x * E[j], kp.y * E[j], kp.z * E[j]);
+            ev.add(kv.x * E[j], kv.y * E[j], kv.z * E[j]);
+        }
+        if (std::isnan(ep.x + ep.y + ep.z + ev.x + ev.y + ev.z)) {
+            return NAN;
+        }
+        const PVector& p0 = mOriginalPositions[i];
+        const PVector& v0 = mOriginalVelocities[i];
+        const PVector& p1 = *mPositions[i];
+        const PVector& v1 = *mVelocities[i];
+        mError = std::max({mError,
+                           std::abs(ep.x * pDeltaTime) / scale(mTolerance, p0.x, p1.x),
+                           std::abs(ep.y * pDeltaTime) / scale(mTolerance, p0.y, p1.y),
+                           std::abs(ep.z * pDeltaTime) / scale(mTolerance, p0.z, p1.z),
+                           std::abs(ev.x * pDeltaTime) / scale(mTolerance, v0.x, v1.x),
+                           std::abs(ev.y * pDeltaTime) / scale(mTolerance, v0.y, v1.y),
+                           std::abs(ev.z * pDeltaTime) / scale(mTolerance, v0.z, v1.z)});
+    }
+    return mError;
+}
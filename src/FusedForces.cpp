@@ -0,0 +1,246 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include <algorithm>
+#include <cstdint>
+#include <typeinfo>
+
+#include "FusedForces.h"
+#include "Attractor.h"
+#include "Gravity.h"
+#include "Physics.h"
+#include "Util.h"
+#include "ViscousDrag.h"
+#include "Verlet.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* positions of one block of particles in structure-of-arrays layout, gathered once and shared by all attractors */
+struct FusedForces::Block {
+    size_t begin;
+    size_t count;
+    bool   loaded;
+    float  x[BLOCK_SIZE];
+    float  y[BLOCK_SIZE];
+    float  z[BLOCK_SIZE];
+};
+
+bool FusedForces::build(const std::vector<ParticleForce*>& pBatch, Physics& pParticleSystem) {
+    mOperations.clear();
+    mOnlyBuiltIn  = true;
+    bool mBuiltIn = false;
+    for (const auto& f: pBatch) {
+        Operation mOperation{OTHER, PVector(), 0, 0, f};
+        /* only exact types are translated, subclasses may override `apply` */
+        if (typeid(*f) == typeid(Gravity)) {
+            mOperation.type   = GRAVITY;
+            mOperation.vector = static_cast<Gravity*>(f)->force();
+        } else if (typeid(*f) == typeid(ViscousDrag)) {
+            const auto mDrag = static_cast<ViscousDrag*>(f);
+            if (dynamic_cast<Verlet*>(pParticleSystem.getIntegrator()) != nullptr || mDrag->coefficient == 0) {
+                continue;
+            }
+            mOperation.type     = VISCOUS_DRAG;
+            mOperation.strength = mDrag->coefficient;
+        } else if (typeid(*f) == typeid(Attractor)) {
+            const auto mAttractor = static_cast<Attractor*>(f);
+            if (mAttractor->strength() == 0) {
+                continue;
+            }
+            mOperation.type     = ATTRACTOR;
+            mOperation.vector   = mAttractor->position();
+            mOperation.radius   = mAttractor->radius();
+            mOperation.strength = mAttractor->strength();
+        }
+        mBuiltIn |= mOperation.type != OTHER;
+        mOnlyBuiltIn &= mOperation.type != OTHER;
+        mOperations.push_back(mOperation);
+    }
+    return mBuiltIn;
+}
+
+void FusedForces::apply(const float    pDeltaTime,
+                        Physics&       pParticleSystem,
+                        ParticleStore& pStore,
+                        const size_t   pBegin,
+                        const size_t   pEnd) const {
+    PVector*       mForces     = pStore.forces();
+    const PVector* mVelocities = pStore.velocities();
+    const uint8_t* mFlags      = pStore.flags();
+    Block          mBlock;
+    for (size_t mFirst = pBegin; mFirst < pEnd; mFirst += BLOCK_SIZE) {
+        const size_t mLast = std::min(mFirst + BLOCK_SIZE, pEnd);
+        mBlock.begin       = mFirst;
+        mBlock.count       = mLast - mFirst;
+        mBlock.loaded      = false;
+        for (const auto& o: mOperations) {
+            switch (o.type) {
+                case GRAVITY: {
+                    const PVector mGravity = o.vector;
+                    for (size_t i = mFirst; i < mLast; ++i) {
+                        if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+                            mForces[i].add(mGravity);
+                        }
+                    }
+                    break;
+                }
+                case VISCOUS_DRAG: {
+                    const float mCoefficient = o.strength;
+                    for (size_t i = mFirst; i < mLast; ++i) {
+                        if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+                            mForces[i].add(mVelocities[i].x * -mCoefficient,
+                                           mVelocities[i].y * -mCoefficient,
+                                           mVelocities[i].z * -mCoefficient);
+                        }
+                    }
+                    break;
+                }
+                case ATTRACTOR:
+                    attract(o, pStore, mBlock);
+                    break;
+                case OTHER:
+                    o.force->apply(pDeltaTime, pParticleSystem, mFirst, mLast);
+                    mBlock.loaded = false;
+                    break;
+            }
+        }
+    }
+}
+
+namespace {
+    void attractParticle(const PVector& pCenter, const float pRadius, const float pStrength, const PVector& pPosition, PVector& pForce) {
+        const float mX        = pCenter.x - pPosition.x;
+        const float mY        = pCenter.y - pPosition.y;
+        const float mZ        = pCenter.z - pPosition.z;
+        const float mDistance = Util::fastInverseSqrt(1.0f / (mX * mX + mY * mY + mZ * mZ));
+        if (mDistance < pRadius) {
+            const float mFallOff = 1.0f - mDistance / pRadius;
+            const float mScale   = mFallOff * mFallOff * pStrength / mDistance;
+            pForce.add(mX * mScale, mY * mScale, mZ * mScale);
+        }
+    }
+} // namespace
+
+void FusedForces::applyAwake(ParticleStore& pStore, const size_t pBegin, const size_t pEnd) const {
+    PVector*        mForces     = pStore.forces();
+    const PVector*  mPositions  = pStore.positions();
+    const PVector*  mVelocities = pStore.velocities();
+    const uint8_t*  mFlags      = pStore.flags();
+    const uint32_t* mAwake      = pStore.awake();
+    for (size_t mFirst = pBegin; mFirst < pEnd; mFirst += BLOCK_SIZE) {
+        const size_t mLast = std::min(mFirst + BLOCK_SIZE, pEnd);
+        for (const auto& o: mOperations) {
+            for (size_t k = mFirst; k < mLast; ++k) {
+                const uint32_t i = mAwake[k];
+                if (mFlags[i] & ParticleStore::FIXED) {
+                    continue;
+                }
+                switch (o.type) {
+                    case GRAVITY:
+                        mForces[i].add(o.vector);
+                        break;
+                    case VISCOUS_DRAG:
+                        mForces[i].add(mVelocities[i].x * -o.strength,
+                                       mVelocities[i].y * -o.strength,
+                                       mVelocities[i].z * -o.strength);
+                        break;
+                    case ATTRACTOR:
+                        attractParticle(o.vector, o.radius, o.strength, mPositions[i], mForces[i]);
+                        break;
+                    case OTHER:
+                        break;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * mirrors `Attractor::attract` operation by operation. the AVX2 path evaluates 8 particles per iteration on the
+ * gathered positions of the block and adds `-0` to particles outside of the radius, which leaves their forces
+ * unchanged. the scalar loop handles the remainder and all other targets.
+ */
+void FusedForces::attract(const Operation& pOperation, ParticleStore& pStore, Block& pBlock) {
+    PVector*       mForces    = pStore.forces() + pBlock.begin;
+    const PVector* mPositions = pStore.positions() + pBlock.begin;
+    const uint8_t* mFlags     = pStore.flags() + pBlock.begin;
+    const PVector  mCenter    = pOperation.vector;
+    const float    mRadius    = pOperation.radius;
+    const float    mStrength  = pOperation.strength;
+    size_t         k          = 0;
+#if defined(__AVX2__)
+    if (!pBlock.loaded) {
+        for (size_t j = 0; j < pBlock.count; ++j) {
+            pBlock.x[j] = mPositions[j].x;
+            pBlock.y[j] = mPositions[j].y;
+            pBlock.z[j] = mPositions[j].z;
+        }
+        pBlock.loaded = true;
+    }
+    const __m256  mOne       = _mm256_set1_ps(1.0f);
+    const __m256  mHalf      = _mm256_set1_ps(0.5f);
+    const __m256  mThreeHalf = _mm256_set1_ps(1.5f);
+    const __m256  mNegZero   = _mm256_set1_ps(-0.0f);
+    const __m256i mMagic     = _mm256_set1_epi32(0x5f375a86);
+    const __m256  mCenterX   = _mm256_set1_ps(mCenter.x);
+    const __m256  mCenterY   = _mm256_set1_ps(mCenter.y);
+    const __m256  mCenterZ   = _mm256_set1_ps(mCenter.z);
+    const __m256  mRadii     = _mm256_set1_ps(mRadius);
+    const __m256  mStrengths = _mm256_set1_ps(mStrength);
+    alignas(32) float mFX[8];
+    alignas(32) float mFY[8];
+    alignas(32) float mFZ[8];
+    for (; k + 8 <= pBlock.count; k += 8) {
+        const __m256 mX = _mm256_sub_ps(mCenterX, _mm256_loadu_ps(pBlock.x + k));
+        const __m256 mY = _mm256_sub_ps(mCenterY, _mm256_loadu_ps(pBlock.y + k));
+        const __m256 mZ = _mm256_sub_ps(mCenterZ, _mm256_loadu_ps(pBlock.z + k));
+        const __m256 mInverseDistanceSquared =
+            _mm256_div_ps(mOne, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mX, mX), _mm256_mul_ps(mY, mY)), _mm256_mul_ps(mZ, mZ)));
+        const __m256 mHalfValue = _mm256_mul_ps(mHalf, mInverseDistanceSquared);
+        const __m256 mGuess     = _mm256_castsi256_ps(_mm256_sub_epi32(mMagic, _mm256_srai_epi32(_mm256_castps_si256(mInverseDistanceSquared), 1)));
+        const __m256 mDistance  = _mm256_mul_ps(mGuess, _mm256_sub_ps(mThreeHalf, _mm256_mul_ps(_mm256_mul_ps(mHalfValue, mGuess), mGuess)));
+        const __m256 mInside    = _mm256_cmp_ps(mDistance, mRadii, _CMP_LT_OQ);
+        if (_mm256_movemask_ps(mInside) == 0) {
+            continue;
+        }
+        const __m256 mFallOff = _mm256_sub_ps(mOne, _mm256_div_ps(mDistance, mRadii));
+        const __m256 mScale   = _mm256_div_ps(_mm256_mul_ps(_mm256_mul_ps(mFallOff, mFallOff), mStrengths), mDistance);
+        _mm256_store_ps(mFX, _mm256_blendv_ps(mNegZero, _mm256_mul_ps(mX, mScale), mInside));
+        _mm256_store_ps(mFY, _mm256_blendv_ps(mNegZero, _mm256_mul_ps(mY, mScale), mInside));
+        _mm256_store_ps(mFZ, _mm256_blendv_ps(mNegZero, _mm256_mul_ps(mZ, mScale), mInside));
+        for (size_t j = 0; j < 8; ++j) {
+            if (!(mFlags[k + j] & ParticleStore::IMMOVABLE)) {
+                mForces[k + j].add(mFX[j], mFY[j], mFZ[j]);
+            }
+        }
+    }
+#endif
+    for (; k < pBlock.count; ++k) {
+        if (!(mFlags[k] & ParticleStore::IMMOVABLE)) {
+            attractParticle(mCenter, mRadius, mStrength, mPositions[k], mForces[k]);
+        }
+    }
+}
@@ -0,0 +1,241 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <cmath>
+#include "ImplicitEuler.h"
+#include "Spring.h"
+
+namespace {
+    double dot(const std::vector<PVector>& a, const std::vector<PVector>& b) {
+        double mSum = 0.0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            mSum += static_cast<double>(a[i].x) * b[i].x + static_cast<double>(a[i].y) * b[i].y + static_cast<double>(a[i].z) * b[i].z;
+        }
+        return mSum;
+    }
+} // namespace
+
+void ImplicitEuler::step(const float pDeltaTime, Physics& pParticleSystem) {
+    pParticleSystem.applyForces(pDeltaTime);
+    collect(pParticleSystem);
+    mLastIterations = 0;
+    if (mPositions.empty()) {
+        return;
+    }
+    collectSprings(pDeltaTime, pParticleSystem);
+
+    /* right-hand side `h * ( f + h * df/dx * v )` */
+    const float  h     = pDeltaTime;
+    const float  hh    = pDeltaTime * pDeltaTime;
+    const size_t mSize = mPositions.size();
+    mResiduals.resize(mSize);
+    for (size_t i = 0; i < mSize; ++i) {
+        const PVector& f = *mForces[i];
+        mResiduals[i].set(f.x * h, f.y * h, f.z * h);
+    }
+    for (const auto& s: mSprings) {
+        PVector v;
+        if (s.a >= 0) {
+            v.add(mVelocities[s.a]->x, mVelocities[s.a]->y, mVelocities[s.a]->z);
+        }
+        if (s.b >= 0) {
+            v.sub(*mVelocities[s.b]);
+        }
+        const PVector k(s.xx * v.x + s.xy * v.y + s.xz * v.z,
+                        s.xy * v.x + s.yy * v.y + s.yz * v.z,
+                        s.xz * v.x + s.yz * v.y + s.zz * v.z);
+        if (s.a >= 0) {
+            mResiduals[s.a].add(-k.x * hh, -k.y * hh, -k.z * hh);
+        }
+        if (s.b >= 0) {
+            mResiduals[s.b].add(k.x * hh, k.y * hh, k.z * hh);
+        }
+    }
+
+    solve(pDeltaTime);
+
+    for (size_t i = 0; i < mSize; ++i) {
+        PVector&       v  = *mVelocities[i];
+        const PVector& dv = mDeltaVelocities[i];
+        v.add(dv.x, dv.y, dv.z);
+        mPositions[i]->add(v.x * h, v.y * h, v.z * h);
+    }
+}
+
+void ImplicitEuler::collect(Physics& pParticleSystem) {
+    mPositions.clear();
+    mVelocities.clear();
+    mForces.clear();
+    mMasses.clear();
+    mIndices.clear();
+    for (const auto& mParticle: pParticleSystem.particles()) {
+        if (!mParticle->fixed() && !mParticle->sleeping()) {
+            mIndices[mParticle] = static_cast<int>(mPositions.size());
+            mPositions.push_back(&mParticle->position());
+            mVelocities.push_back(&mParticle->velocity());
+            mForces.push_back(&mParticle->force());
+            mMasses.push_back(mParticle->mass());
+        }
+    }
+}
+
+void ImplicitEuler::collectSprings(const float pDeltaTime, Physics& pParticleSystem) {
+    mSprings.clear();
+    for (auto* mForce: pParticleSystem.forces()) {
+        auto* mSpring = dynamic_cast<Spring*>(mForce);
+        if (mSpring == nullptr || !mSpring->active() || mSpring->dead() || mSpring->oneway()) {
+            continue;
+        }
+        /* fixed particles and particles outside of the system keep their velocity */
+        const auto a = mIndices.find(mSpring->a());
+        const auto b = mIndices.find(mSpring->b());
+        SpringBlock s{};
+        s.a = a == mIndices.end() ? -1 : a->second;
+        s.b = b == mIndices.end() ? -1 : b->second;
+        if (s.a < 0 && s.b < 0) {
+            continue;
+        }
+        const PVector mAB       = PVector::sub(mSpring->a()->position(), mSpring->b()->position());
+        const float   mDistance = mAB.mag();
+        if (mDistance == 0.0f) {
+            continue;
+        }
+        const float nx = mAB.x / mDistance;
+        const float ny = mAB.y / mDistance;
+        const float nz = mAB.z / mDistance;
+        const float k  = mSpring->strength();
+        /* the transverse term is dropped for compressed springs to keep the system positive definite */
+        const float t = k * std::max(0.0f, 1.0f - mSpring->restlength() / mDistance);
+        const float l = k - t;
+        s.xx          = l * nx * nx + t;
+        s.xy          = l * nx * ny;
+        s.xz          = l * nx * nz;
+        s.yy          = l * ny * ny + t;
+        s.yz          = l * ny * nz;
+        s.zz          = l * nz * nz + t;
+        /* `Spring` damps each axis separately, which makes its velocity jacobian diagonal */
+        const float c = mSpring->damping();
+        s.dx          = c * nx * nx;
+        s.dy          = c * ny * ny;
+        s.dz          = c * nz * nz;
+        mSprings.push_back(s);
+    }
+
+    /* jacobi preconditioner */
+    const float h  = pDeltaTime;
+    const float hh = pDeltaTime * pDeltaTime;
+    mInverseDiagonal.resize(mPositions.size());
+    for (size_t i = 0; i < mPositions.size(); ++i) {
+        mInverseDiagonal[i].set(mMasses[i], mMasses[i], mMasses[i]);
+    }
+    for (const auto& s: mSprings) {
+        const float x = s.dx * h + s.xx * hh;
+        const float y = s.dy * h + s.yy * hh;
+        const float z = s.dz * h + s.zz * hh;
+        if (s.a >= 0) {
+            mInverseDiagonal[s.a].add(x, y, z);
+        }
+        if (s.b >= 0) {
+            mInverseDiagonal[s.b].add(x, y, z);
+        }
+    }
+    for (auto& d: mInverseDiagonal) {
+        d.set(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+    }
+}
+
+void ImplicitEuler::multiply(const float pDeltaTime, const std::vector<PVector>& pVector, std::vector<PVector>& pResult) const {
+    const float h  = pDeltaTime;
+    const float hh = pDeltaTime * pDeltaTime;
+    for (size_t i = 0; i < pVector.size(); ++i) {
+        pResult[i].set(pVector[i].x * mMasses[i], pVector[i].y * mMasses[i], pVector[i].z * mMasses[i]);
+    }
+    for (const auto& s: mSprings) {
+        PVector v;
+        if (s.a >= 0) {
+            v.add(pVector[s.a].x, pVector[s.a].y, pVector[s.a].z);
+        }
+        if (s.b >= 0) {
+            v.sub(pVector[s.b]);
+        }
+        const PVector j((s.xx * v.x + s.xy * v.y + s.xz * v.z) * hh + s.dx * v.x * h,
+                        (s.xy * v.x + s.yy * v.y + s.yz * v.z) * hh + s.dy * v.y * h,
+                        (s.xz * v.x + s.yz * v.y + s.zz * v.z) * hh + s.dz * v.z * h);
+        if (s.a >= 0) {
+            pResult[s.a].add(j.x, j.y, j.z);
+        }
+        if (s.b >= 0) {
+            pResult[s.b].sub(j);
+        }
+    }
+}
+
+void ImplicitEuler::solve(const float pDeltaTime) {
+    const size_t mSize = mResiduals.size();
+    mDeltaVelocities.assign(mSize, PVector());
+    mDirections.resize(mSize);
+    mProducts.resize(mSize);
+    mPreconditioned.resize(mSize);
+
+    for (size_t i = 0; i < mSize; ++i) {
+        mPreconditioned[i].set(mResiduals[i].x * mInverseDiagonal[i].x,
+                               mResiduals[i].y * mInverseDiagonal[i].y,
+                               mResiduals[i].z * mInverseDiagonal[i].z);
+        mDirections[i] = mPreconditioned[i];
+    }
+    const double mThreshold = dot(mResiduals, mResiduals) * mTolerance * mTolerance;
+    double       mRZ        = dot(mResiduals, mPreconditioned);
+    if (mThreshold == 0.0) {
+        return;
+    }
+
+    for (int mIteration = 0; mIteration < mIterations; ++mIteration) {
+        mLastIterations++;
+        multiply(pDeltaTime, mDirections, mProducts);
+        const double mPQ = dot(mDirections, mProducts);
+        if (mPQ <= 0.0) {
+            break;
+        }
+        const auto mAlpha = static_cast<float>(mRZ / mPQ);
+        for (size_t i = 0; i < mSize; ++i) {
+            mDeltaVelocities[i].add(mDirections[i].x * mAlpha, mDirections[i].y * mAlpha, mDirections[i].z * mAlpha);
+            mResiduals[i].add(-mProducts[i].x * mAlpha, -mProducts[i].y * mAlpha, -mProducts[i].z * mAlpha);
+        }
+        if (dot(mResiduals, mResiduals) <= mThreshold) {
+            break;
+        }
+        for (size_t i = 0; i < mSize; ++i) {
+            mPreconditioned[i].set(mResiduals[i].x * mInverseDiagonal[i].x,
+                                   mResiduals[i].y * mInverseDiagonal[i].y,
+                                   mResiduals[i].z * mInverseDiagonal[i].z);
+        }
+        const double mRZNext = dot(mResiduals, mPreconditioned);
+        const auto   mBeta   = static_cast<float>(mRZNext / mRZ);
+        mRZ                  = mRZNext;
+        for (size_t i = 0; i < mSize; ++i) {
+            mDirections[i].set(mPreconditioned[i].x + mDirections[i].x * mBeta,
+                               mPreconditioned[i].y + mDirections[i].y * mBeta,
+                               mPreconditioned[i].z + mDirections[i].z * mBeta);
+        }
+    }
+}
@@ -28,6 +28,10 @@
 #include "IntegrationUtil.h"
 
 auto Midpoint::step(const float pDeltaTime, Physics& pParticleSystem) -> void {
+    if (ParticleStore* mStore = pParticleSystem.packed()) {
+        step(pDeltaTime, pParticleSystem, *mStore);
+        return;
+    }
     try {
         // Lock particles and mK1 if necessary for multithreading (use std::mutex in real-world cases)
         const auto& particles = pParticleSystem.particles();
@@ -70,4 +74,29 @@ auto Midpoint::step(const float pDeltaTime, Physics& pParticleSystem) -> void {
     } catch (const std::exception& e) {
         std::cerr << "Exception during midpoint integration: " << e.what() << std::endl;
     }
-}
\ No newline at end of file
+}
+
+auto Midpoint::step(const float pDeltaTime, Physics& pParticleSystem, ParticleStore& pStore) -> void {
+    /* derivatives are evaluated in place. while particles sleep only the awake list is visited */
+    const float mHalfDeltaTime = pDeltaTime / 2.0f;
+    for (int mPass = 0; mPass < 2; ++mPass) {
+        pParticleSystem.applyForces(pDeltaTime);
+
+        const float    mDelta      = mPass == 0 ? mHalfDeltaTime : pDeltaTime;
+        PVector*       mPositions  = pStore.positions();
+        PVector*       mVelocities = pStore.velocities();
+        const PVector* mForces     = pStore.forces();
+        const float*   mMasses     = pStore.masses();
+        pStore.forEachAwake([&](const uint32_t i) {
+            if (!pStore.fixed(i)) {
+                const PVector mVelocity = mVelocities[i];
+                mPositions[i].x += mVelocity.x * mDelta;
+                mPositions[i].y += mVelocity.y * mDelta;
+                mPositions[i].z += mVelocity.z * mDelta;
+                mVelocities[i].x += mForces[i].x / mMasses[i] * mDelta;
+                mVelocities[i].y += mForces[i].y / mMasses[i] * mDelta;
+                mVelocities[i].z += mForces[i].z / mMasses[i] * mDelta;
+            }
+        });
+    }
+}
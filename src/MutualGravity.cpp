@@ -0,0 +1,202 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "MutualGravity.h"
+#include "Physics.h"
+
+MutualGravity::MutualGravity()
+    : mStrength(1.0f),
+      mRadius(100.0f),
+      mTheta(0.5f),
+      mSoftening(1.0f),
+      mFalloff(FALLOFF_ATTRACTOR),
+      mActive(true),
+      mDead(false),
+      mID(Physics::getUniqueID()) {}
+
+void MutualGravity::apply(float pDeltaTime, Physics& pParticleSystem) {
+    (void) pDeltaTime;
+    if (mStrength == 0) {
+        return;
+    }
+    const std::vector<Particle*>& mParticles = pParticleSystem.particles();
+    ParticleStore*                mStore     = pParticleSystem.packed();
+    const auto                    mSize      = static_cast<uint32_t>(mParticles.size());
+    if (mSize < 2) {
+        return;
+    }
+
+    if (mStore != nullptr) {
+        mPositions.assign(mStore->positions(), mStore->positions() + mSize);
+        mMasses.assign(mStore->masses(), mStore->masses() + mSize);
+    } else {
+        mPositions.resize(mSize);
+        mMasses.resize(mSize);
+        for (uint32_t i = 0; i < mSize; ++i) {
+            mPositions[i] = mParticles[i]->position();
+            mMasses[i]    = mParticles[i]->mass();
+        }
+    }
+    mOrder.resize(mSize);
+    for (uint32_t i = 0; i < mSize; ++i) {
+        mOrder[i] = i;
+    }
+    mNodes.clear();
+    build(0, mSize, 0);
+
+    /* every thread computes the attraction for its own range of particles */
+    const auto mTraverse = [&](const size_t pBegin, const size_t pEnd, size_t) {
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            const bool mFixed = mStore != nullptr ? mStore->immovable(static_cast<uint32_t>(i)) : mParticles[i]->fixed();
+            if (mFixed) {
+                continue;
+            }
+            const PVector mForce = mFalloff == FALLOFF_ATTRACTOR ? attraction<FALLOFF_ATTRACTOR>(static_cast<uint32_t>(i)) : attraction<FALLOFF_INVERSE_SQUARE>(static_cast<uint32_t>(i));
+            if (mStore != nullptr) {
+                mStore->force(static_cast<uint32_t>(i)).add(mForce);
+            } else {
+                mParticles[i]->force().add(mForce);
+            }
+        }
+    };
+    if (ThreadPool* mThreadPool = pParticleSystem.threadpool()) {
+        mThreadPool->run(mSize, PARALLEL_GRAIN_SIZE, mTraverse);
+    } else {
+        mTraverse(0, mSize, 0);
+    }
+}
+
+uint32_t MutualGravity::build(const uint32_t pBegin, const uint32_t pEnd, const uint32_t pDepth) {
+    const auto mIndex = static_cast<uint32_t>(mNodes.size());
+    mNodes.emplace_back();
+
+    Node mNode{};
+    mNode.min   = mPositions[mOrder[pBegin]];
+    mNode.max   = mNode.min;
+    mNode.begin = pBegin;
+    mNode.end   = pEnd;
+    PVector mWeighted(0, 0, 0);
+    for (uint32_t k = pBegin; k < pEnd; ++k) {
+        const PVector& p = mPositions[mOrder[k]];
+        const float    m = mMasses[mOrder[k]];
+        mNode.min.set(std::min(mNode.min.x, p.x), std::min(mNode.min.y, p.y), std::min(mNode.min.z, p.z));
+        mNode.max.set(std::max(mNode.max.x, p.x), std::max(mNode.max.y, p.y), std::max(mNode.max.z, p.z));
+        mWeighted.add(PVector::mult(p, m));
+        mNode.mass += m;
+    }
+    mNode.center = mNode.mass != 0 ? PVector::mult(mWeighted, 1.0f / mNode.mass) : PVector::mult(PVector::add(mNode.min, mNode.max), 0.5f);
+    const PVector mExtent = PVector::sub(mNode.max, mNode.min);
+    const float   mSize   = std::max({mExtent.x, mExtent.y, mExtent.z});
+    mNode.sizeSquared     = mSize * mSize;
+    mNode.leaf            = pEnd - pBegin <= LEAF_SIZE || pDepth >= MAX_DEPTH || mSize == 0;
+
+    if (!mNode.leaf) {
+        /* split into octants around the center of the bounds */
+        const PVector mMid    = PVector::mult(PVector::add(mNode.min, mNode.max), 0.5f);
+        uint32_t*     mFirst  = mOrder.data() + pBegin;
+        uint32_t*     mLast   = mOrder.data() + pEnd;
+        uint32_t*     mBounds[9];
+        mBounds[0] = mFirst;
+        mBounds[8] = mLast;
+        mBounds[4] = std::partition(mFirst, mLast, [&](const uint32_t i) { return mPositions[i].x < mMid.x; });
+        for (int h = 0; h < 8; h += 4) {
+            mBounds[h + 2] = std::partition(mBounds[h], mBounds[h + 4], [&](const uint32_t i) { return mPositions[i].y < mMid.y; });
+            for (int q = h; q < h + 4; q += 2) {
+                mBounds[q + 1] = std::partition(mBounds[q], mBounds[q + 2], [&](const uint32_t i) { return mPositions[i].z < mMid.z; });
+            }
+        }
+        for (int o = 0; o < 8; ++o) {
+            if (mBounds[o] != mBounds[o + 1]) {
+                build(static_cast<uint32_t>(mBounds[o] - mOrder.data()), static_cast<uint32_t>(mBounds[o + 1] - mOrder.data()), pDepth + 1);
+            }
+        }
+    }
+    mNode.next     = static_cast<uint32_t>(mNodes.size());
+    mNodes[mIndex] = mNode;
+    return mIndex;
+}
+
+template<MutualGravity::Falloff F>
+void MutualGravity::interact(const PVector& pPosition, const PVector& pCenter, const float pMass, PVector& pForce) const {
+    const float dx               = pCenter.x - pPosition.x;
+    const float dy               = pCenter.y - pPosition.y;
+    const float dz               = pCenter.z - pPosition.z;
+    const float mDistanceSquared = dx * dx + dy * dy + dz * dz;
+    if (mDistanceSquared == 0 || mDistanceSquared >= mRadius * mRadius) {
+        return;
+    }
+    float mScale;
+    if (F == FALLOFF_ATTRACTOR) {
+        const float mInverseDistance = 1.0f / std::sqrt(mDistanceSquared);
+        const float mFallOff         = 1.0f - mDistanceSquared * mInverseDistance / mRadius;
+        mScale                       = mFallOff * mFallOff * mStrength * pMass * mInverseDistance;
+    } else {
+        const float mSoftened = mDistanceSquared + mSoftening * mSoftening;
+        mScale                = mStrength * pMass / (mSoftened * std::sqrt(mSoftened));
+    }
+    pForce.x += dx * mScale;
+    pForce.y += dy * mScale;
+    pForce.z += dz * mScale;
+}
+
+template<MutualGravity::Falloff F>
+PVector MutualGravity::attraction(const uint32_t pParticle) const {
+    const PVector& mPosition      = mPositions[pParticle];
+    const float    mRadiusSquared = mRadius * mRadius;
+    const float    mThetaSquared  = mTheta * mTheta;
+    PVector        mForce(0, 0, 0);
+    uint32_t       n = 0;
+    while (n < mNodes.size()) {
+        const Node& mNode = mNodes[n];
+        /* skip nodes that lie entirely outside of the radius */
+        const float dx = std::max({mNode.min.x - mPosition.x, 0.0f, mPosition.x - mNode.max.x});
+        const float dy = std::max({mNode.min.y - mPosition.y, 0.0f, mPosition.y - mNode.max.y});
+        const float dz = std::max({mNode.min.z - mPosition.z, 0.0f, mPosition.z - mNode.max.z});
+        if (dx * dx + dy * dy + dz * dz >= mRadiusSquared) {
+            n = mNode.next;
+            continue;
+        }
+        if (mNode.sizeSquared < mThetaSquared * PVector::sub(mNode.center, mPosition).magSq()) {
+            interact<F>(mPosition, mNode.center, mNode.mass, mForce);
+            n = mNode.next;
+        } else if (mNode.leaf) {
+            for (uint32_t k = mNode.begin; k < mNode.end; ++k) {
+                const uint32_t j = mOrder[k];
+                if (j != pParticle) {
+                    interact<F>(mPosition, mPositions[j], mMasses[j], mForce);
+                }
+            }
+            n = mNode.next;
+        } else {
+            ++n;
+        }
+    }
+    if (F == FALLOFF_INVERSE_SQUARE) {
+        mForce.mult(mMasses[pParticle]);
+    }
+    return mForce;
+}
@@ -0,0 +1,129 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include <cmath>
+
+#include "ParticleCollision.h"
+#include "Physics.h"
+#include "Verlet.h"
+
+ParticleCollision::ParticleCollision()
+    : mCoefficientOfRestitution(1.0f),
+      mID(Physics::getUniqueID()),
+      mIterations(1) {}
+
+void ParticleCollision::apply(Physics& pParticleSystem) {
+    mContacts = 0;
+    if (!mActive) {
+        return;
+    }
+
+    /* broadphase over all particles with a radius */
+    float mMaxRadius = 0.0f;
+    mCandidates.clear();
+    for (const auto& p: pParticleSystem.particles()) {
+        if (p->radius() > 0.0f) {
+            mCandidates.push_back(p);
+            mMaxRadius = std::max(mMaxRadius, p->radius());
+        }
+    }
+    if (mCandidates.size() < 2) {
+        return;
+    }
+    mGrid.cell_size(2.0f * mMaxRadius);
+    mGrid.build(mCandidates, pParticleSystem.threadpool());
+    mGrid.pairs(2.0f * mMaxRadius, mPairs, pParticleSystem.threadpool());
+
+    /* overlaps are resolved on copies in cell order, only particles that were moved are written back */
+    const bool                    mVerlet    = dynamic_cast<Verlet*>(pParticleSystem.getIntegrator()) != nullptr;
+    const std::vector<Particle*>& mParticles = mGrid.particles();
+    const size_t                  mSize      = mParticles.size();
+    mPositions.assign(mGrid.positions().begin(), mGrid.positions().end());
+    mVelocities.resize(mSize);
+    mRadii.resize(mSize);
+    mInverseMasses.resize(mSize);
+    mTouched.assign(mSize, 0);
+    for (size_t i = 0; i < mSize; ++i) {
+        Particle* p       = mParticles[i];
+        mVelocities[i]    = mVerlet ? PVector::sub(mPositions[i], p->old_position()) : p->velocity();
+        mRadii[i]         = p->radius();
+        mInverseMasses[i] = p->fixed() ? 0.0f : 1.0f / p->mass();
+    }
+
+    for (int mIteration = 0; mIteration < mIterations; ++mIteration) {
+        for (const auto& mPair: mPairs) {
+            const float mInverseMassA = mInverseMasses[mPair.a];
+            const float mInverseMassB = mInverseMasses[mPair.b];
+            const float mInverseMass  = mInverseMassA + mInverseMassB;
+            if (mInverseMass <= 0.0f) {
+                continue;
+            }
+            PVector&      mPositionA       = mPositions[mPair.a];
+            PVector&      mPositionB       = mPositions[mPair.b];
+            const PVector mDelta           = PVector::sub(mPositionA, mPositionB);
+            const float   mDistanceSquared = mDelta.magSq();
+            const float   mMinDistance     = mRadii[mPair.a] + mRadii[mPair.b];
+            if (mDistanceSquared >= mMinDistance * mMinDistance) {
+                continue;
+            }
+            if (mIteration == 0) {
+                ++mContacts;
+            }
+            mTouched[mPair.a] = 1;
+            mTouched[mPair.b] = 1;
+
+            /* coincident particles are separated along an arbitrary but fixed axis */
+            const float   mDistance = std::sqrt(mDistanceSquared);
+            const PVector mNormal   = mDistance > 0.0f ? PVector::mult(mDelta, 1.0f / mDistance) : PVector(1, 0, 0);
+
+            PVector&    mVelocityA = mVelocities[mPair.a];
+            PVector&    mVelocityB = mVelocities[mPair.b];
+            const float mApproach  = PVector::sub(mVelocityA, mVelocityB).dot(mNormal);
+            if (mApproach < 0.0f) {
+                const float mImpulse = -(1.0f + mCoefficientOfRestitution) * mApproach / mInverseMass;
+                mVelocityA.add(PVector::mult(mNormal, mImpulse * mInverseMassA));
+                mVelocityB.sub(PVector::mult(mNormal, mImpulse * mInverseMassB));
+            }
+
+            const float mOverlap = (mMinDistance - mDistance) / mInverseMass;
+            mPositionA.add(PVector::mult(mNormal, mOverlap * mInverseMassA));
+            mPositionB.sub(PVector::mult(mNormal, mOverlap * mInverseMassB));
+        }
+    }
+
+    for (size_t i = 0; i < mSize; ++i) {
+        if (!mTouched[i]) {
+            continue;
+        }
+        /* a sleeping particle that is pushed out of an overlap must integrate again */
+        Particle* p = mParticles[i];
+        p->wake();
+        p->position().set(mPositions[i]);
+        if (mVerlet) {
+            p->old_position().set(PVector::sub(mPositions[i], mVelocities[i]));
+        } else {
+            p->velocity().set(mVelocities[i]);
+        }
+    }
+}
@@ -0,0 +1,269 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include "ParticleStore.h"
+#include "ParticleHandle.h"
+#include "Physics.h"
+
+ParticleStore::~ParticleStore() {
+    for (const auto& h: mHandles) {
+        delete h;
+    }
+    for (const auto& h: mDetachedHandles) {
+        delete h;
+    }
+    for (const auto& h: mFreeHandles) {
+        delete h;
+    }
+}
+
+ParticleHandle* ParticleStore::make() {
+    const auto mIndex = static_cast<uint32_t>(size());
+    mPositions.emplace_back(0, 0, 0);
+    mOldPositions.emplace_back(0, 0, 0);
+    mVelocities.emplace_back(0, 0, 0);
+    mForces.emplace_back(0, 0, 0);
+    mMasses.push_back(1.0f);
+    mInverseMasses.push_back(1.0f);
+    mAges.push_back(0.0f);
+    mRadii.push_back(0.0f);
+    mRestTimes.push_back(0.0f);
+    mFlags.push_back(0);
+    mIDs.push_back(Physics::getUniqueID());
+    mAwakeSlots.push_back(static_cast<uint32_t>(mAwake.size()));
+    mAwake.push_back(mIndex);
+    mHandles.push_back(acquireHandle(mIndex));
+    return mHandles.back();
+}
+
+uint32_t ParticleStore::append(const size_t pCount, const Columns& pColumns) {
+    const auto   mFirst = static_cast<uint32_t>(size());
+    const size_t mSize  = mFirst + pCount;
+    mPositions.insert(mPositions.end(), pColumns.positions, pColumns.positions + pCount);
+    mOldPositions.insert(mOldPositions.end(), pColumns.old_positions, pColumns.old_positions + pCount);
+    mVelocities.insert(mVelocities.end(), pColumns.velocities, pColumns.velocities + pCount);
+    mForces.insert(mForces.end(), pColumns.forces, pColumns.forces + pCount);
+    mMasses.insert(mMasses.end(), pColumns.masses, pColumns.masses + pCount);
+    mAges.insert(mAges.end(), pColumns.ages, pColumns.ages + pCount);
+    mRadii.insert(mRadii.end(), pColumns.radii, pColumns.radii + pCount);
+    mRestTimes.insert(mRestTimes.end(), pColumns.rest_times, pColumns.rest_times + pCount);
+    mIDs.insert(mIDs.end(), pColumns.ids, pColumns.ids + pCount);
+    mInverseMasses.resize(mSize);
+    mFlags.resize(mSize);
+    mAwakeSlots.resize(mSize);
+    mHandles.reserve(mSize);
+    for (uint32_t i = mFirst; i < mSize; ++i) {
+        mInverseMasses[i] = 1.0f / mMasses[i];
+        mFlags[i]         = pColumns.flags[i - mFirst] & (FIXED | DEAD | TAGGED | STILL | SLEEPING);
+        if (mFlags[i] & SLEEPING) {
+            mAwakeSlots[i] = INVALID_INDEX;
+            ++mSleeping;
+        } else {
+            mAwakeSlots[i] = static_cast<uint32_t>(mAwake.size());
+            mAwake.push_back(i);
+        }
+        mHandles.push_back(acquireHandle(i));
+    }
+    return mFirst;
+}
+
+ParticleHandle* ParticleStore::acquireHandle(const uint32_t pIndex) {
+    if (mFreeHandles.empty()) {
+        return new ParticleHandle(this, pIndex);
+    }
+    ParticleHandle* mHandle = mFreeHandles.back();
+    mFreeHandles.pop_back();
+    mHandle->index(pIndex);
+    return mHandle;
+}
+
+void ParticleStore::recycle() {
+    mFreeHandles.insert(mFreeHandles.end(), mDetachedHandles.begin(), mDetachedHandles.end());
+    mDetachedHandles.clear();
+}
+
+size_t ParticleStore::footprint() const {
+    const size_t mHandleCount = mHandles.capacity() + mDetachedHandles.capacity() + mFreeHandles.capacity();
+    return mPositions.capacity() * sizeof(PVector) +
+           mOldPositions.capacity() * sizeof(PVector) +
+           mVelocities.capacity() * sizeof(PVector) +
+           mForces.capacity() * sizeof(PVector) +
+           mMasses.capacity() * sizeof(float) +
+           mInverseMasses.capacity() * sizeof(float) +
+           mAges.capacity() * sizeof(float) +
+           mRadii.capacity() * sizeof(float) +
+           mRestTimes.capacity() * sizeof(float) +
+           mFlags.capacity() * sizeof(uint8_t) +
+           mIDs.capacity() * sizeof(long) +
+           (mAwake.capacity() + mAwakeSlots.capacity()) * sizeof(uint32_t) +
+           mHandleCount * sizeof(ParticleHandle*) +
+           (mHandles.size() + mDetachedHandles.size() + mFreeHandles.size()) * sizeof(ParticleHandle);
+}
+
+void ParticleStore::reserve(const size_t pCapacity) {
+    mPositions.reserve(pCapacity);
+    mOldPositions.reserve(pCapacity);
+    mVelocities.reserve(pCapacity);
+    mForces.reserve(pCapacity);
+    mMasses.reserve(pCapacity);
+    mInverseMasses.reserve(pCapacity);
+    mAges.reserve(pCapacity);
+    mRadii.reserve(pCapacity);
+    mRestTimes.reserve(pCapacity);
+    mFlags.reserve(pCapacity);
+    mIDs.reserve(pCapacity);
+    mAwake.reserve(pCapacity);
+    mAwakeSlots.reserve(pCapacity);
+    mHandles.reserve(pCapacity);
+}
+
+void ParticleStore::remove(const uint32_t pIndex) {
+    if (pIndex >= size()) {
+        return;
+    }
+    if (mFlags[pIndex] & SLEEPING) {
+        --mSleeping;
+    }
+    mHandles[pIndex]->index(INVALID_INDEX);
+    mDetachedHandles.push_back(mHandles[pIndex]);
+    for (uint32_t i = pIndex + 1; i < size(); ++i) {
+        move(i, i - 1);
+    }
+    truncate(size() - 1);
+    rebuildAwake();
+    ++mRevision;
+}
+
+size_t ParticleStore::removeFlagged(const uint8_t pFlags) {
+    uint32_t mWrite = 0;
+    for (uint32_t i = 0; i < size(); ++i) {
+        if (mFlags[i] & pFlags) {
+            if (mFlags[i] & SLEEPING) {
+                --mSleeping;
+            }
+            mHandles[i]->index(INVALID_INDEX);
+            mDetachedHandles.push_back(mHandles[i]);
+        } else {
+            if (mWrite != i) {
+                move(i, mWrite);
+            }
+            ++mWrite;
+        }
+    }
+    const size_t mRemoved = size() - mWrite;
+    if (mRemoved > 0) {
+        truncate(mWrite);
+        rebuildAwake();
+        ++mRevision;
+    }
+    return mRemoved;
+}
+
+void ParticleStore::move(const uint32_t pFrom, const uint32_t pTo) {
+    mPositions[pTo]     = mPositions[pFrom];
+    mOldPositions[pTo]  = mOldPositions[pFrom];
+    mVelocities[pTo]    = mVelocities[pFrom];
+    mForces[pTo]        = mForces[pFrom];
+    mMasses[pTo]        = mMasses[pFrom];
+    mInverseMasses[pTo] = mInverseMasses[pFrom];
+    mAges[pTo]          = mAges[pFrom];
+    mRadii[pTo]         = mRadii[pFrom];
+    mRestTimes[pTo]     = mRestTimes[pFrom];
+    mFlags[pTo]         = mFlags[pFrom];
+    mIDs[pTo]           = mIDs[pFrom];
+    mHandles[pTo]       = mHandles[pFrom];
+    mHandles[pTo]->index(pTo);
+}
+
+void ParticleStore::truncate(const size_t pSize) {
+    mPositions.resize(pSize);
+    mOldPositions.resize(pSize);
+    mVelocities.resize(pSize);
+    mForces.resize(pSize);
+    mMasses.resize(pSize);
+    mInverseMasses.resize(pSize);
+    mAges.resize(pSize);
+    mRadii.resize(pSize);
+    mRestTimes.resize(pSize);
+    mFlags.resize(pSize);
+    mIDs.resize(pSize);
+    mHandles.resize(pSize);
+}
+
+void ParticleStore::rebuildAwake() {
+    mAwake.clear();
+    mAwakeSlots.resize(size());
+    for (uint32_t i = 0; i < size(); ++i) {
+        if (mFlags[i] & SLEEPING) {
+            mAwakeSlots[i] = INVALID_INDEX;
+        } else {
+            mAwakeSlots[i] = static_cast<uint32_t>(mAwake.size());
+            mAwake.push_back(i);
+        }
+    }
+}
+
+void ParticleStore::sleep(const uint32_t i) {
+    if (mFlags[i] & IMMOVABLE) {
+        return;
+    }
+    mFlags[i] |= SLEEPING;
+    mVelocities[i].set(0, 0, 0);
+    mRestTimes[i] = 0.0f;
+    ++mSleeping;
+    /* swap the last awake slot into the gap */
+    const uint32_t mSlot = mAwakeSlots[i];
+    const uint32_t mLast = mAwake.back();
+    mAwake[mSlot]        = mLast;
+    mAwakeSlots[mLast]   = mSlot;
+    mAwakeSlots[i]       = INVALID_INDEX;
+    mAwake.pop_back();
+}
+
+void ParticleStore::wake(const uint32_t i) {
+    if (!(mFlags[i] & SLEEPING)) {
+        return;
+    }
+    mFlags[i] &= static_cast<uint8_t>(~SLEEPING);
+    mRestTimes[i] = 0.0f;
+    --mSleeping;
+    ++mWakes;
+    mAwakeSlots[i] = static_cast<uint32_t>(mAwake.size());
+    mAwake.push_back(i);
+}
+
+void ParticleStore::wakeAll() {
+    if (mSleeping == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < size(); ++i) {
+        if (mFlags[i] & SLEEPING) {
+            mFlags[i] &= static_cast<uint8_t>(~SLEEPING);
+            mRestTimes[i] = 0.0f;
+        }
+    }
+    mSleeping = 0;
+    ++mWakes;
+    rebuildAwake();
+}
@@ -21,111 +21,987 @@
  *
  */
 
+#include <limits>
+
 #include "Physics.h"
 #include "Midpoint.h"
 #include "Util.h"
+#include "XPBDConstraintSystem.h"
+#include "XPBDDistanceConstraint.h"
 
 Physics::Physics()
-    : mIntegrator(new Midpoint()) {
+    : mIntegrator(new Midpoint()),
+      mOwnsIntegrator(true) {
+}
+
+Physics::~Physics() {
+    if (mOwnsIntegrator) {
+        delete mIntegrator;
+    }
+}
+
+size_t Physics::footprint() const {
+    size_t mFootprint = mStore.footprint();
+    for (const auto& p: mPools) {
+        mFootprint += p.second->footprint();
+    }
+    return mFootprint;
+}
+
+void Physics::threads(size_t pThreads) {
+    if (pThreads == 0) {
+        pThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (pThreads == threads()) {
+        return;
+    }
+    mThreadPool.reset(pThreads > 1 ? new ThreadPool(pThreads) : nullptr);
+    mThreadForces.clear();
+    mSpringColoring.clear();
+    mSpringColoringValid = false;
+}
+
+void Physics::useSpatialHashGrid(const bool pUseSpatialHashGrid, const float pCellSize) {
+    if (!pUseSpatialHashGrid) {
+        mSpatialHashGrid.reset();
+    } else if (mSpatialHashGrid == nullptr) {
+        mSpatialHashGrid.reset(new SpatialHashGrid(pCellSize));
+    } else {
+        mSpatialHashGrid->cell_size(pCellSize);
+    }
+    mSpatialHashGridValid = false;
+}
+
+SpatialHashGrid* Physics::spatial_hash_grid() {
+    if (mSpatialHashGrid != nullptr && !mSpatialHashGridValid) {
+        mSpatialHashGrid->build(mParticles, mThreadPool.get());
+        mSpatialHashGridValid = true;
+    }
+    return mSpatialHashGrid.get();
+}
+
+PVector Physics::interpolated_position(const size_t i) const {
+    Particle*      mParticle = mParticles[i];
+    const PVector& mPosition = mParticle->position();
+    /* particles added or reordered since the last step are not interpolated */
+    if (i >= mPreviousIDs.size() || mPreviousIDs[i] != mParticle->ID()) {
+        return mPosition;
+    }
+    const PVector& mPrevious = mPreviousPositions[i];
+    const float    mAlpha    = alpha();
+    return {mPrevious.x + (mPosition.x - mPrevious.x) * mAlpha,
+            mPrevious.y + (mPosition.y - mPrevious.y) * mAlpha,
+            mPrevious.z + (mPosition.z - mPrevious.z) * mAlpha};
+}
+
+void Physics::interpolate(std::vector<PVector>& pPositions) const {
+    pPositions.resize(mParticles.size());
+    for (size_t i = 0; i < mParticles.size(); ++i) {
+        pPositions[i] = interpolated_position(i);
+    }
+}
+
+void Physics::capturePreviousPositions() {
+    mPreviousIDs.resize(mParticles.size());
+    mPreviousPositions.resize(mParticles.size());
+    for (size_t i = 0; i < mParticles.size(); ++i) {
+        mPreviousIDs[i]       = mParticles[i]->ID();
+        mPreviousPositions[i] = mParticles[i]->position();
+    }
+}
+
+void Physics::forceAdded(Force* pForce) {
+    mForceHandles.insert(pForce);
+    if (const auto mSpring = dynamic_cast<Spring*>(pForce)) {
+        springAdded(mSpring);
+        /* a spring between two sleeping particles would never be evaluated */
+        mSpring->a()->wake();
+        mSpring->b()->wake();
+    } else if (dynamic_cast<ParticleForce*>(pForce) != nullptr) {
+        mStore.wakeAll();
+    }
+    if (mReplayRecorder != nullptr) {
+        mReplayRecorder->added(pForce);
+    }
+}
+
+void Physics::springAdded(Spring* pSpring) {
+    mSpringIndex.add(pSpring);
+    if (mSpringColoringValid) {
+        mSpringColoring.add(pSpring);
+    }
+    if (mUseIslands) {
+        mIslands.add(pSpring);
+        islandMember(pSpring->a(), true);
+        islandMember(pSpring->b(), true);
+    }
 }
 
-bool Physics::VERBOSE                  = false;
-bool Physics::HINT_UPDATE_OLD_POSITION = true;
-long Physics::oID                      = -1;
+void Physics::springRemoved(const Spring* pSpring) {
+    mSpringIndex.remove(pSpring);
+    if (mSpringColoringValid) {
+        mSpringColoring.remove(pSpring);
+    }
+    if (mUseIslands) {
+        mDetachedIslandParticles.clear();
+        mIslands.remove(pSpring, &mDetachedIslandParticles);
+        for (const auto& p: mDetachedIslandParticles) {
+            islandMember(p, false);
+        }
+    }
+}
+
+void Physics::islandMember(Particle* pParticle, const bool pMember) {
+    const auto mHandle = dynamic_cast<ParticleHandle*>(pParticle);
+    if (mHandle != nullptr && mHandle->store() == &mStore && mHandle->attached()) {
+        mStore.flag(mHandle->index(), ParticleStore::ISLAND, pMember);
+    }
+}
+
+void Physics::useIslands(const bool pUseIslands) {
+    if (pUseIslands == mUseIslands) {
+        return;
+    }
+    for (const auto& mIsland: mIslands.islands()) {
+        for (const auto& p: mIsland.particles) {
+            islandMember(p, false);
+        }
+    }
+    mIslands.clear();
+    mUseIslands = pUseIslands;
+    if (mUseIslands) {
+        for (const auto& f: mForces) {
+            if (const auto mSpring = dynamic_cast<Spring*>(f)) {
+                mIslands.add(mSpring);
+                islandMember(mSpring->a(), true);
+                islandMember(mSpring->b(), true);
+            }
+        }
+    }
+}
+
+void Physics::applyForces(const float pDeltaTime) {
+    /* particles in the store have no inner forces */
+    if (packed() == nullptr) {
+        for (const auto& p: mParticles) {
+            if (!p->fixed()) {
+                p->accumulateInnerForce(pDeltaTime);
+            }
+        }
+    }
+
+    applyTypedForces(pDeltaTime);
 
-void Physics::handleForces() {
-    if (HINT_REMOVE_DEAD) {
-        for (auto it = mForces.begin(); it != mForces.end(); ) {
-            if ((*it)->dead()) {
-                it = mForces.erase(it); // Remove dead forces
+    if (mThreadPool == nullptr) {
+        bool   mIslandSpringsDone = false;
+        size_t i                  = 0;
+        while (i < mForces.size()) {
+            Force* mForce = mForces[i];
+            if (!mForce->active()) {
+                ++i;
+            } else if (mUseIslands && dynamic_cast<Spring*>(mForce) != nullptr) {
+                /* springs of sleeping islands are skipped */
+                if (!mIslandSpringsDone) {
+                    applyIslandSprings(pDeltaTime);
+                    mIslandSpringsDone = true;
+                }
+                ++i;
+            } else if (collectParticleForces(i)) {
+                applyParticleForces(pDeltaTime);
             } else {
-                ++it; // Move to the next force
+                mForce->apply(pDeltaTime, *this);
+                ++i;
             }
         }
+        return;
+    }
+
+    /*
+     * consecutive particle forces and consecutive springs are batched, all other forces are applied in between. when
+     * springs are colored all springs are applied together in place of the first spring. islands are only used
+     * while they are balanced, a dominant island would run on one thread and is better spread over all threads by
+     * coloring. islands share no particles, so with deterministic reduction they are always used and accumulate
+     * spring forces in the same order as the single threaded island path.
+     */
+    const bool mColorSprings       = HINT_COLOR_SPRINGS && !HINT_DETERMINISTIC_REDUCTION;
+    const bool mIslandSprings      = mUseIslands && (HINT_DETERMINISTIC_REDUCTION || !mColorSprings || balancedIslands());
+    bool       mColoredSpringsDone = false;
+    size_t     i                   = 0;
+    while (i < mForces.size()) {
+        Force* mForce = mForces[i];
+        if (!mForce->active()) {
+            ++i;
+            continue;
+        }
+        if ((mIslandSprings || mColorSprings) && dynamic_cast<Spring*>(mForce) != nullptr) {
+            if (!mColoredSpringsDone) {
+                if (mIslandSprings) {
+                    applyIslandSprings(pDeltaTime);
+                } else {
+                    applyColoredSprings(pDeltaTime);
+                }
+                mColoredSpringsDone = true;
+            }
+            ++i;
+        } else if (collectParticleForces(i)) {
+            applyParticleForces(pDeltaTime);
+        } else if (dynamic_cast<Spring*>(mForce) != nullptr) {
+            mSpringBatch.clear();
+            for (; i < mForces.size(); ++i) {
+                if (!mForces[i]->active()) {
+                    continue;
+                }
+                const auto mSpring = dynamic_cast<Spring*>(mForces[i]);
+                if (mSpring == nullptr) {
+                    break;
+                }
+                mSpringBatch.push_back(mSpring);
+            }
+            applySprings();
+        } else {
+            mForce->apply(pDeltaTime, *this);
+            ++i;
+        }
     }
 }
 
-void Physics::handleParticles(const float pDeltaTime) {
-    try {
-        for (auto it = mParticles.begin(); it != mParticles.end();) {
-            const auto& mParticle = *it;
+bool Physics::collectParticleForces(size_t& pIndex) {
+    mParticleForceBatch.clear();
+    for (; pIndex < mForces.size(); ++pIndex) {
+        if (!mForces[pIndex]->active()) {
+            continue;
+        }
+        const auto mParticleForce = dynamic_cast<ParticleForce*>(mForces[pIndex]);
+        if (mParticleForce == nullptr) {
+            break;
+        }
+        mParticleForceBatch.push_back(mParticleForce);
+    }
+    return !mParticleForceBatch.empty();
+}
 
-            // Clear force
-            mParticle->force().set(0, 0, 0);
+void Physics::applyParticleForces(const float pDeltaTime, const size_t pBegin, const size_t pEnd) {
+    /*
+     * all forces of the batch are applied to one block of particles before moving on to the next block. the data of
+     * a block stays in cache for all forces and every particle still receives the forces in the same order.
+     */
+    if (mFusedForcesValid) {
+        mFusedForces.apply(pDeltaTime, *this, mStore, pBegin, pEnd);
+        return;
+    }
+    for (size_t mBlock = pBegin; mBlock < pEnd; mBlock += PARTICLE_FORCE_BLOCK_SIZE) {
+        const size_t mBlockEnd = std::min(mBlock + PARTICLE_FORCE_BLOCK_SIZE, pEnd);
+        for (const auto& f: mParticleForceBatch) {
+            f->apply(pDeltaTime, *this, mBlock, mBlockEnd);
+        }
+    }
+}
 
-            // Age particle
-            mParticle->age(mParticle->age() + pDeltaTime);
+void Physics::applyParticleForces(const float pDeltaTime) {
+    mFusedForcesValid = HINT_FUSE_PARTICLE_FORCES && packed() != nullptr && mFusedForces.build(mParticleForceBatch, *this);
+    if (mFusedForcesValid && mFusedForces.built_in() && mStore.sleeping_count() > 0) {
+        /* sleeping particles receive no particle forces, the batch only visits the awake list */
+        const size_t mAwakeCount = mStore.awake_count();
+        if (mThreadPool == nullptr) {
+            mFusedForces.applyAwake(mStore, 0, mAwakeCount);
+        } else {
+            mThreadPool->run(mAwakeCount, PARALLEL_GRAIN_SIZE, [&](const size_t pBegin, const size_t pEnd, size_t) {
+                mFusedForces.applyAwake(mStore, pBegin, pEnd);
+            });
+        }
+        return;
+    }
+    if (mThreadPool == nullptr) {
+        applyParticleForces(pDeltaTime, 0, mParticles.size());
+        return;
+    }
+    /* every thread applies all forces of the batch to its range of particles */
+    mThreadPool->run(mParticles.size(), PARALLEL_GRAIN_SIZE, [&](const size_t pBegin, const size_t pEnd, size_t) {
+        applyParticleForces(pDeltaTime, pBegin, pEnd);
+    });
+}
+
+namespace {
+    uint32_t storeIndex(Particle* pParticle, const ParticleStore* pStore) {
+        const auto mHandle = dynamic_cast<ParticleHandle*>(pParticle);
+        if (mHandle != nullptr && mHandle->store() == pStore && mHandle->attached()) {
+            return mHandle->index();
+        }
+        return ParticleStore::INVALID_INDEX;
+    }
+} // namespace
 
-            // Remove dead particles
-            if (HINT_REMOVE_DEAD && mParticle->dead()) {
-                it = mParticles.erase(it);
-                continue; // Skip the rest of the loop since we removed this particle
+void Physics::applySprings() {
+    using C = SpringContribution;
+
+    const size_t   mCount  = mSpringBatch.size();
+    ParticleStore* mPacked = packed();
+    const bool     mBuffer = mPacked != nullptr && !HINT_DETERMINISTIC_REDUCTION;
+    if (mSpringContributions.size() < mCount) {
+        mSpringContributions.resize(mCount);
+    }
+    if (mBuffer) {
+        mThreadForces.resize(mThreadPool->threads());
+        for (auto& b: mThreadForces) {
+            if (b.size() != mPacked->size()) {
+                b.assign(mPacked->size(), PVector());
             }
+        }
+    }
 
-            // Recover NaN values
-            if (HINT_RECOVER_NAN) {
-                if (Util::isNaN(mParticle->position())) {
-                    if (Util::isNaN(mParticle->old_position())) {
-                        mParticle->position().set(0, 0, 0);
-                    } else {
-                        mParticle->position().set(mParticle->old_position());
+    /* compute spring forces in parallel. without deterministic reduction they are accumulated in per-thread buffers right away. */
+    mThreadPool->run(mCount, PARALLEL_GRAIN_SIZE, [&](const size_t pBegin, const size_t pEnd, const size_t pThread) {
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            const Spring* mSpring = mSpringBatch[i];
+            C&            c       = mSpringContributions[i];
+            Particle*     mA      = mSpringBatch[i]->a();
+            Particle*     mB      = mSpringBatch[i]->b();
+            c.targets             = 0;
+            if (mSpring->calculateForce(c.force)) {
+                const bool mFixedA = mA->fixed();
+                const bool mFixedB = mB->fixed();
+                if (mSpring->oneway()) {
+                    if (!mFixedB) {
+                        c.force.mult(-2);
+                        c.targets = C::ADD_B;
                     }
+                } else {
+                    c.targets = (mFixedA ? 0 : C::ADD_A) | (mFixedB ? 0 : C::SUB_B);
                 }
+            }
+            if (mBuffer) {
+                /* every batch of a step reuses the contributions, so each one remembers the revision it was looked up in */
+                if (c.revision != mPacked->revision() || c.spring != mSpring || c.a != mA || c.b != mB) {
+                    c.ia       = storeIndex(mA, mPacked);
+                    c.ib       = storeIndex(mB, mPacked);
+                    c.revision = mPacked->revision();
+                }
+                if (c.targets != 0 && c.ia != ParticleStore::INVALID_INDEX && c.ib != ParticleStore::INVALID_INDEX) {
+                    std::vector<PVector>& mForces = mThreadForces[pThread];
+                    if (c.targets & C::ADD_A) {
+                        mForces[c.ia].add(c.force);
+                    }
+                    if (c.targets & C::SUB_B) {
+                        mForces[c.ib].sub(c.force);
+                    }
+                    if (c.targets & C::ADD_B) {
+                        mForces[c.ib].add(c.force);
+                    }
+                    c.targets |= C::ACCUMULATED;
+                }
+            }
+            c.spring = mSpring;
+            c.a      = mA;
+            c.b      = mB;
+        }
+    });
 
-                if (Util::isNaN(mParticle->velocity())) {
-                    mParticle->velocity().set(0, 0, 0);
+    if (mBuffer) {
+        /* reduce per-thread buffers in thread order and clear them for the next batch */
+        PVector* mForces = mPacked->forces();
+        mThreadPool->run(mPacked->size(), PARALLEL_GRAIN_SIZE, [&](const size_t pBegin, const size_t pEnd, size_t) {
+            for (auto& b: mThreadForces) {
+                for (size_t i = pBegin; i < pEnd; ++i) {
+                    mForces[i].add(b[i]);
+                    b[i].set(0, 0, 0);
                 }
             }
+        });
+    }
 
-            // Optimize still particles
-            if (HINT_OPTIMIZE_STILL) {
-                const float mSpeed = mParticle->velocity().magSq();
-                mParticle->still(mSpeed > -EPSILON && mSpeed < EPSILON);
+    /* accumulate remaining contributions in spring order */
+    for (size_t i = 0; i < mCount; ++i) {
+        const C& c = mSpringContributions[i];
+        if (c.targets & C::ACCUMULATED) {
+            continue;
+        }
+        if (c.targets & C::ADD_A) {
+            c.a->force().add(c.force);
+        }
+        if (c.targets & C::SUB_B) {
+            c.b->force().sub(c.force);
+        }
+        if (c.targets & C::ADD_B) {
+            c.b->force().add(c.force);
+        }
+    }
+}
+
+void Physics::applyColoredSprings(const float pDeltaTime) {
+    if (!mSpringColoringValid) {
+        for (const auto& f: mForces) {
+            if (const auto mSpring = dynamic_cast<Spring*>(f)) {
+                mSpringColoring.add(mSpring);
             }
+        }
+        mSpringColoringValid = true;
+    }
 
-            ++it; // Move to the next particle
+    /* springs whose particles were exchanged since they were colored are recolored and applied afterwards */
+    mStaleColoredSprings.resize(mThreadPool->threads());
+    for (size_t c = 0; c < mSpringColoring.colors(); ++c) {
+        const auto& mColor = mSpringColoring.color(c);
+        mThreadPool->run(mColor.size(), PARALLEL_GRAIN_SIZE, [&](const size_t pBegin, const size_t pEnd, const size_t pThread) {
+            for (size_t j = pBegin; j < pEnd; ++j) {
+                const SpringColoring::Entry& e = mColor[j];
+                if (e.spring->a() != e.a || e.spring->b() != e.b) {
+                    mStaleColoredSprings[pThread].push_back(e.spring);
+                } else if (e.spring->active()) {
+                    e.spring->apply(pDeltaTime, *this);
+                }
+            }
+        });
+    }
+    for (const auto& e: mSpringColoring.overflow()) {
+        if (e.spring->a() != e.a || e.spring->b() != e.b) {
+            mStaleColoredSprings[0].push_back(e.spring);
+        } else if (e.spring->active()) {
+            e.spring->apply(pDeltaTime, *this);
         }
-    } catch (const std::exception& ex) {
-        if (VERBOSE) {
-            // Print exception (use proper logging mechanism as needed)
-            std::cerr << ex.what() << std::endl;
+    }
+    for (auto& mStale: mStaleColoredSprings) {
+        for (const auto& mSpring: mStale) {
+            springRemoved(mSpring);
+            springAdded(mSpring);
+            if (mSpring->active()) {
+                mSpring->apply(pDeltaTime, *this);
+            }
         }
+        mStale.clear();
     }
 }
 
-void Physics::handleConstraints() {
-    for (auto it = mConstraints.begin(); it != mConstraints.end();) {
-        const auto& mConstraint = *it;
-        mConstraint->apply(*this); // Apply the constraint
+bool Physics::balancedIslands() {
+    mIslands.update();
+    size_t mSprings = 0;
+    size_t mLargest = 0;
+    for (const auto& mIsland: mIslands.islands()) {
+        mSprings += mIsland.springs.size();
+        mLargest = std::max(mLargest, mIsland.springs.size());
+    }
+    return mLargest * threads() <= mSprings;
+}
 
-        // Check if the constraint should be removed if it's dead
-        if (HINT_REMOVE_DEAD && mConstraint->dead()) {
-            it = mConstraints.erase(it); // Remove dead constraint and move iterator forward
-        } else {
-            ++it; // Move to the next constraint
+void Physics::applyIslandSprings(const float pDeltaTime) {
+    mIslands.update();
+    /* sleeping islands are skipped unless particles were woken since the islands were put to sleep */
+    const bool  mSkipSleeping = mUseSleeping && mStore.sleeping_count() > 0 && mStore.wakes() == mIslandWakes;
+    const auto& mIslandList   = mIslands.islands();
+    const auto  mApply        = [&](const size_t pBegin, const size_t pEnd, const size_t pThread) {
+        for (size_t j = pBegin; j < pEnd; ++j) {
+            const SpringIslands::Island& mIsland = mIslandList[j];
+            if (mSkipSleeping && mIsland.sleeping) {
+                continue;
+            }
+            for (const auto& e: mIsland.springs) {
+                if (e.spring->a() != e.a || e.spring->b() != e.b) {
+                    mStaleColoredSprings[pThread].push_back(e.spring);
+                } else if (e.spring->active()) {
+                    e.spring->apply(pDeltaTime, *this);
+                }
+            }
+        }
+    };
+
+    /* islands share no particles, so every thread applies all springs of its islands in turn */
+    mStaleColoredSprings.resize(threads());
+    if (mThreadPool == nullptr) {
+        mApply(0, mIslandList.size(), 0);
+    } else {
+        mThreadPool->run(mIslandList.size(), 1, mApply);
+    }
+    /* springs whose particles were exchanged since they were added may connect two islands now */
+    for (auto& mStale: mStaleColoredSprings) {
+        for (const auto& mSpring: mStale) {
+            springRemoved(mSpring);
+            springAdded(mSpring);
+            if (mSpring->active()) {
+                mSpring->apply(pDeltaTime, *this);
+            }
+        }
+        mStale.clear();
+    }
+}
+
+void Physics::release(const void* pObject) {
+    for (const auto& p: mPools) {
+        if (p.second->release(pObject)) {
+            return;
         }
     }
 }
 
-void Physics::postHandleParticles(float pDeltaTime) const {
-    if (HINT_SET_VELOCITY_FROM_PREVIOUS_POSITION || HINT_UPDATE_OLD_POSITION) {
-        try {
-            for (auto& mParticle: mParticles) {
-                if (HINT_SET_VELOCITY_FROM_PREVIOUS_POSITION) {
-                    if (mParticle->fixed()) {
-                        PVector velocity = PVector::sub(mParticle->position(), mParticle->old_position());
-                        mParticle->velocity().set(velocity);
+template<typename T>
+void Physics::collectRemoved(std::vector<const T*>& pRemoved) {
+    mRemovedSet.clear();
+    mRemovedSet.insert(pRemoved.begin(), pRemoved.end());
+    pRemoved.clear();
+}
+
+bool              Physics::VERBOSE                  = false;
+bool              Physics::HINT_UPDATE_OLD_POSITION = true;
+std::atomic<long> Physics::oID{-1};
+
+void Physics::handleForces(const bool pRemoveDead) {
+    if (!pRemoveDead && mRemovedForces.empty() && mReleasedParticles.empty()) {
+        return;
+    }
+    /* removed forces may already be destroyed by their owner, so they are identified by address only */
+    collectRemoved(mRemovedForces);
+    const bool mReleased = !mReleasedParticles.empty();
+    size_t     mWrite    = 0;
+    for (size_t i = 0; i < mForces.size(); ++i) {
+        Force* mForce = mForces[i];
+        if (!mRemovedSet.empty() && mRemovedSet.count(mForce) > 0) {
+            release(mForce);
+            continue;
+        }
+        if (pRemoveDead || mReleased) {
+            /* springs are removed before their particles are released, removed particles are always dead */
+            if (const auto mSpringSystem = dynamic_cast<SpringSystem*>(mForce)) {
+                if (pRemoveDead) {
+                    mSpringSystem->removeDead();
+                } else {
+                    mSpringSystem->removeConnected(mReleasedParticles);
+                }
+            }
+            if (pRemoveDead ? mForce->dead() : connected(mForce)) {
+                if (const auto mSpring = dynamic_cast<Spring*>(mForce)) {
+                    springRemoved(mSpring);
+                }
+                mForceHandles.erase(mForce);
+                release(mForce);
+                continue;
+            }
+        }
+        mForces[mWrite++] = mForce;
+    }
+    mForces.resize(mWrite);
+}
+
+bool Physics::connected(Force* pForce) const {
+    if (const auto mSpring = dynamic_cast<Spring*>(pForce)) {
+        return connected(mSpring->a(), mSpring->b());
+    }
+    return false;
+}
+
+size_t Physics::appendParticles(const size_t pCount, const ParticleStore::Columns& pColumns) {
+    /* the IDs are kept if all of them lie above every ID issued so far, which then continue above them */
+    long mMinID = std::numeric_limits<long>::max();
+    long mMaxID = -1;
+    for (size_t i = 0; i < pCount; ++i) {
+        mMinID = std::min(mMinID, static_cast<long>(pColumns.ids[i]));
+        mMaxID = std::max(mMaxID, static_cast<long>(pColumns.ids[i]));
+    }
+    long mID = oID.load();
+    while (mID < mMinID && !oID.compare_exchange_weak(mID, mMaxID)) {}
+    ParticleStore::Columns mColumns = pColumns;
+    std::vector<int64_t>   mIDs;
+    if (pCount > 0 && mID >= mMinID) {
+        mIDs.resize(pCount);
+        for (auto& mNewID: mIDs) {
+            mNewID = getUniqueID();
+        }
+        mColumns.ids = mIDs.data();
+    }
+
+    const size_t   mFirst = mParticles.size();
+    const uint32_t mSlot  = mStore.append(pCount, mColumns);
+    mParticles.reserve(mFirst + pCount);
+    mParticleHandles.reserve(mParticleHandles.size() + pCount);
+    for (size_t i = 0; i < pCount; ++i) {
+        Particle* mParticle = mStore.handles()[mSlot + i];
+        mParticles.push_back(mParticle);
+        particleAdded(mParticle);
+    }
+    return mFirst;
+}
+
+void Physics::remove(Particle* pParticle) {
+    if (mReplayRecorder != nullptr) {
+        mReplayRecorder->removed(pParticle);
+    }
+    const auto mHandle = dynamic_cast<ParticleHandle*>(pParticle);
+    if (mHandle != nullptr && mHandle->store() == &mStore && mHandle->attached()) {
+        mStore.flag(mHandle->index(), ParticleStore::REMOVED, true);
+        mReleasedParticles.insert(pParticle);
+    } else if (owns(pParticle)) {
+        /* owned particles die when removed so that springs attached to them are removed as well */
+        pParticle->dead(true);
+        mReleasedParticles.insert(pParticle);
+    }
+    mParticleHandles.erase(pParticle);
+    mRemovedParticles.push_back(pParticle);
+}
+
+void Physics::removeDeadParticles(const bool pRemoveDead) {
+    /* dead particles are removed after dead forces so that springs never refer to removed particles */
+    mStore.recycle();
+    if (!pRemoveDead && mRemovedParticles.empty()) {
+        return;
+    }
+    if (pRemoveDead || !mReleasedParticles.empty()) {
+        /*
+         * constraints drop dead or removed particles before they are released, constraints are applied after this.
+         * a distance constraint latches its dead state so that it does not touch its particles anymore, if dead
+         * objects are kept it is dropped right away. removed constraints may already be destroyed by their owner.
+         */
+        const std::unordered_set<const Constraint*> mRemovedConstraintSet(mRemovedConstraints.begin(), mRemovedConstraints.end());
+        size_t                                      mWrite = 0;
+        for (size_t i = 0; i < mConstraints.size(); ++i) {
+            Constraint* mConstraint = mConstraints[i];
+            if (!mRemovedConstraintSet.empty() && mRemovedConstraintSet.count(mConstraint) > 0) {
+                mConstraints[mWrite++] = mConstraint;
+                continue;
+            }
+            if (const auto mSystem = dynamic_cast<XPBDConstraintSystem*>(mConstraint)) {
+                if (pRemoveDead) {
+                    mSystem->removeDead();
+                } else {
+                    mSystem->removeConnected(mReleasedParticles);
+                }
+            } else if (const auto mDistance = dynamic_cast<XPBDDistanceConstraint*>(mConstraint)) {
+                if (pRemoveDead ? mDistance->dead() : connected(mDistance->a(), mDistance->b())) {
+                    mDistance->dead(true);
+                    if (!pRemoveDead) {
+                        mConstraintHandles.erase(mConstraint);
+                        release(mConstraint);
+                        continue;
                     }
                 }
+            }
+            mConstraints[mWrite++] = mConstraint;
+        }
+        mConstraints.resize(mWrite);
+    }
+    mReleasedParticles.clear();
+    const uint8_t mStoreFlags = pRemoveDead ? ParticleStore::DEAD | ParticleStore::REMOVED : ParticleStore::REMOVED;
+    if (packed() != nullptr) {
+        mRemovedParticles.clear();
+        if (mStore.removeFlagged(mStoreFlags) > 0) {
+            mParticles.assign(mStore.handles(), mStore.handles() + mStore.size());
+            for (const auto& h: mStore.detached()) {
+                mParticleHandles.erase(h);
+            }
+        }
+        return;
+    }
+    /* removed particles may already be destroyed by their owner, so they are identified by address only */
+    collectRemoved(mRemovedParticles);
+    size_t mWrite = 0;
+    for (size_t i = 0; i < mParticles.size(); ++i) {
+        Particle* mParticle = mParticles[i];
+        if ((!mRemovedSet.empty() && mRemovedSet.count(mParticle) > 0) || (pRemoveDead && mParticle->dead())) {
+            mParticleHandles.erase(mParticle);
+            release(mParticle);
+        } else {
+            mParticles[mWrite++] = mParticle;
+        }
+    }
+    mParticles.resize(mWrite);
+    mStore.removeFlagged(mStoreFlags);
+}
+
+namespace {
+    template<uint8_t FLAGS>
+    struct Hints {
+        static constexpr bool RECOVER_NAN                         = FLAGS & PhysicsFlags::FLAG_RECOVER_NAN;
+        static constexpr bool OPTIMIZE_STILL                      = FLAGS & PhysicsFlags::FLAG_OPTIMIZE_STILL;
+        static constexpr bool SET_VELOCITY_FROM_PREVIOUS_POSITION = FLAGS & PhysicsFlags::FLAG_SET_VELOCITY_FROM_PREVIOUS_POSITION;
+        static constexpr bool UPDATE_OLD_POSITION                 = FLAGS & PhysicsFlags::FLAG_UPDATE_OLD_POSITION;
+        static constexpr bool POST                                = SET_VELOCITY_FROM_PREVIOUS_POSITION || UPDATE_OLD_POSITION;
+    };
+
+    template<uint8_t FLAGS>
+    void handleParticle(Particle& pParticle, const float pDeltaTime) {
+        using H = Hints<FLAGS>;
+
+        // Clear force
+        pParticle.force().set(0, 0, 0);
+
+        // Age particle
+        pParticle.age(pParticle.age() + pDeltaTime);
 
-                if (HINT_UPDATE_OLD_POSITION) {
-                    mParticle->old_position().set(mParticle->position());
+        // Recover NaN values
+        if constexpr (H::RECOVER_NAN) {
+            if (Util::isNaN(pParticle.position())) {
+                if (Util::isNaN(pParticle.old_position())) {
+                    pParticle.position().set(0, 0, 0);
+                } else {
+                    pParticle.position().set(pParticle.old_position());
                 }
             }
-        } catch (const std::exception& ex) {
-            if (VERBOSE) {
-                std::cerr << ex.what() << std::endl;
+
+            if (Util::isNaN(pParticle.velocity())) {
+                pParticle.velocity().set(0, 0, 0);
+            }
+        }
+
+        // Optimize still particles
+        if constexpr (H::OPTIMIZE_STILL) {
+            const float mSpeed = pParticle.velocity().magSq();
+            pParticle.still(mSpeed > -Physics::EPSILON && mSpeed < Physics::EPSILON);
+        }
+    }
+
+    template<uint8_t FLAGS>
+    void postHandleParticle(Particle& pParticle) {
+        using H = Hints<FLAGS>;
+        if constexpr (H::SET_VELOCITY_FROM_PREVIOUS_POSITION) {
+            if (pParticle.fixed()) {
+                PVector velocity = PVector::sub(pParticle.position(), pParticle.old_position());
+                pParticle.velocity().set(velocity);
+            }
+        }
+
+        if constexpr (H::UPDATE_OLD_POSITION) {
+            pParticle.old_position().set(pParticle.position());
+        }
+    }
+
+    /* parameters of `Physics::useSleeping()`, thresholds are squared */
+    struct Sleeping {
+        float sleep;
+        float wake;
+        float delay;
+    };
+
+    void updateSleeping(ParticleStore& pStore, const uint32_t i, const float pDeltaTime, const float pSpeedSquared, const Sleeping& pSleeping) {
+        if (pStore.sleeping(i)) {
+            const float mInverseMass = pStore.inverse_masses()[i] * pDeltaTime;
+            if (pStore.force(i).magSq() * mInverseMass * mInverseMass > pSleeping.wake || pSpeedSquared > pSleeping.wake) {
+                pStore.wake(i);
+            }
+        } else if (pSpeedSquared < pSleeping.sleep) {
+            pStore.rest_time(i, pStore.rest_time(i) + pDeltaTime);
+            /* members of islands are put to sleep by `updateSleepingIslands()` */
+            if (pStore.rest_time(i) >= pSleeping.delay && !pStore.flag(i, ParticleStore::ISLAND)) {
+                pStore.sleep(i);
+            }
+        } else {
+            pStore.rest_time(i, 0.0f);
+        }
+    }
+
+    template<uint8_t FLAGS>
+    void handleParticle(ParticleStore& pStore, const uint32_t i, const float pDeltaTime, const Sleeping* pSleeping) {
+        using H = Hints<FLAGS>;
+        if constexpr (H::OPTIMIZE_STILL) {
+            if (pSleeping != nullptr && !pStore.fixed(i)) {
+                updateSleeping(pStore, i, pDeltaTime, pStore.velocity(i).magSq(), *pSleeping);
+            }
+        }
+        pStore.force(i).set(0, 0, 0);
+        pStore.age(i, pStore.age(i) + pDeltaTime);
+        if constexpr (H::RECOVER_NAN) {
+            PVector& mPosition = pStore.position(i);
+            if (Util::isNaN(mPosition)) {
+                if (Util::isNaN(pStore.old_position(i))) {
+                    mPosition.set(0, 0, 0);
+                } else {
+                    mPosition.set(pStore.old_position(i));
+                }
+            }
+            if (Util::isNaN(pStore.velocity(i))) {
+                pStore.velocity(i).set(0, 0, 0);
+            }
+        }
+        if constexpr (H::OPTIMIZE_STILL) {
+            const float mSpeed = pStore.velocity(i).magSq();
+            pStore.flag(i, ParticleStore::STILL, mSpeed > -Physics::EPSILON && mSpeed < Physics::EPSILON);
+        }
+    }
+
+    template<uint8_t FLAGS>
+    void postHandleParticle(ParticleStore& pStore, const uint32_t i) {
+        using H = Hints<FLAGS>;
+        if constexpr (H::SET_VELOCITY_FROM_PREVIOUS_POSITION) {
+            if (pStore.fixed(i)) {
+                pStore.velocity(i) = PVector::sub(pStore.position(i), pStore.old_position(i));
+            }
+        }
+        if constexpr (H::UPDATE_OLD_POSITION) {
+            pStore.old_position(i) = pStore.position(i);
+        }
+    }
+} // namespace
+
+void Physics::finishStep(const float pDeltaTime, const uint8_t pFlags) {
+    static constexpr auto FINISH_STEPS = finishSteps(std::make_index_sequence<1 << PhysicsFlags::NUM_FLAGS>());
+    (this->*FINISH_STEPS[pFlags])(pDeltaTime);
+}
+
+void Physics::updateSleepingIslands() {
+    mIslands.update();
+    const auto& mIslandList = mIslands.islands();
+    for (uint32_t k = 0; k < mIslandList.size(); ++k) {
+        const SpringIslands::Island& mIsland   = mIslandList[k];
+        size_t                       mSleeping = 0;
+        size_t                       mAwake    = 0;
+        bool                         mResting  = true;
+        for (const auto& p: mIsland.particles) {
+            const uint32_t i = storeIndex(p, &mStore);
+            if (i == ParticleStore::INVALID_INDEX) {
+                continue;
+            }
+            if (mStore.sleeping(i)) {
+                ++mSleeping;
+            } else if (!mStore.fixed(i)) {
+                ++mAwake;
+                mResting &= mStore.rest_time(i) >= mSleepDelay;
             }
         }
+        if (mSleeping > 0 && mAwake > 0) {
+            /* one of the particles woke up or joined the island, wake all others */
+            for (const auto& p: mIsland.particles) {
+                p->wake();
+            }
+            mSleeping = 0;
+        } else if (mAwake > 0 && mResting) {
+            for (const auto& p: mIsland.particles) {
+                const uint32_t i = storeIndex(p, &mStore);
+                if (i != ParticleStore::INVALID_INDEX) {
+                    mStore.sleep(i);
+                }
+            }
+            mSleeping += mAwake;
+        }
+        mIslands.sleeping(k, mSleeping > 0);
+    }
+    mIslandWakes = mStore.wakes();
+}
+
+template<uint8_t FLAGS>
+void Physics::finishStep(const float pDeltaTime) {
+    constexpr bool mOptimizeStill = FLAGS & PhysicsFlags::FLAG_OPTIMIZE_STILL;
+    if (mStore.sleeping_count() > 0 && (!mUseSleeping || !mOptimizeStill || packed() == nullptr)) {
+        mStore.wakeAll();
+    }
+    if (mConstraints.empty() && !hasTypedConstraints()) {
+        mRemovedConstraints.clear();
+        handleParticlesFused<FLAGS>(pDeltaTime);
+    } else {
+        handleParticles<FLAGS>(pDeltaTime);
+        handleConstraints(FLAGS & PhysicsFlags::FLAG_REMOVE_DEAD);
+        postHandleParticles<FLAGS>(pDeltaTime);
+    }
+    if (mOptimizeStill && mUseIslands && mUseSleeping && packed() != nullptr) {
+        updateSleepingIslands();
+    }
+}
+
+/* `step<C>()` calls the instantiations directly from other translation units */
+static_assert(PhysicsFlags::NUM_FLAGS == 5, "instantiate `finishStep` for every combination of flags");
+#define TEILCHEN_FINISH_STEP(FLAGS) template void Physics::finishStep<FLAGS>(float);
+#define TEILCHEN_FINISH_STEPS(FLAGS)                                         \
+    TEILCHEN_FINISH_STEP(FLAGS + 0) TEILCHEN_FINISH_STEP(FLAGS + 1)           \
+    TEILCHEN_FINISH_STEP(FLAGS + 2) TEILCHEN_FINISH_STEP(FLAGS + 3)           \
+    TEILCHEN_FINISH_STEP(FLAGS + 4) TEILCHEN_FINISH_STEP(FLAGS + 5)           \
+    TEILCHEN_FINISH_STEP(FLAGS + 6) TEILCHEN_FINISH_STEP(FLAGS + 7)
+TEILCHEN_FINISH_STEPS(0)
+TEILCHEN_FINISH_STEPS(8)
+TEILCHEN_FINISH_STEPS(16)
+TEILCHEN_FINISH_STEPS(24)
+#undef TEILCHEN_FINISH_STEPS
+#undef TEILCHEN_FINISH_STEP
+
+template<uint8_t FLAGS>
+void Physics::handleParticles(const float pDeltaTime) {
+    if (ParticleStore* mPacked = packed()) {
+        handleParticles<FLAGS>(*mPacked, pDeltaTime);
+        return;
+    }
+    try {
+        for (const auto& mParticle: mParticles) {
+            handleParticle<FLAGS>(*mParticle, pDeltaTime);
+        }
+    } catch (const std::exception& ex) {
+        if (VERBOSE) {
+            // Print exception (use proper logging mechanism as needed)
+            std::cerr << ex.what() << std::endl;
+        }
+    }
+}
+
+template<uint8_t FLAGS>
+void Physics::handleParticles(ParticleStore& pStore, const float pDeltaTime) {
+    const Sleeping mSleeping{mSleepThreshold * mSleepThreshold, mWakeThreshold * mWakeThreshold, mSleepDelay};
+    const Sleeping* mSleepingRef = mUseSleeping ? &mSleeping : nullptr;
+    const auto      mSize        = static_cast<uint32_t>(pStore.size());
+    for (uint32_t i = 0; i < mSize; ++i) {
+        handleParticle<FLAGS>(pStore, i, pDeltaTime, mSleepingRef);
     }
-}
\ No newline at end of file
+}
+
+template<uint8_t FLAGS>
+void Physics::postHandleParticles(float pDeltaTime) {
+    (void) pDeltaTime;
+    if constexpr (!Hints<FLAGS>::POST) {
+        return;
+    }
+    if (ParticleStore* mPacked = packed()) {
+        const auto mSize = static_cast<uint32_t>(mPacked->size());
+        for (uint32_t i = 0; i < mSize; ++i) {
+            postHandleParticle<FLAGS>(*mPacked, i);
+        }
+        return;
+    }
+    try {
+        for (const auto& mParticle: mParticles) {
+            postHandleParticle<FLAGS>(*mParticle);
+        }
+    } catch (const std::exception& ex) {
+        if (VERBOSE) {
+            std::cerr << ex.what() << std::endl;
+        }
+    }
+}
+
+template<uint8_t FLAGS>
+void Physics::handleParticlesFused(const float pDeltaTime) {
+    if (ParticleStore* mPacked = packed()) {
+        const Sleeping  mSleeping{mSleepThreshold * mSleepThreshold, mWakeThreshold * mWakeThreshold, mSleepDelay};
+        const Sleeping* mSleepingRef = mUseSleeping ? &mSleeping : nullptr;
+        const auto      mSize        = static_cast<uint32_t>(mPacked->size());
+        for (uint32_t i = 0; i < mSize; ++i) {
+            handleParticle<FLAGS>(*mPacked, i, pDeltaTime, mSleepingRef);
+            postHandleParticle<FLAGS>(*mPacked, i);
+        }
+        return;
+    }
+    try {
+        for (const auto& mParticle: mParticles) {
+            handleParticle<FLAGS>(*mParticle, pDeltaTime);
+            postHandleParticle<FLAGS>(*mParticle);
+        }
+    } catch (const std::exception& ex) {
+        if (VERBOSE) {
+            std::cerr << ex.what() << std::endl;
+        }
+    }
+}
+
+void Physics::handleConstraints(const bool pRemoveDead) {
+    /* removed constraints may already be destroyed by their owner, so they are identified by address only */
+    collectRemoved(mRemovedConstraints);
+    applyTypedConstraints();
+    size_t mWrite = 0;
+    for (size_t i = 0; i < mConstraints.size(); ++i) {
+        Constraint* mConstraint = mConstraints[i];
+        if (!mRemovedSet.empty() && mRemovedSet.count(mConstraint) > 0) {
+            release(mConstraint);
+            continue;
+        }
+        mConstraint->apply(*this); // Apply the constraint
+
+        // Check if the constraint should be removed if it's dead
+        if (pRemoveDead && mConstraint->dead()) {
+            mConstraintHandles.erase(mConstraint);
+            release(mConstraint);
+        } else {
+            mConstraints[mWrite++] = mConstraint;
+        }
+    }
+    mConstraints.resize(mWrite);
+}
@@ -0,0 +1,279 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <typeinfo>
+
+#include "PhysicsRecords.h"
+#include "Physics.h"
+#include "Spring.h"
+#include "Gravity.h"
+#include "Attractor.h"
+#include "ViscousDrag.h"
+#include "Box.h"
+#include "Teleporter.h"
+#include "Midpoint.h"
+#include "RungeKutta.h"
+#include "Verlet.h"
+#include "DormandPrince.h"
+#include "ImplicitEuler.h"
+
+static_assert(sizeof(PVector) == 12, "records require packed vectors");
+static_assert(sizeof(PhysicsRecords::ForceRecord) == 44, "unexpected force record size");
+static_assert(sizeof(PhysicsRecords::ConstraintRecord) == 36, "unexpected constraint record size");
+static_assert(sizeof(PhysicsRecords::IntegratorRecord) == 32, "unexpected integrator record size");
+static_assert(sizeof(PhysicsRecords::SettingsRecord) == 40, "unexpected settings record size");
+
+bool PhysicsRecords::capture(Force* pForce, ForceRecord& pRecord) {
+    pRecord.active = pForce->active();
+    pRecord.dead   = pForce->dead();
+    if (typeid(*pForce) == typeid(Spring)) {
+        const auto mSpring  = static_cast<Spring*>(pForce);
+        pRecord.type        = FORCE_SPRING;
+        pRecord.rest_length = mSpring->restlength();
+        pRecord.strength    = mSpring->strength();
+        pRecord.damping     = mSpring->damping();
+        pRecord.oneway      = mSpring->oneway();
+    } else if (typeid(*pForce) == typeid(Gravity)) {
+        pRecord.type   = FORCE_GRAVITY;
+        pRecord.vector = static_cast<Gravity*>(pForce)->force();
+    } else if (typeid(*pForce) == typeid(Attractor)) {
+        const auto mAttractor = static_cast<Attractor*>(pForce);
+        pRecord.type          = FORCE_ATTRACTOR;
+        pRecord.vector        = mAttractor->position();
+        pRecord.radius        = mAttractor->radius();
+        pRecord.strength      = mAttractor->strength();
+    } else if (typeid(*pForce) == typeid(ViscousDrag)) {
+        pRecord.type     = FORCE_VISCOUS_DRAG;
+        pRecord.strength = static_cast<ViscousDrag*>(pForce)->coefficient;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Force* PhysicsRecords::make(Physics& pPhysics, const ForceRecord& pRecord, Particle* pA, Particle* pB) {
+    Force* mForce = nullptr;
+    switch (pRecord.type) {
+        case FORCE_SPRING:
+            if (pA != nullptr && pB != nullptr) {
+                mForce = pPhysics.makeSpring(pA, pB, pRecord.strength, pRecord.damping, pRecord.rest_length);
+            }
+            break;
+        case FORCE_GRAVITY:
+            mForce = pPhysics.makeForce<Gravity>();
+            break;
+        case FORCE_ATTRACTOR:
+            mForce = pPhysics.makeForce<Attractor>();
+            break;
+        case FORCE_VISCOUS_DRAG:
+            mForce = pPhysics.makeForce<ViscousDrag>();
+            break;
+        default:
+            break;
+    }
+    if (mForce != nullptr) {
+        apply(mForce, pRecord);
+    }
+    return mForce;
+}
+
+void PhysicsRecords::apply(Force* pForce, const ForceRecord& pRecord, Particle* pA, Particle* pB) {
+    switch (pRecord.type) {
+        case FORCE_SPRING: {
+            const auto mSpring = static_cast<Spring*>(pForce);
+            if (pA != nullptr && mSpring->a() != pA) {
+                mSpring->a(pA);
+            }
+            if (pB != nullptr && mSpring->b() != pB) {
+                mSpring->b(pB);
+            }
+            mSpring->restlength(pRecord.rest_length);
+            mSpring->strength(pRecord.strength);
+            mSpring->damping(pRecord.damping);
+            mSpring->setOneWay(pRecord.oneway != 0);
+            break;
+        }
+        case FORCE_GRAVITY:
+            static_cast<Gravity*>(pForce)->force() = pRecord.vector;
+            break;
+        case FORCE_ATTRACTOR: {
+            const auto mAttractor = static_cast<Attractor*>(pForce);
+            mAttractor->setPositionRef(pRecord.vector);
+            mAttractor->radius(pRecord.radius);
+            mAttractor->strength(pRecord.strength);
+            break;
+        }
+        case FORCE_VISCOUS_DRAG:
+            static_cast<ViscousDrag*>(pForce)->coefficient = pRecord.strength;
+            break;
+        default:
+            break;
+    }
+    pForce->active(pRecord.active != 0);
+    pForce->dead(pRecord.dead != 0);
+}
+
+bool PhysicsRecords::capture(Constraint* pConstraint, ConstraintRecord& pRecord) {
+    pRecord.active = pConstraint->active();
+    pRecord.dead   = pConstraint->dead();
+    if (typeid(*pConstraint) == typeid(Box)) {
+        const auto mBox     = static_cast<Box*>(pConstraint);
+        pRecord.type        = CONSTRAINT_BOX;
+        pRecord.min         = mBox->min();
+        pRecord.max         = mBox->max();
+        pRecord.restitution = mBox->coefficientofrestitution();
+        pRecord.reflect     = mBox->reflect();
+        pRecord.teleport    = mBox->teleport();
+    } else if (typeid(*pConstraint) == typeid(Teleporter)) {
+        const auto mTeleporter = static_cast<Teleporter*>(pConstraint);
+        pRecord.type           = CONSTRAINT_TELEPORTER;
+        pRecord.min            = mTeleporter->min();
+        pRecord.max            = mTeleporter->max();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Constraint* PhysicsRecords::make(Physics& pPhysics, const ConstraintRecord& pRecord) {
+    Constraint* mConstraint = nullptr;
+    if (pRecord.type == CONSTRAINT_BOX) {
+        mConstraint = pPhysics.makeConstraint<Box>();
+    } else if (pRecord.type == CONSTRAINT_TELEPORTER) {
+        mConstraint = pPhysics.makeConstraint<Teleporter>();
+    }
+    if (mConstraint != nullptr) {
+        apply(mConstraint, pRecord);
+    }
+    return mConstraint;
+}
+
+void PhysicsRecords::apply(Constraint* pConstraint, const ConstraintRecord& pRecord) {
+    if (pRecord.type == CONSTRAINT_BOX) {
+        const auto mBox = static_cast<Box*>(pConstraint);
+        mBox->min()     = pRecord.min;
+        mBox->max()     = pRecord.max;
+        mBox->coefficientofrestitution(pRecord.restitution);
+        mBox->reflect(pRecord.reflect != 0);
+        mBox->teleport(pRecord.teleport != 0);
+    } else if (pRecord.type == CONSTRAINT_TELEPORTER) {
+        const auto mTeleporter = static_cast<Teleporter*>(pConstraint);
+        mTeleporter->min()     = pRecord.min;
+        mTeleporter->max()     = pRecord.max;
+    }
+    pConstraint->active(pRecord.active != 0);
+    pConstraint->dead(pRecord.dead != 0);
+}
+
+void PhysicsRecords::capture(Integrator* pIntegrator, IntegratorRecord& pRecord) {
+    if (typeid(*pIntegrator) == typeid(Midpoint)) {
+        pRecord.type = INTEGRATOR_MIDPOINT;
+    } else if (typeid(*pIntegrator) == typeid(RungeKutta)) {
+        pRecord.type = INTEGRATOR_RUNGE_KUTTA;
+    } else if (typeid(*pIntegrator) == typeid(Verlet)) {
+        pRecord.type    = INTEGRATOR_VERLET;
+        pRecord.damping = static_cast<Verlet*>(pIntegrator)->damping();
+    } else if (typeid(*pIntegrator) == typeid(DormandPrince)) {
+        const auto mDormandPrince = static_cast<DormandPrince*>(pIntegrator);
+        pRecord.type              = INTEGRATOR_DORMAND_PRINCE;
+        pRecord.tolerance         = mDormandPrince->tolerance();
+        pRecord.min_step          = mDormandPrince->min_step();
+        pRecord.max_step          = mDormandPrince->max_step();
+        pRecord.safety            = mDormandPrince->safety();
+        pRecord.substep           = mDormandPrince->substep();
+    } else if (typeid(*pIntegrator) == typeid(ImplicitEuler)) {
+        const auto mImplicitEuler = static_cast<ImplicitEuler*>(pIntegrator);
+        pRecord.type              = INTEGRATOR_IMPLICIT_EULER;
+        pRecord.iterations        = mImplicitEuler->iterations();
+        pRecord.tolerance         = mImplicitEuler->tolerance();
+    } else {
+        pRecord.type = INTEGRATOR_OTHER;
+    }
+}
+
+Integrator* PhysicsRecords::make(const IntegratorRecord& pRecord) {
+    switch (pRecord.type) {
+        case INTEGRATOR_MIDPOINT:
+            return new Midpoint();
+        case INTEGRATOR_RUNGE_KUTTA:
+            return new RungeKutta();
+        case INTEGRATOR_VERLET:
+            return new Verlet(pRecord.damping);
+        case INTEGRATOR_DORMAND_PRINCE: {
+            const auto mDormandPrince = new DormandPrince();
+            mDormandPrince->tolerance(pRecord.tolerance);
+            mDormandPrince->min_step(pRecord.min_step);
+            mDormandPrince->max_step(pRecord.max_step);
+            mDormandPrince->safety(pRecord.safety);
+            mDormandPrince->substep(pRecord.substep);
+            return mDormandPrince;
+        }
+        case INTEGRATOR_IMPLICIT_EULER: {
+            const auto mImplicitEuler = new ImplicitEuler();
+            mImplicitEuler->iterations(pRecord.iterations);
+            mImplicitEuler->tolerance(pRecord.tolerance);
+            return mImplicitEuler;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+void PhysicsRecords::capture(Physics& pPhysics, SettingsRecord& pRecord) {
+    pRecord.optimize_still                  = pPhysics.HINT_OPTIMIZE_STILL;
+    pRecord.recover_nan                     = pPhysics.HINT_RECOVER_NAN;
+    pRecord.remove_dead                     = pPhysics.HINT_REMOVE_DEAD;
+    pRecord.velocity_from_previous_position = pPhysics.HINT_SET_VELOCITY_FROM_PREVIOUS_POSITION;
+    pRecord.deterministic_reduction         = pPhysics.HINT_DETERMINISTIC_REDUCTION;
+    pRecord.color_springs                   = pPhysics.HINT_COLOR_SPRINGS;
+    pRecord.fuse_particle_forces            = pPhysics.HINT_FUSE_PARTICLE_FORCES;
+    pRecord.particle_store                  = pPhysics.usesParticleStore();
+    pRecord.sleeping                        = pPhysics.usesSleeping();
+    pRecord.islands                         = pPhysics.usesIslands();
+    pRecord.sleep_threshold                 = pPhysics.sleep_threshold();
+    pRecord.wake_threshold                  = pPhysics.wake_threshold();
+    pRecord.sleep_delay                     = pPhysics.sleep_delay();
+    pRecord.fixed_timestep                  = pPhysics.fixed_timestep();
+    pRecord.accumulator                     = pPhysics.accumulator();
+    pRecord.max_substeps                    = pPhysics.max_substeps();
+    pRecord.threads                         = static_cast<uint32_t>(pPhysics.threads());
+}
+
+void PhysicsRecords::apply(Physics& pPhysics, const SettingsRecord& pRecord) {
+    pPhysics.HINT_OPTIMIZE_STILL                      = pRecord.optimize_still != 0;
+    pPhysics.HINT_RECOVER_NAN                         = pRecord.recover_nan != 0;
+    pPhysics.HINT_REMOVE_DEAD                         = pRecord.remove_dead != 0;
+    pPhysics.HINT_SET_VELOCITY_FROM_PREVIOUS_POSITION = pRecord.velocity_from_previous_position != 0;
+    pPhysics.HINT_DETERMINISTIC_REDUCTION             = pRecord.deterministic_reduction != 0;
+    pPhysics.HINT_COLOR_SPRINGS                       = pRecord.color_springs != 0;
+    pPhysics.HINT_FUSE_PARTICLE_FORCES                = pRecord.fuse_particle_forces != 0;
+    pPhysics.useParticleStore(pRecord.particle_store != 0);
+    pPhysics.useSleeping(pRecord.sleeping != 0);
+    pPhysics.useIslands(pRecord.islands != 0);
+    pPhysics.sleep_threshold(pRecord.sleep_threshold);
+    pPhysics.wake_threshold(pRecord.wake_threshold);
+    pPhysics.sleep_delay(pRecord.sleep_delay);
+    pPhysics.fixed_timestep(pRecord.fixed_timestep);
+    pPhysics.max_substeps(pRecord.max_substeps);
+    pPhysics.accumulator(pRecord.accumulator);
+}
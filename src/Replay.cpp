@@ -0,0 +1,485 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "Replay.h"
+#include "Physics.h"
+#include "ParticleHandle.h"
+#include "PhysicsRecords.h"
+#include "Spring.h"
+
+namespace {
+    constexpr char     MAGIC[8]        = {'T', 'E', 'I', 'L', 'R', 'E', 'P', 'L'};
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    using R = ReplayRecorder;
+
+    static_assert(sizeof(PVector) == 12, "replay layout requires packed vectors");
+    static_assert(sizeof(R::Header) == 24, "unexpected replay header size");
+    static_assert(sizeof(R::Event) == 16, "unexpected replay event size");
+    static_assert(sizeof(R::ParticleRecord) == 68, "unexpected replay particle size");
+    static_assert(sizeof(R::StepRecord) == 8, "unexpected replay step size");
+
+    /* records are compared byte for byte, they are zero initialized and have no implicit padding */
+    template<typename T>
+    bool changed(const T& pA, const T& pB) {
+        return std::memcmp(&pA, &pB, sizeof(T)) != 0;
+    }
+
+    template<typename T>
+    T record(const uint8_t* pData) {
+        T mRecord;
+        std::memcpy(&mRecord, pData, sizeof(T));
+        return mRecord;
+    }
+} // namespace
+
+size_t ReplayRecorder::record_size(const uint32_t pType) {
+    switch (pType) {
+        case EVENT_SETTINGS:
+            return sizeof(SettingsRecord);
+        case EVENT_INTEGRATOR:
+            return sizeof(IntegratorRecord);
+        case EVENT_ADD_PARTICLE:
+        case EVENT_SET_PARTICLE:
+            return sizeof(ParticleRecord);
+        case EVENT_ADD_FORCE:
+        case EVENT_SET_FORCE:
+            return sizeof(ForceRecord);
+        case EVENT_ADD_CONSTRAINT:
+        case EVENT_SET_CONSTRAINT:
+            return sizeof(ConstraintRecord);
+        case EVENT_STEP:
+            return sizeof(StepRecord);
+        default:
+            return 0;
+    }
+}
+
+ReplayRecorder::ReplayRecorder(Physics& pPhysics, const std::string& pFilePath, const uint32_t pSeed)
+    : mPhysics(pPhysics),
+      mFile(std::fopen(pFilePath.c_str(), "wb")),
+      mSeed(pSeed) {
+    PVector::randomSeed(mSeed);
+    if (mFile == nullptr) {
+        return;
+    }
+    Header mHeader{};
+    std::memcpy(mHeader.magic, MAGIC, sizeof(MAGIC));
+    mHeader.version    = VERSION;
+    mHeader.byte_order = BYTE_ORDER_MARK;
+    mHeader.seed       = mSeed;
+    mGood              = std::fwrite(&mHeader, sizeof(Header), 1, mFile) == 1;
+
+    /* the system as found, settings first since they decide where particles live */
+    PhysicsRecords::capture(mPhysics, mSettings);
+    write(EVENT_SETTINGS, 0, &mSettings);
+    PhysicsRecords::capture(mPhysics.getIntegrator(), mIntegratorState);
+    mIntegrator = mPhysics.getIntegrator();
+    write(EVENT_INTEGRATOR, 0, &mIntegratorState);
+    for (const auto& p: mPhysics.particles()) {
+        if (mPhysics.handle(p).valid()) {
+            added(p);
+        }
+    }
+    for (const auto& f: mPhysics.forces()) {
+        if (mPhysics.handle(f).valid()) {
+            added(f);
+        }
+    }
+    for (const auto& c: mPhysics.constraints()) {
+        if (mPhysics.handle(c).valid()) {
+            added(c);
+        }
+    }
+    mPhysics.replay_recorder(this);
+}
+
+ReplayRecorder::~ReplayRecorder() {
+    close();
+}
+
+void ReplayRecorder::close() {
+    if (mPhysics.replay_recorder() == this) {
+        mPhysics.replay_recorder(nullptr);
+    }
+    if (mFile != nullptr) {
+        if (std::fclose(mFile) != 0) {
+            mGood = false;
+        }
+        mFile = nullptr;
+    }
+}
+
+void ReplayRecorder::write(const uint32_t pType, const uint32_t pIndex, const void* pRecord) {
+    if (mFile == nullptr) {
+        return;
+    }
+    const Event  mEvent{pType, pIndex, mSteps};
+    const size_t mSize = record_size(pType);
+    if (std::fwrite(&mEvent, sizeof(Event), 1, mFile) != 1 ||
+        (mSize > 0 && std::fwrite(pRecord, mSize, 1, mFile) != 1)) {
+        mGood = false;
+    }
+    ++mEvents;
+}
+
+void ReplayRecorder::added(Particle* pParticle) {
+    if (mStepping) {
+        return;
+    }
+    settings();
+    ParticleRecord mRecord{};
+    capture(pParticle, mRecord);
+    const uint32_t mIndex = mParticles.add(pParticle);
+    mParticleStates.push_back(mRecord);
+    write(EVENT_ADD_PARTICLE, mIndex, &mRecord);
+}
+
+void ReplayRecorder::added(Force* pForce) {
+    if (mStepping) {
+        return;
+    }
+    settings();
+    ForceRecord mRecord{};
+    if (!capture(pForce, mRecord)) {
+        return;
+    }
+    const uint32_t mIndex = mForces.add(pForce);
+    mForceStates.push_back(mRecord);
+    write(EVENT_ADD_FORCE, mIndex, &mRecord);
+}
+
+void ReplayRecorder::added(Constraint* pConstraint) {
+    if (mStepping) {
+        return;
+    }
+    settings();
+    ConstraintRecord mRecord{};
+    if (!PhysicsRecords::capture(pConstraint, mRecord)) {
+        return;
+    }
+    const uint32_t mIndex = mConstraints.add(pConstraint);
+    mConstraintStates.push_back(mRecord);
+    write(EVENT_ADD_CONSTRAINT, mIndex, &mRecord);
+}
+
+void ReplayRecorder::removed(const Particle* pParticle) {
+    const uint32_t mIndex = mParticles.find(pParticle);
+    if (mStepping || mIndex == ReplayTable<Particle>::INVALID_INDEX) {
+        return;
+    }
+    write(EVENT_REMOVE_PARTICLE, mIndex, nullptr);
+    mParticles.erase(mIndex);
+}
+
+void ReplayRecorder::removed(const Force* pForce) {
+    const uint32_t mIndex = mForces.find(pForce);
+    if (mStepping || mIndex == ReplayTable<Force>::INVALID_INDEX) {
+        return;
+    }
+    write(EVENT_REMOVE_FORCE, mIndex, nullptr);
+    mForces.erase(mIndex);
+}
+
+void ReplayRecorder::removed(const Constraint* pConstraint) {
+    const uint32_t mIndex = mConstraints.find(pConstraint);
+    if (mStepping || mIndex == ReplayTable<Constraint>::INVALID_INDEX) {
+        return;
+    }
+    write(EVENT_REMOVE_CONSTRAINT, mIndex, nullptr);
+    mConstraints.erase(mIndex);
+}
+
+void ReplayRecorder::stepping(const float pDeltaTime, const uint8_t pFlags) {
+    settings();
+    IntegratorRecord mIntegratorRecord{};
+    PhysicsRecords::capture(mPhysics.getIntegrator(), mIntegratorRecord);
+    if (mPhysics.getIntegrator() != mIntegrator || changed(mIntegratorRecord, mIntegratorState)) {
+        mIntegrator      = mPhysics.getIntegrator();
+        mIntegratorState = mIntegratorRecord;
+        write(EVENT_INTEGRATOR, 0, &mIntegratorState);
+    }
+
+    /* changes made in between steps */
+    for (uint32_t i = 0; i < mParticles.size(); ++i) {
+        if (Particle* p = mParticles.get(i)) {
+            ParticleRecord mRecord{};
+            capture(p, mRecord);
+            if (changed(mRecord, mParticleStates[i])) {
+                mParticleStates[i] = mRecord;
+                write(EVENT_SET_PARTICLE, i, &mRecord);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < mForces.size(); ++i) {
+        if (Force* f = mForces.get(i)) {
+            ForceRecord mRecord{};
+            if (capture(f, mRecord) && changed(mRecord, mForceStates[i])) {
+                mForceStates[i] = mRecord;
+                write(EVENT_SET_FORCE, i, &mRecord);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < mConstraints.size(); ++i) {
+        if (Constraint* c = mConstraints.get(i)) {
+            ConstraintRecord mRecord{};
+            if (PhysicsRecords::capture(c, mRecord) && changed(mRecord, mConstraintStates[i])) {
+                mConstraintStates[i] = mRecord;
+                write(EVENT_SET_CONSTRAINT, i, &mRecord);
+            }
+        }
+    }
+
+    const StepRecord mStep{pDeltaTime, pFlags};
+    write(EVENT_STEP, 0, &mStep);
+    ++mSteps;
+    /* a session that ends in a crash is still replayable up to the last step */
+    if (mFile != nullptr && std::fflush(mFile) != 0) {
+        mGood = false;
+    }
+    mStepping = true;
+}
+
+void ReplayRecorder::stepped() {
+    mStepping = false;
+    /* the state after the step is what changes in between steps are compared to */
+    mParticles.update(mPhysics.particles(), [this](const uint32_t i, Particle* p) {
+        capture(p, mParticleStates[i]);
+    });
+    mForces.update(mPhysics.forces(), [this](const uint32_t i, Force* f) {
+        capture(f, mForceStates[i]);
+    });
+    mConstraints.update(mPhysics.constraints(), [this](const uint32_t i, Constraint* c) {
+        PhysicsRecords::capture(c, mConstraintStates[i]);
+    });
+    PhysicsRecords::capture(mPhysics.getIntegrator(), mIntegratorState);
+}
+
+void ReplayRecorder::capture(Particle* pParticle, ParticleRecord& pRecord) const {
+    const auto mHandle    = dynamic_cast<const ParticleHandle*>(pParticle);
+    pRecord.position      = pParticle->position();
+    pRecord.old_position  = pParticle->old_position();
+    pRecord.velocity      = pParticle->velocity();
+    pRecord.force         = pParticle->force();
+    pRecord.mass          = pParticle->mass();
+    pRecord.age           = pParticle->age();
+    pRecord.radius        = pParticle->radius();
+    pRecord.rest_time     = mHandle != nullptr && mHandle->attached() ? mHandle->store()->rest_time(mHandle->index()) : 0.0f;
+    pRecord.flags         = (pParticle->fixed() ? ParticleStore::FIXED : 0) |
+                            (pParticle->dead() ? ParticleStore::DEAD : 0) |
+                            (pParticle->tagged() ? ParticleStore::TAGGED : 0) |
+                            (pParticle->still() ? ParticleStore::STILL : 0) |
+                            (pParticle->sleeping() ? ParticleStore::SLEEPING : 0);
+    pRecord.stored        = mHandle != nullptr;
+}
+
+bool ReplayRecorder::capture(Force* pForce, ForceRecord& pRecord) const {
+    if (!PhysicsRecords::capture(pForce, pRecord)) {
+        return false;
+    }
+    if (pRecord.type == PhysicsRecords::FORCE_SPRING) {
+        const auto mSpring = static_cast<Spring*>(pForce);
+        pRecord.a          = mParticles.find(mSpring->a());
+        pRecord.b          = mParticles.find(mSpring->b());
+        return pRecord.a != ReplayTable<Particle>::INVALID_INDEX && pRecord.b != ReplayTable<Particle>::INVALID_INDEX;
+    }
+    return true;
+}
+
+void ReplayRecorder::settings() {
+    SettingsRecord mRecord{};
+    PhysicsRecords::capture(mPhysics, mRecord);
+    if (changed(mRecord, mSettings)) {
+        mSettings = mRecord;
+        write(EVENT_SETTINGS, 0, &mSettings);
+    }
+}
+
+/* replayer */
+
+Replayer::Replayer(const std::string& pFilePath) {
+    mFile = std::fopen(pFilePath.c_str(), "rb");
+    if (mFile == nullptr) {
+        return;
+    }
+    ReplayRecorder::Header mHeader{};
+    if (std::fread(&mHeader, sizeof(mHeader), 1, mFile) != 1 ||
+        std::memcmp(mHeader.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        mHeader.version != ReplayRecorder::VERSION ||
+        mHeader.byte_order != BYTE_ORDER_MARK) {
+        std::fclose(mFile);
+        mFile = nullptr;
+        return;
+    }
+    mSeed = mHeader.seed;
+    PVector::randomSeed(mSeed);
+}
+
+Replayer::~Replayer() {
+    if (mFile != nullptr) {
+        std::fclose(mFile);
+    }
+}
+
+bool Replayer::next(Physics& pPhysics) {
+    if (mFile == nullptr) {
+        return false;
+    }
+    ReplayRecorder::Event mEvent{};
+    uint8_t               mRecord[sizeof(ReplayRecorder::ParticleRecord)];
+    /* a truncated event at the end of the file ends the session */
+    while (std::fread(&mEvent, sizeof(mEvent), 1, mFile) == 1) {
+        if (mEvent.type == 0 || mEvent.type >= ReplayRecorder::NUM_EVENT_TYPES) {
+            return false;
+        }
+        const size_t mSize = ReplayRecorder::record_size(mEvent.type);
+        if (mSize > 0 && std::fread(mRecord, mSize, 1, mFile) != 1) {
+            return false;
+        }
+        if (mEvent.type == ReplayRecorder::EVENT_STEP) {
+            const auto mStepRecord = record<ReplayRecorder::StepRecord>(mRecord);
+            pPhysics.advanceStep(mStepRecord.delta_time, static_cast<uint8_t>(mStepRecord.flags));
+            ++mStep;
+            return true;
+        }
+        apply(pPhysics, mEvent, mRecord);
+    }
+    return false;
+}
+
+uint64_t Replayer::run(Physics& pPhysics) {
+    uint64_t mSteps = 0;
+    while (next(pPhysics)) {
+        ++mSteps;
+    }
+    return mSteps;
+}
+
+void Replayer::apply(Physics& pPhysics, const ReplayRecorder::Event& pEvent, const uint8_t* pRecord) {
+    using R = ReplayRecorder;
+    switch (pEvent.type) {
+        case R::EVENT_SETTINGS: {
+            const auto mSettings = record<R::SettingsRecord>(pRecord);
+            PhysicsRecords::apply(pPhysics, mSettings);
+            pPhysics.threads(std::max<size_t>(mSettings.threads, 1));
+            break;
+        }
+        case R::EVENT_INTEGRATOR:
+            if (Integrator* mIntegrator = PhysicsRecords::make(record<R::IntegratorRecord>(pRecord))) {
+                pPhysics.replace_integrator(mIntegrator);
+            }
+            break;
+        case R::EVENT_ADD_PARTICLE: {
+            const auto mRecord = record<R::ParticleRecord>(pRecord);
+            Particle*  mParticle;
+            if (mRecord.stored) {
+                mParticle = pPhysics.store().make();
+                pPhysics.add(mParticle, false);
+            } else {
+                mParticle = pPhysics.makeParticle<BasicParticle>();
+            }
+            mParticles.add(mParticle);
+            apply(mParticle, mRecord);
+            break;
+        }
+        case R::EVENT_ADD_FORCE: {
+            const auto mRecord = record<R::ForceRecord>(pRecord);
+            /* the index is taken in any case so that later events refer to the right forces */
+            mForces.add(PhysicsRecords::make(pPhysics, mRecord, mParticles.get(mRecord.a), mParticles.get(mRecord.b)));
+            break;
+        }
+        case R::EVENT_ADD_CONSTRAINT:
+            mConstraints.add(PhysicsRecords::make(pPhysics, record<R::ConstraintRecord>(pRecord)));
+            break;
+        case R::EVENT_SET_PARTICLE:
+            if (Particle* p = mParticles.get(pEvent.index)) {
+                apply(p, record<R::ParticleRecord>(pRecord));
+            }
+            break;
+        case R::EVENT_SET_FORCE:
+            if (Force* f = mForces.get(pEvent.index)) {
+                /* springs follow their particles when these were exchanged */
+                const auto mRecord = record<R::ForceRecord>(pRecord);
+                PhysicsRecords::apply(f, mRecord, mParticles.get(mRecord.a), mParticles.get(mRecord.b));
+            }
+            break;
+        case R::EVENT_SET_CONSTRAINT:
+            if (Constraint* c = mConstraints.get(pEvent.index)) {
+                PhysicsRecords::apply(c, record<R::ConstraintRecord>(pRecord));
+            }
+            break;
+        case R::EVENT_REMOVE_PARTICLE:
+            if (Particle* p = mParticles.get(pEvent.index)) {
+                pPhysics.remove(p);
+                mParticles.erase(pEvent.index);
+            }
+            break;
+        case R::EVENT_REMOVE_FORCE:
+            if (Force* f = mForces.get(pEvent.index)) {
+                pPhysics.remove(f);
+                mForces.erase(pEvent.index);
+            }
+            break;
+        case R::EVENT_REMOVE_CONSTRAINT:
+            if (Constraint* c = mConstraints.get(pEvent.index)) {
+                pPhysics.remove(c);
+                mConstraints.erase(pEvent.index);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Replayer::apply(Particle* pParticle, const ReplayRecorder::ParticleRecord& pRecord) {
+    /* putting a particle to sleep clears its velocity, so the sleeping state goes first */
+    const auto mHandle = dynamic_cast<ParticleHandle*>(pParticle);
+    if (mHandle != nullptr && mHandle->attached()) {
+        ParticleStore* mStore    = mHandle->store();
+        const bool     mSleeping = pRecord.flags & ParticleStore::SLEEPING;
+        if (mSleeping != mStore->sleeping(mHandle->index())) {
+            if (mSleeping) {
+                mStore->sleep(mHandle->index());
+            } else {
+                mStore->wake(mHandle->index());
+            }
+        }
+    }
+    pParticle->setPositionRef(pRecord.position);
+    pParticle->old_position() = pRecord.old_position;
+    pParticle->velocity()     = pRecord.velocity;
+    pParticle->force()        = pRecord.force;
+    pParticle->mass(pRecord.mass);
+    pParticle->age(pRecord.age);
+    pParticle->radius(pRecord.radius);
+    pParticle->fixed(pRecord.flags & ParticleStore::FIXED);
+    pParticle->dead(pRecord.flags & ParticleStore::DEAD);
+    pParticle->tag(pRecord.flags & ParticleStore::TAGGED);
+    pParticle->still(pRecord.flags & ParticleStore::STILL);
+    if (mHandle != nullptr && mHandle->attached()) {
+        mHandle->store()->rest_time(mHandle->index(), pRecord.rest_time);
+    }
+}
@@ -0,0 +1,457 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Snapshot.h"
+#include "Physics.h"
+#include "ParticleHandle.h"
+#include "PhysicsRecords.h"
+#include "Spring.h"
+
+namespace {
+    constexpr char     MAGIC[8]        = {'T', 'E', 'I', 'L', 'C', 'H', 'E', 'N'};
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr uint64_t ALIGNMENT       = 64;
+    constexpr uint32_t NO_PARTICLE     = PhysicsRecords::NO_PARTICLE;
+    /* particle flags that are meaningful outside of the store they were saved from */
+    constexpr uint8_t PARTICLE_FLAGS = ParticleStore::FIXED | ParticleStore::DEAD | ParticleStore::TAGGED | ParticleStore::STILL | ParticleStore::SLEEPING;
+
+    enum SectionType : uint32_t {
+        SECTION_POSITIONS = 1,
+        SECTION_OLD_POSITIONS,
+        SECTION_VELOCITIES,
+        SECTION_FORCES,
+        SECTION_MASSES,
+        SECTION_AGES,
+        SECTION_RADII,
+        SECTION_REST_TIMES,
+        SECTION_FLAGS,
+        SECTION_IDS,
+        SECTION_FORCE_LIST,
+        SECTION_CONSTRAINTS,
+        SECTION_INTEGRATOR,
+        SECTION_SETTINGS,
+        NUM_SECTION_TYPES
+    };
+
+    using ForceRecord      = PhysicsRecords::ForceRecord;
+    using ConstraintRecord = PhysicsRecords::ConstraintRecord;
+    using IntegratorRecord = PhysicsRecords::IntegratorRecord;
+    using SettingsRecord   = PhysicsRecords::SettingsRecord;
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t sections;
+        uint32_t reserved;
+    };
+
+    struct Section {
+        uint32_t type;
+        uint32_t element_size;
+        uint64_t count;
+        uint64_t offset;
+    };
+
+    static_assert(sizeof(PVector) == 12, "snapshot layout requires packed vectors");
+    static_assert(sizeof(Header) == 24, "unexpected snapshot header size");
+    static_assert(sizeof(Section) == 24, "unexpected snapshot section size");
+
+    constexpr uint32_t ELEMENT_SIZES[NUM_SECTION_TYPES] = {
+        0,
+        sizeof(PVector),
+        sizeof(PVector),
+        sizeof(PVector),
+        sizeof(PVector),
+        sizeof(float),
+        sizeof(float),
+        sizeof(float),
+        sizeof(float),
+        sizeof(uint8_t),
+        sizeof(int64_t),
+        sizeof(ForceRecord),
+        sizeof(ConstraintRecord),
+        sizeof(IntegratorRecord),
+        sizeof(SettingsRecord)};
+
+    /* a section to be written, `data` points to `count` elements of `element_size` bytes */
+    struct Block {
+        uint32_t    type;
+        uint32_t    element_size;
+        uint64_t    count;
+        const void* data;
+    };
+
+    template<typename T>
+    void add(std::vector<Block>& pBlocks, const uint32_t pType, const T* pData, const size_t pCount) {
+        pBlocks.push_back({pType, sizeof(T), pCount, pData});
+    }
+
+    uint64_t aligned(const uint64_t pOffset) {
+        return (pOffset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    bool write(const std::string& pFilePath, const std::vector<Block>& pBlocks) {
+        Header mHeader{};
+        std::memcpy(mHeader.magic, MAGIC, sizeof(MAGIC));
+        mHeader.version    = Snapshot::VERSION;
+        mHeader.byte_order = BYTE_ORDER_MARK;
+        mHeader.sections   = static_cast<uint32_t>(pBlocks.size());
+
+        std::vector<Section> mSections(pBlocks.size());
+        uint64_t             mOffset = aligned(sizeof(Header) + sizeof(Section) * pBlocks.size());
+        for (size_t i = 0; i < pBlocks.size(); ++i) {
+            mSections[i] = {pBlocks[i].type, pBlocks[i].element_size, pBlocks[i].count, mOffset};
+            mOffset      = aligned(mOffset + pBlocks[i].element_size * pBlocks[i].count);
+        }
+
+        std::FILE* mFile = std::fopen(pFilePath.c_str(), "wb");
+        if (mFile == nullptr) {
+            return false;
+        }
+        static constexpr char PADDING[ALIGNMENT] = {};
+        bool                  mGood              = true;
+        uint64_t              mPosition          = 0;
+        const auto            mWrite             = [&](const void* pData, const size_t pSize) {
+            if (pSize > 0 && std::fwrite(pData, pSize, 1, mFile) != 1) {
+                mGood = false;
+            }
+            mPosition += pSize;
+        };
+        mWrite(&mHeader, sizeof(Header));
+        mWrite(mSections.data(), sizeof(Section) * mSections.size());
+        for (size_t i = 0; i < pBlocks.size() && mGood; ++i) {
+            mWrite(PADDING, mSections[i].offset - mPosition);
+            mWrite(pBlocks[i].data, pBlocks[i].element_size * pBlocks[i].count);
+        }
+        mWrite(PADDING, mOffset - mPosition);
+        return std::fclose(mFile) == 0 && mGood;
+    }
+
+    template<typename T>
+    const T* elements(const uint8_t* pData, const Section* pSection) {
+        return pSection == nullptr ? nullptr : reinterpret_cast<const T*>(pData + pSection->offset);
+    }
+
+    uint64_t count(const Section* pSection) {
+        return pSection == nullptr ? 0 : pSection->count;
+    }
+} // namespace
+
+bool Snapshot::save(Physics& pPhysics, const std::string& pFilePath) {
+    const auto&    mParticles = pPhysics.particles();
+    ParticleStore* mStore     = pPhysics.packed();
+
+    /* particles removed since the last step are not saved, the store marks them instead of removing them */
+    if (mStore != nullptr) {
+        const uint8_t* mFlags = mStore->flags();
+        if (std::any_of(mFlags, mFlags + mStore->size(), [](const uint8_t f) { return f & ParticleStore::REMOVED; })) {
+            mStore = nullptr;
+        }
+    }
+
+    std::vector<PVector>                          mPositions;
+    std::vector<PVector>                          mOldPositions;
+    std::vector<PVector>                          mVelocities;
+    std::vector<PVector>                          mForces;
+    std::vector<float>                            mMasses;
+    std::vector<float>                            mAges;
+    std::vector<float>                            mRadii;
+    std::vector<float>                            mRestTimes;
+    std::vector<uint8_t>                          mFlags;
+    std::vector<int64_t>                          mIDs;
+    std::unordered_map<const Particle*, uint32_t> mIndices;
+    std::vector<Block>                            mBlocks;
+
+    if (mStore != nullptr) {
+        /* the store already holds every field in snapshot layout */
+        const size_t mCount = mStore->size();
+        mFlags.resize(mCount);
+        mIDs.resize(mCount);
+        for (size_t i = 0; i < mCount; ++i) {
+            mFlags[i] = mStore->flags()[i] & PARTICLE_FLAGS;
+            mIDs[i]   = mStore->ids()[i];
+        }
+        add(mBlocks, SECTION_POSITIONS, mStore->positions(), mCount);
+        add(mBlocks, SECTION_OLD_POSITIONS, mStore->old_positions(), mCount);
+        add(mBlocks, SECTION_VELOCITIES, mStore->velocities(), mCount);
+        add(mBlocks, SECTION_FORCES, mStore->forces(), mCount);
+        add(mBlocks, SECTION_MASSES, mStore->masses(), mCount);
+        add(mBlocks, SECTION_AGES, mStore->ages(), mCount);
+        add(mBlocks, SECTION_RADII, mStore->radii(), mCount);
+        add(mBlocks, SECTION_REST_TIMES, mStore->rest_times(), mCount);
+    } else {
+        for (const auto& p: mParticles) {
+            const auto mHandle = dynamic_cast<ParticleHandle*>(p);
+            if (!pPhysics.handle(p).valid() || (mHandle != nullptr && !mHandle->attached())) {
+                continue;
+            }
+            mIndices.emplace(p, static_cast<uint32_t>(mPositions.size()));
+            mPositions.push_back(p->position());
+            mOldPositions.push_back(p->old_position());
+            mVelocities.push_back(p->velocity());
+            mForces.push_back(p->force());
+            mMasses.push_back(p->mass());
+            mAges.push_back(p->age());
+            mRadii.push_back(p->radius());
+            mRestTimes.push_back(mHandle != nullptr ? mHandle->store()->rest_time(mHandle->index()) : 0.0f);
+            mFlags.push_back((p->fixed() ? ParticleStore::FIXED : 0) |
+                             (p->dead() ? ParticleStore::DEAD : 0) |
+                             (p->tagged() ? ParticleStore::TAGGED : 0) |
+                             (p->still() ? ParticleStore::STILL : 0) |
+                             (p->sleeping() ? ParticleStore::SLEEPING : 0));
+            mIDs.push_back(p->ID());
+        }
+        add(mBlocks, SECTION_POSITIONS, mPositions.data(), mPositions.size());
+        add(mBlocks, SECTION_OLD_POSITIONS, mOldPositions.data(), mOldPositions.size());
+        add(mBlocks, SECTION_VELOCITIES, mVelocities.data(), mVelocities.size());
+        add(mBlocks, SECTION_FORCES, mForces.data(), mForces.size());
+        add(mBlocks, SECTION_MASSES, mMasses.data(), mMasses.size());
+        add(mBlocks, SECTION_AGES, mAges.data(), mAges.size());
+        add(mBlocks, SECTION_RADII, mRadii.data(), mRadii.size());
+        add(mBlocks, SECTION_REST_TIMES, mRestTimes.data(), mRestTimes.size());
+    }
+    add(mBlocks, SECTION_FLAGS, mFlags.data(), mFlags.size());
+    add(mBlocks, SECTION_IDS, mIDs.data(), mIDs.size());
+
+    /* forces in the order of the force list, springs refer to their particles by index */
+    const auto mIndex = [&](const Particle* p) -> uint32_t {
+        if (mStore != nullptr) {
+            const auto mHandle = dynamic_cast<const ParticleHandle*>(p);
+            return mHandle != nullptr && mHandle->store() == mStore && mHandle->attached() ? mHandle->index() : NO_PARTICLE;
+        }
+        const auto it = mIndices.find(p);
+        return it == mIndices.end() ? NO_PARTICLE : it->second;
+    };
+    std::vector<ForceRecord> mForceList;
+    for (const auto& f: pPhysics.forces()) {
+        ForceRecord mRecord{};
+        if (!pPhysics.handle(f).valid() || !PhysicsRecords::capture(f, mRecord)) {
+            continue;
+        }
+        if (mRecord.type == PhysicsRecords::FORCE_SPRING) {
+            const auto mSpring = static_cast<Spring*>(f);
+            mRecord.a          = mIndex(mSpring->a());
+            mRecord.b          = mIndex(mSpring->b());
+            if (mRecord.a == NO_PARTICLE || mRecord.b == NO_PARTICLE) {
+                continue;
+            }
+        }
+        mForceList.push_back(mRecord);
+    }
+    add(mBlocks, SECTION_FORCE_LIST, mForceList.data(), mForceList.size());
+
+    std::vector<ConstraintRecord> mConstraints;
+    for (const auto& c: pPhysics.constraints()) {
+        ConstraintRecord mRecord{};
+        if (pPhysics.handle(c).valid() && PhysicsRecords::capture(c, mRecord)) {
+            mConstraints.push_back(mRecord);
+        }
+    }
+    add(mBlocks, SECTION_CONSTRAINTS, mConstraints.data(), mConstraints.size());
+
+    IntegratorRecord mIntegrator{};
+    PhysicsRecords::capture(pPhysics.getIntegrator(), mIntegrator);
+    add(mBlocks, SECTION_INTEGRATOR, &mIntegrator, 1);
+
+    SettingsRecord mSettings{};
+    PhysicsRecords::capture(pPhysics, mSettings);
+    add(mBlocks, SECTION_SETTINGS, &mSettings, 1);
+
+    return write(pFilePath, mBlocks);
+}
+
+bool Snapshot::load(Physics& pPhysics, const std::string& pFilePath) {
+#if defined(__unix__) || defined(__APPLE__)
+    const int mFile = open(pFilePath.c_str(), O_RDONLY);
+    if (mFile < 0) {
+        return false;
+    }
+    struct stat mStat {};
+    if (fstat(mFile, &mStat) != 0 || mStat.st_size <= 0) {
+        close(mFile);
+        return false;
+    }
+    const auto mSize = static_cast<size_t>(mStat.st_size);
+    void*      mData = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+    close(mFile);
+    if (mData == MAP_FAILED) {
+        return false;
+    }
+    madvise(mData, mSize, MADV_SEQUENTIAL);
+    const bool mLoaded = load(pPhysics, mData, mSize);
+    munmap(mData, mSize);
+    return mLoaded;
+#else
+    std::FILE* mFile = std::fopen(pFilePath.c_str(), "rb");
+    if (mFile == nullptr) {
+        return false;
+    }
+    std::vector<uint8_t> mData;
+    uint8_t              mChunk[1 << 16];
+    size_t               mRead;
+    while ((mRead = std::fread(mChunk, 1, sizeof(mChunk), mFile)) > 0) {
+        mData.insert(mData.end(), mChunk, mChunk + mRead);
+    }
+    std::fclose(mFile);
+    return load(pPhysics, mData.data(), mData.size());
+#endif
+}
+
+bool Snapshot::load(Physics& pPhysics, const void* pData, const size_t pSize) {
+    const auto mData = static_cast<const uint8_t*>(pData);
+    Header     mHeader{};
+    if (pSize < sizeof(Header)) {
+        return false;
+    }
+    std::memcpy(&mHeader, mData, sizeof(Header));
+    if (std::memcmp(mHeader.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        mHeader.version != VERSION ||
+        mHeader.byte_order != BYTE_ORDER_MARK ||
+        mHeader.sections > (pSize - sizeof(Header)) / sizeof(Section)) {
+        return false;
+    }
+
+    /* validate everything before the system is modified */
+    const auto     mTable                       = reinterpret_cast<const Section*>(mData + sizeof(Header));
+    const Section* mSections[NUM_SECTION_TYPES] = {};
+    for (uint32_t i = 0; i < mHeader.sections; ++i) {
+        const Section& mSection = mTable[i];
+        if (mSection.element_size == 0 ||
+            mSection.offset > pSize ||
+            mSection.offset % ALIGNMENT != 0 ||
+            mSection.count > (pSize - mSection.offset) / mSection.element_size) {
+            return false;
+        }
+        if (mSection.type == 0 || mSection.type >= NUM_SECTION_TYPES) {
+            continue;
+        }
+        if (mSection.element_size != ELEMENT_SIZES[mSection.type]) {
+            return false;
+        }
+        mSections[mSection.type] = &mSection;
+    }
+    const uint64_t mCount = count(mSections[SECTION_POSITIONS]);
+    for (uint32_t t = SECTION_POSITIONS; t <= SECTION_IDS; ++t) {
+        if (mSections[t] == nullptr || mSections[t]->count != mCount) {
+            return false;
+        }
+    }
+    const auto mForceList = elements<ForceRecord>(mData, mSections[SECTION_FORCE_LIST]);
+    for (uint64_t i = 0; i < count(mSections[SECTION_FORCE_LIST]); ++i) {
+        if (mForceList[i].type == PhysicsRecords::FORCE_SPRING && (mForceList[i].a >= mCount || mForceList[i].b >= mCount)) {
+            return false;
+        }
+    }
+    if (count(mSections[SECTION_INTEGRATOR]) > 1 || count(mSections[SECTION_SETTINGS]) > 1) {
+        return false;
+    }
+
+    /* settings first, they decide where particles live and which structures springs are registered with */
+    if (count(mSections[SECTION_SETTINGS]) == 1) {
+        PhysicsRecords::apply(pPhysics, *elements<SettingsRecord>(mData, mSections[SECTION_SETTINGS]));
+    }
+    if (count(mSections[SECTION_INTEGRATOR]) == 1) {
+        if (Integrator* mIntegrator = PhysicsRecords::make(*elements<IntegratorRecord>(mData, mSections[SECTION_INTEGRATOR]))) {
+            pPhysics.replace_integrator(mIntegrator);
+        }
+    }
+
+    /* particles */
+    ParticleStore::Columns mColumns{};
+    mColumns.positions     = elements<PVector>(mData, mSections[SECTION_POSITIONS]);
+    mColumns.old_positions = elements<PVector>(mData, mSections[SECTION_OLD_POSITIONS]);
+    mColumns.velocities    = elements<PVector>(mData, mSections[SECTION_VELOCITIES]);
+    mColumns.forces        = elements<PVector>(mData, mSections[SECTION_FORCES]);
+    mColumns.masses        = elements<float>(mData, mSections[SECTION_MASSES]);
+    mColumns.ages          = elements<float>(mData, mSections[SECTION_AGES]);
+    mColumns.radii         = elements<float>(mData, mSections[SECTION_RADII]);
+    mColumns.rest_times    = elements<float>(mData, mSections[SECTION_REST_TIMES]);
+    mColumns.flags         = elements<uint8_t>(mData, mSections[SECTION_FLAGS]);
+    mColumns.ids           = elements<int64_t>(mData, mSections[SECTION_IDS]);
+
+    const bool mUseStore = pPhysics.usesParticleStore();
+    size_t     mFirst    = pPhysics.particles().size();
+    if (mUseStore) {
+        mFirst = pPhysics.appendParticles(mCount, mColumns);
+    } else {
+        /* particles outside of the store are issued new IDs */
+        for (uint64_t i = 0; i < mCount; ++i) {
+            Particle* mParticle = pPhysics.makeParticle();
+            mParticle->setPositionRef(mColumns.positions[i]);
+            mParticle->old_position() = mColumns.old_positions[i];
+            mParticle->velocity()     = mColumns.velocities[i];
+            mParticle->force()        = mColumns.forces[i];
+            mParticle->mass(mColumns.masses[i]);
+            mParticle->age(mColumns.ages[i]);
+            mParticle->radius(mColumns.radii[i]);
+            mParticle->fixed(mColumns.flags[i] & ParticleStore::FIXED);
+            mParticle->dead(mColumns.flags[i] & ParticleStore::DEAD);
+            mParticle->tag(mColumns.flags[i] & ParticleStore::TAGGED);
+            mParticle->still(mColumns.flags[i] & ParticleStore::STILL);
+        }
+    }
+    const auto& mParticles = pPhysics.particles();
+
+    /* forces */
+    for (uint64_t i = 0; i < count(mSections[SECTION_FORCE_LIST]); ++i) {
+        const ForceRecord& mRecord = mForceList[i];
+        if (mRecord.type == PhysicsRecords::FORCE_SPRING) {
+            PhysicsRecords::make(pPhysics, mRecord, mParticles[mFirst + mRecord.a], mParticles[mFirst + mRecord.b]);
+        } else {
+            PhysicsRecords::make(pPhysics, mRecord);
+        }
+    }
+
+    /* adding forces wakes particles, restore the sleeping state as saved */
+    if (mUseStore && mCount > 0) {
+        ParticleStore& mStore = pPhysics.store();
+        const uint32_t mSlot  = static_cast<ParticleHandle*>(mParticles[mFirst])->index();
+        for (uint32_t i = 0; i < mCount; ++i) {
+            if ((mColumns.flags[i] & ParticleStore::SLEEPING) && !mStore.sleeping(mSlot + i)) {
+                mStore.sleep(mSlot + i);
+            }
+            mStore.rest_time(mSlot + i, mColumns.rest_times[i]);
+        }
+    }
+
+    /* constraints */
+    const auto mConstraints = elements<ConstraintRecord>(mData, mSections[SECTION_CONSTRAINTS]);
+    for (uint64_t i = 0; i < count(mSections[SECTION_CONSTRAINTS]); ++i) {
+        PhysicsRecords::make(pPhysics, mConstraints[i]);
+    }
+    return true;
+}
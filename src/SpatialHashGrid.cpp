@@ -0,0 +1,209 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include "SpatialHashGrid.h"
+#include "ThreadPool.h"
+
+SpatialHashGrid::SpatialHashGrid(const float pCellSize)
+    : mCellSize(pCellSize),
+      mInverseCellSize(1.0f / pCellSize) {}
+
+void SpatialHashGrid::cell_size(const float pCellSize) {
+    mCellSize        = pCellSize;
+    mInverseCellSize = 1.0f / pCellSize;
+}
+
+void SpatialHashGrid::clear() {
+    mParticles.clear();
+    mPositions.clear();
+    mHashes.clear();
+    mCellStart.assign(mMask + 2, 0);
+    mMin = {0, 0, 0};
+    mMax = {-1, -1, -1};
+}
+
+void SpatialHashGrid::build(const std::vector<Particle*>& pParticles, ThreadPool* pThreadPool) {
+    const size_t mSize      = pParticles.size();
+    uint32_t     mTableSize = 64;
+    while (mTableSize < 2 * mSize) {
+        mTableSize <<= 1;
+    }
+    mMask = mTableSize - 1;
+    mHashes.resize(mSize);
+    mParticles.resize(mSize);
+    mPositions.resize(mSize);
+    mCellStart.assign(mTableSize + 1, 0);
+
+    /* counting sort: per chunk histograms, a prefix sum over buckets and chunks, then a stable per chunk scatter */
+    const size_t mChunks = pThreadPool != nullptr ? pThreadPool->chunks(mSize, PARALLEL_GRAIN_SIZE) : 1;
+    mCounts.resize(mChunks);
+    mChunkMin.resize(mChunks);
+    mChunkMax.resize(mChunks);
+    const auto mCount = [&](const size_t pBegin, const size_t pEnd, const size_t pChunk) {
+        std::vector<uint32_t>& mHistogram = mCounts[pChunk];
+        mHistogram.assign(mTableSize, 0);
+        Cell mChunkMin{INT32_MAX, INT32_MAX, INT32_MAX};
+        Cell mChunkMax{INT32_MIN, INT32_MIN, INT32_MIN};
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            const Cell c = cell(pParticles[i]->position());
+            mChunkMin    = {std::min(mChunkMin.x, c.x), std::min(mChunkMin.y, c.y), std::min(mChunkMin.z, c.z)};
+            mChunkMax    = {std::max(mChunkMax.x, c.x), std::max(mChunkMax.y, c.y), std::max(mChunkMax.z, c.z)};
+            mHashes[i]   = bucket(c.x, c.y, c.z);
+            ++mHistogram[mHashes[i]];
+        }
+        this->mChunkMin[pChunk] = mChunkMin;
+        this->mChunkMax[pChunk] = mChunkMax;
+    };
+    const auto mScatter = [&](const size_t pBegin, const size_t pEnd, const size_t pChunk) {
+        std::vector<uint32_t>& mOffsets = mCounts[pChunk];
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            const uint32_t mIndex = mOffsets[mHashes[i]]++;
+            mParticles[mIndex]    = pParticles[i];
+            mPositions[mIndex]    = pParticles[i]->position();
+        }
+    };
+
+    if (mChunks > 1) {
+        pThreadPool->run(mSize, PARALLEL_GRAIN_SIZE, mCount);
+    } else {
+        mCount(0, mSize, 0);
+    }
+    mMin = {INT32_MAX, INT32_MAX, INT32_MAX};
+    mMax = {INT32_MIN, INT32_MIN, INT32_MIN};
+    for (size_t c = 0; c < mChunks; ++c) {
+        mMin = {std::min(mMin.x, mChunkMin[c].x), std::min(mMin.y, mChunkMin[c].y), std::min(mMin.z, mChunkMin[c].z)};
+        mMax = {std::max(mMax.x, mChunkMax[c].x), std::max(mMax.y, mChunkMax[c].y), std::max(mMax.z, mChunkMax[c].z)};
+    }
+    uint32_t mOffset = 0;
+    for (uint32_t b = 0; b < mTableSize; ++b) {
+        mCellStart[b] = mOffset;
+        for (size_t c = 0; c < mChunks; ++c) {
+            const uint32_t mBucketCount = mCounts[c][b];
+            mCounts[c][b]               = mOffset;
+            mOffset += mBucketCount;
+        }
+    }
+    mCellStart[mTableSize] = mOffset;
+    if (mChunks > 1) {
+        pThreadPool->run(mSize, PARALLEL_GRAIN_SIZE, mScatter);
+    } else {
+        mScatter(0, mSize, 0);
+    }
+}
+
+size_t SpatialHashGrid::query(const PVector& pPosition, const float pRadius, std::vector<Particle*>& pResult) const {
+    const size_t mSize = pResult.size();
+    query(pPosition, pRadius, [&](Particle* p, float) {
+        pResult.push_back(p);
+    });
+    return pResult.size() - mSize;
+}
+
+Particle* SpatialHashGrid::nearest(const PVector& pPosition, const float pMaxRadius) const {
+    if (mParticles.empty()) {
+        return nullptr;
+    }
+    Particle*  mNearest                = nullptr;
+    float      mNearestDistanceSquared = pMaxRadius * pMaxRadius;
+    const auto mVisit                  = [&](const uint32_t pBucket) {
+        for (uint32_t i = mCellStart[pBucket]; i < mCellStart[pBucket + 1]; ++i) {
+            const float mDistanceSquared = distanceSquared(pPosition, mPositions[i]);
+            if (mDistanceSquared < mNearestDistanceSquared) {
+                mNearestDistanceSquared = mDistanceSquared;
+                mNearest                = mParticles[i];
+            }
+        }
+    };
+
+    /* visit rings of cells around the cell of `pPosition` until no closer particle can be found in outer rings */
+    const Cell    c     = cell(pPosition);
+    const int32_t mRing = std::max({c.x - mMin.x, mMax.x - c.x, c.y - mMin.y, mMax.y - c.y, c.z - mMin.z, mMax.z - c.z});
+    const int32_t mFirstRing = std::max({0, mMin.x - c.x, c.x - mMax.x, mMin.y - c.y, c.y - mMax.y, mMin.z - c.z, c.z - mMax.z});
+    for (int32_t k = mFirstRing; k <= mRing; ++k) {
+        /* particles in ring `k` are at least `k - 1` cells away */
+        const float mLowerBound = static_cast<float>(k - 1) * mCellSize;
+        if (k > 1 && (mLowerBound * mLowerBound >= mNearestDistanceSquared || mLowerBound >= pMaxRadius)) {
+            break;
+        }
+        const Cell mMinRing{std::max(c.x - k, mMin.x), std::max(c.y - k, mMin.y), std::max(c.z - k, mMin.z)};
+        const Cell mMaxRing{std::min(c.x + k, mMax.x), std::min(c.y + k, mMax.y), std::min(c.z + k, mMax.z)};
+        const uint64_t mCells = static_cast<uint64_t>(mMaxRing.x - mMinRing.x + 1) *
+                                static_cast<uint64_t>(mMaxRing.y - mMinRing.y + 1) *
+                                static_cast<uint64_t>(mMaxRing.z - mMinRing.z + 1);
+        if (mCells > mMask) {
+            /* rings cover more cells than there are buckets, test all remaining particles directly */
+            for (uint32_t b = 0; b <= mMask; ++b) {
+                mVisit(b);
+            }
+            break;
+        }
+        for (int32_t z = mMinRing.z; z <= mMaxRing.z; ++z) {
+            for (int32_t y = mMinRing.y; y <= mMaxRing.y; ++y) {
+                if (std::abs(z - c.z) == k || std::abs(y - c.y) == k) {
+                    for (int32_t x = mMinRing.x; x <= mMaxRing.x; ++x) {
+                        mVisit(bucket(x, y, z));
+                    }
+                } else {
+                    if (c.x - k >= mMinRing.x) {
+                        mVisit(bucket(c.x - k, y, z));
+                    }
+                    if (c.x + k <= mMaxRing.x) {
+                        mVisit(bucket(c.x + k, y, z));
+                    }
+                }
+            }
+        }
+    }
+    return mNearest;
+}
+
+void SpatialHashGrid::pairs(const float pRadius, std::vector<Pair>& pPairs, ThreadPool* pThreadPool) {
+    pPairs.clear();
+    const size_t mSize          = mPositions.size();
+    const size_t mChunks        = pThreadPool != nullptr ? pThreadPool->chunks(mSize, PARALLEL_GRAIN_SIZE) : 1;
+    const float  mRadiusSquared = pRadius * pRadius;
+    mChunkPairs.resize(mChunks);
+    const auto mCollect = [&](const size_t pBegin, const size_t pEnd, const size_t pChunk) {
+        std::vector<Pair>& mPairs = mChunkPairs[pChunk];
+        mPairs.clear();
+        for (uint32_t i = static_cast<uint32_t>(pBegin); i < pEnd; ++i) {
+            const PVector& mPosition = mPositions[i];
+            buckets(cell(mPosition, -pRadius), cell(mPosition, pRadius), [&](const uint32_t pBucket) {
+                for (uint32_t j = std::max(mCellStart[pBucket], i + 1); j < mCellStart[pBucket + 1]; ++j) {
+                    if (distanceSquared(mPosition, mPositions[j]) < mRadiusSquared) {
+                        mPairs.push_back({i, j});
+                    }
+                }
+            });
+        }
+    };
+    if (mChunks > 1) {
+        pThreadPool->run(mSize, PARALLEL_GRAIN_SIZE, mCollect);
+    } else {
+        mCollect(0, mSize, 0);
+    }
+    for (size_t c = 0; c < mChunks; ++c) {
+        pPairs.insert(pPairs.end(), mChunkPairs[c].begin(), mChunkPairs[c].end());
+    }
+}
@@ -40,35 +40,64 @@ Spring::Spring(Particle*   pA,
       mSpringDamping(pSpringDamping),
       mID(Physics::getUniqueID()) {}
 
-void Spring::apply(float pDeltaTime, Physics& pParticleSystem) {
-    if (!(mA->fixed() && mB->fixed())) {
-        PVector mAB = PVector::sub(mA->position(), mB->position());
-        float   mInvDistance;
-        float   mDistance;
+Spring::~Spring() {
+    if (mIndex != nullptr) {
+        mIndex->remove(this);
+    }
+}
+
+Particle* Spring::a(Particle* pA) {
+    mA = pA;
+    if (mIndex != nullptr) {
+        mIndex->update(this);
+    }
+    return mA;
+}
+
+Particle* Spring::b(Particle* pB) {
+    mB = pB;
+    if (mIndex != nullptr) {
+        mIndex->update(this);
+    }
+    return mB;
+}
+
+bool Spring::calculateForce(PVector& pForce) const {
+    if ((mA->fixed() || mA->sleeping()) && (mB->fixed() || mB->sleeping())) {
+        return false;
+    }
+    PVector mAB = PVector::sub(mA->position(), mB->position());
+    float   mInvDistance;
+    float   mDistance;
 #if USE_FAST_SQRT == 1
-        float mInvDistanceSquared = mAB.magSq();
-        if (mInvDistanceSquared == 0.0f) {
-            return;
-        }
-        mInvDistance = Util::fastInverseSqrt(mInvDistanceSquared);
-        mDistance    = 1.0f / mInvDistance;
+    float mInvDistanceSquared = mAB.magSq();
+    if (mInvDistanceSquared == 0.0f) {
+        return false;
+    }
+    mInvDistance = Util::fastInverseSqrt(mInvDistanceSquared);
+    mDistance    = 1.0f / mInvDistance;
 #else
-        mDistance = mAB.mag();
-        if (mDistance == 0.0f) {
-            return;
-        }
-        mInvDistance = 1.0f / mDistance;
+    mDistance = mAB.mag();
+    if (mDistance == 0.0f) {
+        return false;
+    }
+    mInvDistance = 1.0f / mDistance;
 #endif // USE_FAST_SQRT
-        const float mSpringForce = -mSpringConstant * (mDistance - mRestLength);
-        auto        mABV         = PVector::sub(mA->velocity(), mB->velocity());
-        auto        mForce       = PVector(-mSpringForce, -mSpringForce, -mSpringForce);
-        Util::scale(mABV, mAB);
-        mABV.mult(mInvDistance);
-        mABV.mult(mSpringDamping);
-        mForce.add(mABV);
-        mAB.mult(-mInvDistance);
-        Util::scale(mForce, mAB);
+    const float mSpringForce = -mSpringConstant * (mDistance - mRestLength);
+    auto        mABV         = PVector::sub(mA->velocity(), mB->velocity());
+    pForce.set(-mSpringForce, -mSpringForce, -mSpringForce);
+    Util::scale(mABV, mAB);
+    mABV.mult(mInvDistance);
+    mABV.mult(mSpringDamping);
+    pForce.add(mABV);
+    mAB.mult(-mInvDistance);
+    Util::scale(pForce, mAB);
+    return true;
+}
 
+void Spring::apply(float pDeltaTime, Physics& pParticleSystem) {
+    PVector mForce;
+    if (calculateForce(mForce)) {
         if (mOneWay) {
             if (!mB->fixed()) {
                 mForce.mult(-2);
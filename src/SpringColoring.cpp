@@ -0,0 +1,100 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include "SpringColoring.h"
+#include "Spring.h"
+
+void SpringColoring::add(Spring* pSpring) {
+    if (contains(pSpring)) {
+        return;
+    }
+    Particle*      mA     = pSpring->a();
+    Particle*      mB     = pSpring->b();
+    uint64_t&      mUsedA = mUsedColors[mA];
+    uint64_t&      mUsedB = mUsedColors[mB];
+    const uint64_t mFree  = ~(mUsedA | mUsedB);
+
+    uint32_t mColor = OVERFLOW;
+    if (mFree != 0) {
+        mColor = 0;
+        while (!(mFree & (uint64_t(1) << mColor))) {
+            ++mColor;
+        }
+        mUsedA |= uint64_t(1) << mColor;
+        mUsedB |= uint64_t(1) << mColor;
+        if (mColor >= mColors.size()) {
+            mColors.resize(mColor + 1);
+        }
+    }
+    std::vector<Entry>& mList = list(mColor);
+    mLocations[pSpring]       = {mColor, static_cast<uint32_t>(mList.size())};
+    mList.push_back({pSpring, mA, mB});
+}
+
+void SpringColoring::remove(const Spring* pSpring) {
+    const auto it = mLocations.find(pSpring);
+    if (it == mLocations.end()) {
+        return;
+    }
+    const Location      mLocation = it->second;
+    std::vector<Entry>& mList     = list(mLocation.color);
+    const Entry         mEntry    = mList[mLocation.slot];
+    mLocations.erase(it);
+
+    mList[mLocation.slot] = mList.back();
+    mList.pop_back();
+    if (mLocation.slot < mList.size()) {
+        mLocations[mList[mLocation.slot].spring].slot = mLocation.slot;
+    }
+
+    if (mLocation.color != OVERFLOW) {
+        release(mEntry.a, mLocation.color);
+        release(mEntry.b, mLocation.color);
+        while (!mColors.empty() && mColors.back().empty()) {
+            mColors.pop_back();
+        }
+    }
+}
+
+void SpringColoring::clear() {
+    mColors.clear();
+    mOverflow.clear();
+    mLocations.clear();
+    mUsedColors.clear();
+}
+
+std::vector<SpringColoring::Entry>& SpringColoring::list(const uint32_t pColor) {
+    return pColor == OVERFLOW ? mOverflow : mColors[pColor];
+}
+
+void SpringColoring::release(const Particle* pParticle, const uint32_t pColor) {
+    const auto it = mUsedColors.find(pParticle);
+    if (it == mUsedColors.end()) {
+        return;
+    }
+    it->second &= ~(uint64_t(1) << pColor);
+    if (it->second == 0) {
+        mUsedColors.erase(it);
+    }
+}
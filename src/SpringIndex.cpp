@@ -0,0 +1,89 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include "SpringIndex.h"
+#include "Spring.h"
+
+SpringIndex::~SpringIndex() {
+    clear();
+}
+
+void SpringIndex::add(Spring* pSpring) {
+    if (contains(pSpring)) {
+        return;
+    }
+    if (pSpring->mIndex != nullptr) {
+        pSpring->mIndex->remove(pSpring);
+    }
+    const Edge mEdge = edge(pSpring->a(), pSpring->b());
+    mSprings.emplace(mEdge, pSpring);
+    mEdges.emplace(pSpring, mEdge);
+    pSpring->mIndex = this;
+}
+
+void SpringIndex::remove(const Spring* pSpring) {
+    /* only indexed springs are accessed, a spring that is not indexed may already be destroyed */
+    const auto mEdge = mEdges.find(pSpring);
+    if (mEdge == mEdges.end()) {
+        return;
+    }
+    if (Spring* mSpring = unlink(mEdge->second, pSpring)) {
+        mSpring->mIndex = nullptr;
+    }
+    mEdges.erase(mEdge);
+}
+
+void SpringIndex::update(Spring* pSpring) {
+    const auto mEdge = mEdges.find(pSpring);
+    if (mEdge == mEdges.end()) {
+        return;
+    }
+    const Edge mCurrent = edge(pSpring->a(), pSpring->b());
+    if (mEdge->second == mCurrent) {
+        return;
+    }
+    unlink(mEdge->second, pSpring);
+    mEdge->second = mCurrent;
+    mSprings.emplace(mCurrent, pSpring);
+}
+
+Spring* SpringIndex::unlink(const Edge& pEdge, const Spring* pSpring) {
+    const auto mRange = mSprings.equal_range(pEdge);
+    for (auto it = mRange.first; it != mRange.second; ++it) {
+        if (it->second == pSpring) {
+            Spring* mSpring = it->second;
+            mSprings.erase(it);
+            return mSpring;
+        }
+    }
+    return nullptr;
+}
+
+void SpringIndex::clear() {
+    for (const auto& s: mSprings) {
+        s.second->mIndex = nullptr;
+    }
+    mSprings.clear();
+    mEdges.clear();
+}
@@ -0,0 +1,264 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <algorithm>
+
+#include "SpringIslands.h"
+#include "Spring.h"
+
+void SpringIslands::add(Spring* pSpring) {
+    if (contains(pSpring)) {
+        return;
+    }
+    Particle* mA     = pSpring->a();
+    Particle* mB     = pSpring->b();
+    Node&     mNodeA = node(mA);
+    Node&     mNodeB = node(mB);
+    if (mNodeA.island != mNodeB.island) {
+        const uint32_t mIslandA = mNodeA.island;
+        const uint32_t mIslandB = mNodeB.island;
+        if (mIslands[mIslandA].particles.size() < mIslands[mIslandB].particles.size()) {
+            merge(mIslandA, mIslandB);
+        } else {
+            merge(mIslandB, mIslandA);
+        }
+    }
+    Island& mIsland     = mIslands[mNodeA.island];
+    mIsland.sleeping    = false;
+    mLocations[pSpring] = {mNodeA.island, static_cast<uint32_t>(mIsland.springs.size())};
+    mIsland.springs.push_back({pSpring, mA, mB});
+    mNodeA.springs.push_back(pSpring);
+    if (&mNodeA != &mNodeB) {
+        mNodeB.springs.push_back(pSpring);
+    }
+}
+
+void SpringIslands::remove(const Spring* pSpring, std::vector<Particle*>* pDetached) {
+    const auto it = mLocations.find(pSpring);
+    if (it == mLocations.end()) {
+        return;
+    }
+    const Location mLocation = it->second;
+    mLocations.erase(it);
+
+    std::vector<Entry>& mSprings = mIslands[mLocation.island].springs;
+    const Entry         mEntry   = mSprings[mLocation.slot];
+    mSprings[mLocation.slot]     = mSprings.back();
+    mSprings.pop_back();
+    if (mLocation.slot < mSprings.size()) {
+        mLocations[mSprings[mLocation.slot].spring].slot = mLocation.slot;
+    }
+
+    for (Particle* mParticle: {mEntry.a, mEntry.b}) {
+        const auto mNode = mNodes.find(mParticle);
+        if (mNode == mNodes.end()) {
+            continue;
+        }
+        std::vector<Spring*>& mNodeSprings = mNode->second.springs;
+        const auto            mSpring      = std::find(mNodeSprings.begin(), mNodeSprings.end(), pSpring);
+        if (mSpring != mNodeSprings.end()) {
+            *mSpring = mNodeSprings.back();
+            mNodeSprings.pop_back();
+        }
+        if (mNodeSprings.empty()) {
+            erase(mParticle);
+            if (pDetached != nullptr) {
+                pDetached->push_back(mParticle);
+            }
+        }
+    }
+
+    Island& mIsland  = mIslands[mLocation.island];
+    mIsland.sleeping = false;
+    if (!mIsland.particles.empty() && !mIsland.split) {
+        mIsland.split = true;
+        mSplitIslands.push_back(mLocation.island);
+    }
+}
+
+void SpringIslands::clear() {
+    mNodes.clear();
+    mLocations.clear();
+    mIslands.clear();
+    mFreeIslands.clear();
+    mSplitIslands.clear();
+    mCount = 0;
+}
+
+void SpringIslands::update() {
+    for (const uint32_t mIsland: mSplitIslands) {
+        /* islands may have been merged or reused since they were marked */
+        if (mIslands[mIsland].split) {
+            split(mIsland);
+        }
+    }
+    mSplitIslands.clear();
+}
+
+SpringIslands::Statistics SpringIslands::statistics() const {
+    Statistics mStatistics;
+    for (const auto& mIsland: mIslands) {
+        const size_t mSize = mIsland.particles.size();
+        if (mSize == 0) {
+            continue;
+        }
+        mStatistics.smallest = mStatistics.islands == 0 ? mSize : std::min(mStatistics.smallest, mSize);
+        mStatistics.largest  = std::max(mStatistics.largest, mSize);
+        mStatistics.islands++;
+        mStatistics.particles += mSize;
+        mStatistics.springs += mIsland.springs.size();
+        size_t mBucket = 0;
+        while (mSize >> (mBucket + 1)) {
+            ++mBucket;
+        }
+        if (mStatistics.histogram.size() <= mBucket) {
+            mStatistics.histogram.resize(mBucket + 1, 0);
+        }
+        mStatistics.histogram[mBucket]++;
+    }
+    return mStatistics;
+}
+
+uint32_t SpringIslands::makeIsland() {
+    ++mCount;
+    if (!mFreeIslands.empty()) {
+        const uint32_t mIsland = mFreeIslands.back();
+        mFreeIslands.pop_back();
+        return mIsland;
+    }
+    mIslands.emplace_back();
+    return static_cast<uint32_t>(mIslands.size() - 1);
+}
+
+void SpringIslands::freeIsland(const uint32_t pIsland) {
+    Island& mIsland = mIslands[pIsland];
+    mIsland.particles.clear();
+    mIsland.springs.clear();
+    mIsland.split    = false;
+    mIsland.sleeping = false;
+    mFreeIslands.push_back(pIsland);
+    --mCount;
+}
+
+SpringIslands::Node& SpringIslands::node(Particle* pParticle) {
+    const auto it = mNodes.find(pParticle);
+    if (it != mNodes.end()) {
+        return it->second;
+    }
+    const uint32_t mIsland = makeIsland();
+    Node&          mNode   = mNodes[pParticle];
+    insert(mIsland, pParticle, mNode);
+    return mNode;
+}
+
+void SpringIslands::insert(const uint32_t pIsland, Particle* pParticle, Node& pNode) {
+    std::vector<Particle*>& mParticles = mIslands[pIsland].particles;
+    pNode.island                       = pIsland;
+    pNode.slot                         = static_cast<uint32_t>(mParticles.size());
+    mParticles.push_back(pParticle);
+}
+
+void SpringIslands::erase(const Particle* pParticle) {
+    const auto it = mNodes.find(pParticle);
+    if (it == mNodes.end()) {
+        return;
+    }
+    const uint32_t          mIsland    = it->second.island;
+    const uint32_t          mSlot      = it->second.slot;
+    std::vector<Particle*>& mParticles = mIslands[mIsland].particles;
+    mNodes.erase(it);
+    mParticles[mSlot] = mParticles.back();
+    mParticles.pop_back();
+    if (mSlot < mParticles.size()) {
+        mNodes[mParticles[mSlot]].slot = mSlot;
+    }
+    if (mParticles.empty()) {
+        freeIsland(mIsland);
+    }
+}
+
+void SpringIslands::merge(const uint32_t pFrom, const uint32_t pTo) {
+    Island& mFrom = mIslands[pFrom];
+    Island& mTo   = mIslands[pTo];
+    for (const auto& p: mFrom.particles) {
+        insert(pTo, p, mNodes[p]);
+    }
+    for (const auto& e: mFrom.springs) {
+        Location& mLocation = mLocations[e.spring];
+        mLocation.island    = pTo;
+        mLocation.slot      = static_cast<uint32_t>(mTo.springs.size());
+        mTo.springs.push_back(e);
+    }
+    if (mFrom.split && !mTo.split) {
+        mTo.split = true;
+        mSplitIslands.push_back(pTo);
+    }
+    freeIsland(pFrom);
+}
+
+void SpringIslands::split(const uint32_t pIsland) {
+    std::vector<Particle*> mParticles;
+    std::vector<Entry>     mSprings;
+    mParticles.swap(mIslands[pIsland].particles);
+    mSprings.swap(mIslands[pIsland].springs);
+    mIslands[pIsland].split    = false;
+    mIslands[pIsland].sleeping = false;
+    for (const auto& p: mParticles) {
+        mNodes[p].island = INVALID_ISLAND;
+    }
+
+    /* the first component keeps the index of the island, every other component becomes a new island */
+    std::vector<Particle*> mQueue;
+    bool                   mFirst = true;
+    for (const auto& p: mParticles) {
+        Node& mNode = mNodes[p];
+        if (mNode.island != INVALID_ISLAND) {
+            continue;
+        }
+        const uint32_t mIsland = mFirst ? pIsland : makeIsland();
+        mFirst                 = false;
+        insert(mIsland, p, mNode);
+        mQueue.push_back(p);
+        while (!mQueue.empty()) {
+            const Particle* mParticle = mQueue.back();
+            mQueue.pop_back();
+            for (const auto& s: mNodes[mParticle].springs) {
+                const Location& mLocation  = mLocations[s];
+                const Entry&    mEntry     = mSprings[mLocation.slot];
+                Particle*       mOther     = mEntry.a == mParticle ? mEntry.b : mEntry.a;
+                Node&           mOtherNode = mNodes[mOther];
+                if (mOtherNode.island == INVALID_ISLAND) {
+                    insert(mIsland, mOther, mOtherNode);
+                    mQueue.push_back(mOther);
+                }
+            }
+        }
+    }
+    for (const auto& e: mSprings) {
+        const uint32_t mIsland   = mNodes[e.a].island;
+        Location&      mLocation = mLocations[e.spring];
+        mLocation.island         = mIsland;
+        mLocation.slot           = static_cast<uint32_t>(mIslands[mIsland].springs.size());
+        mIslands[mIsland].springs.push_back(e);
+    }
+}
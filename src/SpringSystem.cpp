@@ -0,0 +1,383 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include <cmath>
+
+#include "SpringSystem.h"
+#include "ParticleHandle.h"
+#include "ParticleStore.h"
+#include "Physics.h"
+#include "Spring.h"
+#include "Util.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+SpringSystem::SpringSystem()
+    : mStore(nullptr),
+      mStoreRevision(0),
+      mIndicesValid(false),
+      mActive(true),
+      mDead(false),
+      mID(Physics::getUniqueID()) {}
+
+uint32_t SpringSystem::make(Particle* pA, Particle* pB) {
+    return make(pA, pB, DEFAULT_SPRING_CONSTANT, DEFAULT_SPRING_DAMPING, PVector::dist(pA->position(), pB->position()));
+}
+
+uint32_t SpringSystem::make(Particle* pA, Particle* pB, const float pRestLength) {
+    return make(pA, pB, DEFAULT_SPRING_CONSTANT, DEFAULT_SPRING_DAMPING, pRestLength);
+}
+
+uint32_t SpringSystem::make(Particle* pA, Particle* pB, const float pSpringConstant, const float pSpringDamping) {
+    return make(pA, pB, pSpringConstant, pSpringDamping, PVector::dist(pA->position(), pB->position()));
+}
+
+uint32_t SpringSystem::make(Particle*   pA,
+                            Particle*   pB,
+                            const float pSpringConstant,
+                            const float pSpringDamping,
+                            const float pRestLength) {
+    const auto mIndex = static_cast<uint32_t>(size());
+    mParticlesA.push_back(pA);
+    mParticlesB.push_back(pB);
+    mRestLengths.push_back(pRestLength);
+    mSpringConstants.push_back(pSpringConstant);
+    mSpringDampings.push_back(pSpringDamping);
+    mOneWay.push_back(0);
+
+    /* keep the index arrays in sync as long as they are valid, otherwise they are rebuilt on the next `apply` */
+    const auto mHandleA = dynamic_cast<ParticleHandle*>(pA);
+    const auto mHandleB = dynamic_cast<ParticleHandle*>(pB);
+    if (mIndicesValid &&
+        mHandleA != nullptr && mHandleA->store() == mStore && mHandleA->attached() &&
+        mHandleB != nullptr && mHandleB->store() == mStore && mHandleB->attached() &&
+        mStore->revision() == mStoreRevision) {
+        mA.push_back(mHandleA->index());
+        mB.push_back(mHandleB->index());
+    } else {
+        mStore = nullptr;
+    }
+    return mIndex;
+}
+
+void SpringSystem::remove(const uint32_t pIndex) {
+    if (pIndex >= size()) {
+        return;
+    }
+    mParticlesA.erase(mParticlesA.begin() + pIndex);
+    mParticlesB.erase(mParticlesB.begin() + pIndex);
+    mRestLengths.erase(mRestLengths.begin() + pIndex);
+    mSpringConstants.erase(mSpringConstants.begin() + pIndex);
+    mSpringDampings.erase(mSpringDampings.begin() + pIndex);
+    mOneWay.erase(mOneWay.begin() + pIndex);
+    if (pIndex < mA.size()) {
+        mA.erase(mA.begin() + pIndex);
+        mB.erase(mB.begin() + pIndex);
+    }
+}
+
+template<typename P>
+size_t SpringSystem::removeIf(P pRemoved) {
+    size_t mWrite = 0;
+    for (size_t i = 0; i < size(); ++i) {
+        if (pRemoved(mParticlesA[i]) || pRemoved(mParticlesB[i])) {
+            continue;
+        }
+        if (mWrite != i) {
+            mParticlesA[mWrite]      = mParticlesA[i];
+            mParticlesB[mWrite]      = mParticlesB[i];
+            mRestLengths[mWrite]     = mRestLengths[i];
+            mSpringConstants[mWrite] = mSpringConstants[i];
+            mSpringDampings[mWrite]  = mSpringDampings[i];
+            mOneWay[mWrite]          = mOneWay[i];
+            if (i < mA.size()) {
+                mA[mWrite] = mA[i];
+                mB[mWrite] = mB[i];
+            }
+        }
+        ++mWrite;
+    }
+    const size_t mRemoved = size() - mWrite;
+    if (mRemoved > 0) {
+        mParticlesA.resize(mWrite);
+        mParticlesB.resize(mWrite);
+        mRestLengths.resize(mWrite);
+        mSpringConstants.resize(mWrite);
+        mSpringDampings.resize(mWrite);
+        mOneWay.resize(mWrite);
+        mA.resize(std::min(mA.size(), mWrite));
+        mB.resize(std::min(mB.size(), mWrite));
+    }
+    return mRemoved;
+}
+
+size_t SpringSystem::removeDead() {
+    return removeIf([](const Particle* p) { return p->dead(); });
+}
+
+size_t SpringSystem::removeConnected(const std::unordered_set<const Particle*>& pParticles) {
+    return removeIf([&](const Particle* p) { return pParticles.count(p) > 0; });
+}
+
+void SpringSystem::reserve(const size_t pCapacity) {
+    mParticlesA.reserve(pCapacity);
+    mParticlesB.reserve(pCapacity);
+    mA.reserve(pCapacity);
+    mB.reserve(pCapacity);
+    mRestLengths.reserve(pCapacity);
+    mSpringConstants.reserve(pCapacity);
+    mSpringDampings.reserve(pCapacity);
+    mOneWay.reserve(pCapacity);
+}
+
+void SpringSystem::apply(float /* pDeltaTime */, Physics& pParticleSystem) {
+    if (size() == 0) {
+        return;
+    }
+    resizeScratch();
+    ParticleStore* mPacked = pParticleSystem.packed();
+    if (mPacked != nullptr && updateIndices(*mPacked)) {
+        applyPacked(*mPacked);
+    } else {
+        applyIndirect();
+    }
+}
+
+bool SpringSystem::updateIndices(const ParticleStore& pStore) {
+    if (mStore == &pStore && mStoreRevision == pStore.revision()) {
+        return mIndicesValid;
+    }
+    mStore         = &pStore;
+    mStoreRevision = pStore.revision();
+    mIndicesValid  = true;
+    mA.resize(size());
+    mB.resize(size());
+    for (size_t i = 0; i < size(); ++i) {
+        const auto mHandleA = dynamic_cast<ParticleHandle*>(mParticlesA[i]);
+        const auto mHandleB = dynamic_cast<ParticleHandle*>(mParticlesB[i]);
+        if (mHandleA == nullptr || mHandleA->store() != &pStore || !mHandleA->attached() ||
+            mHandleB == nullptr || mHandleB->store() != &pStore || !mHandleB->attached()) {
+            mIndicesValid = false;
+            break;
+        }
+        mA[i] = mHandleA->index();
+        mB[i] = mHandleB->index();
+    }
+    return mIndicesValid;
+}
+
+void SpringSystem::applyPacked(ParticleStore& pStore) {
+    const size_t   mCount      = size();
+    const PVector* mPositions  = pStore.positions();
+    const PVector* mVelocities = pStore.velocities();
+    for (size_t i = 0; i < mCount; ++i) {
+        const PVector& mPositionA = mPositions[mA[i]];
+        const PVector& mPositionB = mPositions[mB[i]];
+        const PVector& mVelocityA = mVelocities[mA[i]];
+        const PVector& mVelocityB = mVelocities[mB[i]];
+        mDX[i]                    = mPositionA.x - mPositionB.x;
+        mDY[i]                    = mPositionA.y - mPositionB.y;
+        mDZ[i]                    = mPositionA.z - mPositionB.z;
+        mDVX[i]                   = mVelocityA.x - mVelocityB.x;
+        mDVY[i]                   = mVelocityA.y - mVelocityB.y;
+        mDVZ[i]                   = mVelocityA.z - mVelocityB.z;
+    }
+
+    computeForces(mCount, mDX.data(), mDY.data(), mDZ.data(), mDVX.data(), mDVY.data(), mDVZ.data(),
+                  mRestLengths.data(), mSpringConstants.data(), mSpringDampings.data(),
+                  mFX.data(), mFY.data(), mFZ.data());
+
+    PVector* mForces = pStore.forces();
+    for (size_t i = 0; i < mCount; ++i) {
+        /* springs between sleeping particles are skipped, a sleeping endpoint still collects the force that may wake it */
+        if (pStore.immovable(mA[i]) && pStore.immovable(mB[i])) {
+            continue;
+        }
+        const bool mFixedA = pStore.fixed(mA[i]);
+        const bool mFixedB = pStore.fixed(mB[i]);
+        PVector mForce(mFX[i], mFY[i], mFZ[i]);
+        if (mOneWay[i]) {
+            if (!mFixedB) {
+                mForce.mult(-2);
+                mForces[mB[i]].add(mForce);
+            }
+        } else {
+            if (!mFixedA) {
+                mForces[mA[i]].add(mForce);
+            }
+            if (!mFixedB) {
+                mForces[mB[i]].sub(mForce);
+            }
+        }
+    }
+}
+
+void SpringSystem::applyIndirect() {
+    const size_t mCount = size();
+    for (size_t i = 0; i < mCount; ++i) {
+        Particle* mParticleA = mParticlesA[i];
+        Particle* mParticleB = mParticlesB[i];
+        mDX[i]               = mParticleA->position().x - mParticleB->position().x;
+        mDY[i]               = mParticleA->position().y - mParticleB->position().y;
+        mDZ[i]               = mParticleA->position().z - mParticleB->position().z;
+        mDVX[i]              = mParticleA->velocity().x - mParticleB->velocity().x;
+        mDVY[i]              = mParticleA->velocity().y - mParticleB->velocity().y;
+        mDVZ[i]              = mParticleA->velocity().z - mParticleB->velocity().z;
+    }
+
+    computeForces(mCount, mDX.data(), mDY.data(), mDZ.data(), mDVX.data(), mDVY.data(), mDVZ.data(),
+                  mRestLengths.data(), mSpringConstants.data(), mSpringDampings.data(),
+                  mFX.data(), mFY.data(), mFZ.data());
+
+    for (size_t i = 0; i < mCount; ++i) {
+        Particle*  mParticleA = mParticlesA[i];
+        Particle*  mParticleB = mParticlesB[i];
+        const bool mFixedA    = mParticleA->fixed();
+        const bool mFixedB    = mParticleB->fixed();
+        if (mFixedA && mFixedB) {
+            continue;
+        }
+        PVector mForce(mFX[i], mFY[i], mFZ[i]);
+        if (mOneWay[i]) {
+            if (!mFixedB) {
+                mForce.mult(-2);
+                mParticleB->force().add(mForce);
+            }
+        } else {
+            if (!mFixedA) {
+                mParticleA->force().add(mForce);
+            }
+            if (!mFixedB) {
+                mParticleB->force().sub(mForce);
+            }
+        }
+    }
+}
+
+void SpringSystem::resizeScratch() {
+    const size_t mCount = size();
+    if (mFX.size() == mCount) {
+        return;
+    }
+    mDX.resize(mCount);
+    mDY.resize(mCount);
+    mDZ.resize(mCount);
+    mDVX.resize(mCount);
+    mDVY.resize(mCount);
+    mDVZ.resize(mCount);
+    mFX.resize(mCount);
+    mFY.resize(mCount);
+    mFZ.resize(mCount);
+}
+
+/*
+ * mirrors the arithmetic of `Spring::apply` operation by operation. springs with coincident endpoints produce no
+ * force. the AVX2 path processes 8 springs per iteration, the scalar loop handles the remainder and all other
+ * targets.
+ */
+void SpringSystem::computeForces(const size_t pCount,
+                                 const float* pDX,
+                                 const float* pDY,
+                                 const float* pDZ,
+                                 const float* pDVX,
+                                 const float* pDVY,
+                                 const float* pDVZ,
+                                 const float* pRestLengths,
+                                 const float* pSpringConstants,
+                                 const float* pSpringDampings,
+                                 float*       pFX,
+                                 float*       pFY,
+                                 float*       pFZ) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 mOne  = _mm256_set1_ps(1.0f);
+    const __m256 mZero = _mm256_setzero_ps();
+    const __m256 mSign = _mm256_set1_ps(-0.0f);
+#if USE_FAST_SQRT == 1
+    const __m256  mHalf      = _mm256_set1_ps(0.5f);
+    const __m256  mThreeHalf = _mm256_set1_ps(1.5f);
+    const __m256i mMagic     = _mm256_set1_epi32(0x5f375a86);
+#endif
+    for (; i + 8 <= pCount; i += 8) {
+        const __m256 mDX = _mm256_loadu_ps(pDX + i);
+        const __m256 mDY = _mm256_loadu_ps(pDY + i);
+        const __m256 mDZ = _mm256_loadu_ps(pDZ + i);
+        const __m256 mDistanceSquared =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mDX, mDX), _mm256_mul_ps(mDY, mDY)), _mm256_mul_ps(mDZ, mDZ));
+#if USE_FAST_SQRT == 1
+        const __m256 mHalfDistanceSquared = _mm256_mul_ps(mHalf, mDistanceSquared);
+        const __m256i mBits = _mm256_sub_epi32(mMagic, _mm256_srai_epi32(_mm256_castps_si256(mDistanceSquared), 1));
+        __m256        mInvDistance = _mm256_castsi256_ps(mBits);
+        mInvDistance = _mm256_mul_ps(mInvDistance,
+                                     _mm256_sub_ps(mThreeHalf, _mm256_mul_ps(_mm256_mul_ps(mHalfDistanceSquared, mInvDistance), mInvDistance)));
+        const __m256 mDistance = _mm256_div_ps(mOne, mInvDistance);
+        const __m256 mValid    = _mm256_cmp_ps(mDistanceSquared, mZero, _CMP_NEQ_OQ);
+#else
+        const __m256 mDistance    = _mm256_sqrt_ps(mDistanceSquared);
+        const __m256 mInvDistance = _mm256_div_ps(mOne, mDistance);
+        const __m256 mValid       = _mm256_cmp_ps(mDistance, mZero, _CMP_NEQ_OQ);
+#endif
+        const __m256 mSpringConstant = _mm256_loadu_ps(pSpringConstants + i);
+        const __m256 mSpringDamping  = _mm256_loadu_ps(pSpringDampings + i);
+        const __m256 mRestLength     = _mm256_loadu_ps(pRestLengths + i);
+        const __m256 mSpringForce    = _mm256_mul_ps(_mm256_xor_ps(mSpringConstant, mSign), _mm256_sub_ps(mDistance, mRestLength));
+        const __m256 mForce          = _mm256_xor_ps(mSpringForce, mSign);
+        const __m256 mScale          = _mm256_xor_ps(mInvDistance, mSign);
+
+        const __m256 mDampingX = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(pDVX + i), mDX), mInvDistance), mSpringDamping);
+        const __m256 mDampingY = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(pDVY + i), mDY), mInvDistance), mSpringDamping);
+        const __m256 mDampingZ = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(pDVZ + i), mDZ), mInvDistance), mSpringDamping);
+        _mm256_storeu_ps(pFX + i, _mm256_and_ps(mValid, _mm256_mul_ps(_mm256_add_ps(mForce, mDampingX), _mm256_mul_ps(mDX, mScale))));
+        _mm256_storeu_ps(pFY + i, _mm256_and_ps(mValid, _mm256_mul_ps(_mm256_add_ps(mForce, mDampingY), _mm256_mul_ps(mDY, mScale))));
+        _mm256_storeu_ps(pFZ + i, _mm256_and_ps(mValid, _mm256_mul_ps(_mm256_add_ps(mForce, mDampingZ), _mm256_mul_ps(mDZ, mScale))));
+    }
+#endif
+    for (; i < pCount; ++i) {
+        const float mDistanceSquared = pDX[i] * pDX[i] + pDY[i] * pDY[i] + pDZ[i] * pDZ[i];
+        float       mInvDistance;
+        float       mDistance;
+#if USE_FAST_SQRT == 1
+        if (mDistanceSquared == 0.0f) {
+            pFX[i] = pFY[i] = pFZ[i] = 0.0f;
+            continue;
+        }
+        mInvDistance = Util::fastInverseSqrt(mDistanceSquared);
+        mDistance    = 1.0f / mInvDistance;
+#else
+        mDistance = std::sqrt(mDistanceSquared);
+        if (mDistance == 0.0f) {
+            pFX[i] = pFY[i] = pFZ[i] = 0.0f;
+            continue;
+        }
+        mInvDistance = 1.0f / mDistance;
+#endif
+        const float mSpringForce = -pSpringConstants[i] * (mDistance - pRestLengths[i]);
+        const float mForce       = -mSpringForce;
+        pFX[i]                   = (mForce + pDVX[i] * pDX[i] * mInvDistance * pSpringDampings[i]) * (pDX[i] * -mInvDistance);
+        pFY[i]                   = (mForce + pDVY[i] * pDY[i] * mInvDistance * pSpringDampings[i]) * (pDY[i] * -mInvDistance);
+        pFZ[i]                   = (mForce + pDVZ[i] * pDZ[i] * mInvDistance * pSpringDampings[i]) * (pDZ[i] * -mInvDistance);
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(const size_t pThreads) {
+    for (size_t i = 1; i < std::max<size_t>(pThreads, 1); ++i) {
+        mWorkers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> mLock(mMutex);
+        mStop = true;
+    }
+    mStart.notify_all();
+    for (auto& t: mWorkers) {
+        t.join();
+    }
+}
+
+size_t ThreadPool::chunks(const size_t pCount, const size_t pGrainSize) const {
+    const size_t mMaxChunks = pGrainSize > 0 ? pCount / pGrainSize : pCount;
+    return std::max<size_t>(1, std::min(threads(), mMaxChunks));
+}
+
+void ThreadPool::run(const size_t pCount, const size_t pGrainSize, const Task& pTask) {
+    if (pCount == 0) {
+        return;
+    }
+    const size_t mChunkCount = chunks(pCount, pGrainSize);
+    if (mChunkCount == 1) {
+        pTask(0, pCount, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> mLock(mMutex);
+        mTask    = &pTask;
+        mCount   = pCount;
+        mChunks  = mChunkCount;
+        mPending = mWorkers.size();
+        ++mGeneration;
+    }
+    mStart.notify_all();
+
+    size_t mBegin, mEnd;
+    chunk(pCount, mChunkCount, 0, mBegin, mEnd);
+    pTask(mBegin, mEnd, 0);
+
+    std::unique_lock<std::mutex> mLock(mMutex);
+    mDone.wait(mLock, [this] { return mPending == 0; });
+    mTask = nullptr;
+}
+
+void ThreadPool::work(const size_t pThread) {
+    size_t mGenerationSeen = 0;
+    while (true) {
+        const Task* mCurrentTask;
+        size_t      mCurrentCount;
+        size_t      mCurrentChunks;
+        {
+            std::unique_lock<std::mutex> mLock(mMutex);
+            mStart.wait(mLock, [&] { return mStop || mGeneration != mGenerationSeen; });
+            if (mStop) {
+                return;
+            }
+            mGenerationSeen = mGeneration;
+            mCurrentTask    = mTask;
+            mCurrentCount   = mCount;
+            mCurrentChunks  = mChunks;
+        }
+        if (pThread < mCurrentChunks) {
+            size_t mBegin, mEnd;
+            chunk(mCurrentCount, mCurrentChunks, pThread, mBegin, mEnd);
+            (*mCurrentTask)(mBegin, mEnd, pThread);
+        }
+        {
+            std::lock_guard<std::mutex> mLock(mMutex);
+            --mPending;
+        }
+        mDone.notify_one();
+    }
+}
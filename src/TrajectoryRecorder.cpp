@@ -0,0 +1,425 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "TrajectoryRecorder.h"
+#include "Physics.h"
+
+namespace {
+    constexpr char     MAGIC[8]        = {'T', 'E', 'I', 'L', 'T', 'R', 'A', 'J'};
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr uint32_t FLAG_VELOCITIES = 1 << 0;
+    constexpr uint32_t FRAME_KEY       = 1;
+    constexpr uint32_t FRAME_DELTA     = 2;
+    /* quantized components are limited to 31 bits so differences never overflow */
+    constexpr float QUANTIZATION_LIMIT = 1073741824.0f;
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t flags;
+        float    precision;
+        uint32_t keyframe_interval;
+        uint32_t reserved;
+    };
+
+    struct FrameHeader {
+        uint32_t type;
+        uint32_t count;
+        uint64_t step;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(Header) == 32, "unexpected trajectory header size");
+    static_assert(sizeof(FrameHeader) == 24, "unexpected trajectory frame size");
+
+    int32_t quantize(const float pValue, const float pInversePrecision) {
+        const float mValue = pValue * pInversePrecision;
+        if (std::isnan(mValue)) {
+            return 0;
+        }
+        return static_cast<int32_t>(std::lrint(std::clamp(mValue, -QUANTIZATION_LIMIT, QUANTIZATION_LIMIT)));
+    }
+
+    void put(std::vector<uint8_t>& pBytes, uint64_t pValue) {
+        while (pValue >= 0x80) {
+            pBytes.push_back(static_cast<uint8_t>(pValue | 0x80));
+            pValue >>= 7;
+        }
+        pBytes.push_back(static_cast<uint8_t>(pValue));
+    }
+
+    bool get(const uint8_t*& pBytes, const uint8_t* pEnd, uint64_t& pValue) {
+        pValue = 0;
+        for (int mShift = 0; pBytes < pEnd && mShift < 64; mShift += 7) {
+            const uint8_t mByte = *pBytes++;
+            pValue |= static_cast<uint64_t>(mByte & 0x7F) << mShift;
+            if (!(mByte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * predicts the values of the next frame from the last two frames `pLast` and `pBeforeLast`, `pDepth` is the
+     * number of frames since the last keyframe. keyframes are predicted as zero, the frame after a keyframe as the
+     * keyframe, all others by extrapolating the motion between the last two frames.
+     */
+    void predict(const std::vector<int32_t>& pLast,
+                 const std::vector<int32_t>& pBeforeLast,
+                 const uint64_t              pDepth,
+                 const size_t                pCount,
+                 std::vector<int32_t>&       pPrediction) {
+        pPrediction.resize(pCount);
+        if (pDepth == 0) {
+            std::fill(pPrediction.begin(), pPrediction.end(), 0);
+        } else if (pDepth == 1) {
+            std::copy(pLast.begin(), pLast.end(), pPrediction.begin());
+        } else {
+            constexpr auto LIMIT = static_cast<int64_t>(QUANTIZATION_LIMIT);
+            for (size_t i = 0; i < pCount; ++i) {
+                const int64_t mExtrapolated = 2 * static_cast<int64_t>(pLast[i]) - pBeforeLast[i];
+                pPrediction[i]              = static_cast<int32_t>(std::clamp(mExtrapolated, -LIMIT, LIMIT));
+            }
+        }
+    }
+
+    /*
+     * codes the differences of `pValues` to `pPrediction`. runs of correctly predicted values are stored as their
+     * length with the lowest bit set, other differences zigzag coded with the lowest bit cleared.
+     */
+    void encode(const std::vector<int32_t>& pValues, const std::vector<int32_t>& pPrediction, std::vector<uint8_t>& pBytes) {
+        const size_t mCount = pValues.size();
+        for (size_t i = 0; i < mCount;) {
+            const int64_t mDifference = static_cast<int64_t>(pValues[i]) - pPrediction[i];
+            if (mDifference == 0) {
+                size_t mRun = 1;
+                while (i + mRun < mCount && pValues[i + mRun] == pPrediction[i + mRun]) {
+                    ++mRun;
+                }
+                put(pBytes, static_cast<uint64_t>(mRun) << 1 | 1);
+                i += mRun;
+            } else {
+                const uint64_t mZigZag = static_cast<uint64_t>(mDifference) << 1 ^ static_cast<uint64_t>(mDifference >> 63);
+                put(pBytes, mZigZag << 1);
+                ++i;
+            }
+        }
+    }
+
+    /* inverse of `encode`, reconstructs `pValues` from `pPrediction` */
+    bool decode(const uint8_t* pBytes, const uint8_t* pEnd, const std::vector<int32_t>& pPrediction, std::vector<int32_t>& pValues) {
+        const size_t mCount = pValues.size();
+        for (size_t i = 0; i < mCount;) {
+            uint64_t mToken;
+            if (!get(pBytes, pEnd, mToken)) {
+                return false;
+            }
+            if (mToken & 1) {
+                const uint64_t mRun = mToken >> 1;
+                if (mRun == 0 || mRun > mCount - i) {
+                    return false;
+                }
+                std::copy(pPrediction.begin() + i, pPrediction.begin() + i + mRun, pValues.begin() + i);
+                i += mRun;
+            } else {
+                const uint64_t mZigZag     = mToken >> 1;
+                const int64_t  mDifference = static_cast<int64_t>(mZigZag >> 1) ^ -static_cast<int64_t>(mZigZag & 1);
+                pValues[i]                 = static_cast<int32_t>(pPrediction[i] + mDifference);
+                ++i;
+            }
+        }
+        return pBytes == pEnd;
+    }
+} // namespace
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string& pFilePath,
+                                       const bool         pVelocities,
+                                       const float        pPrecision,
+                                       const uint32_t     pKeyframeInterval,
+                                       const size_t       pCapacity)
+    : mFile(std::fopen(pFilePath.c_str(), "wb")),
+      mVelocities(pVelocities),
+      mPrecision(pPrecision),
+      mKeyframeInterval(std::max<uint32_t>(pKeyframeInterval, 1)),
+      mFrames(std::max<size_t>(pCapacity, 1)) {
+    if (mFile == nullptr) {
+        return;
+    }
+    Header mHeader{};
+    std::memcpy(mHeader.magic, MAGIC, sizeof(MAGIC));
+    mHeader.version           = VERSION;
+    mHeader.byte_order        = BYTE_ORDER_MARK;
+    mHeader.flags             = mVelocities ? FLAG_VELOCITIES : 0;
+    mHeader.precision         = mPrecision;
+    mHeader.keyframe_interval = mKeyframeInterval;
+    mGood                     = std::fwrite(&mHeader, sizeof(Header), 1, mFile) == 1;
+    mBytes                    = sizeof(Header);
+    for (size_t i = mFrames.size(); i > 0; --i) {
+        mFree.push_back(i - 1);
+    }
+    mWriter = std::thread(&TrajectoryRecorder::write, this);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+    close();
+}
+
+bool TrajectoryRecorder::record(Physics& pPhysics) {
+    const uint64_t mStep = mSteps++;
+    size_t         mSlot;
+    {
+        std::lock_guard<std::mutex> mLock(mMutex);
+        if (mFile == nullptr || mStop || mFree.empty()) {
+            ++mDropped;
+            return false;
+        }
+        mSlot = mFree.back();
+        mFree.pop_back();
+    }
+
+    /* the slot is owned by this thread until it is queued */
+    Frame& mFrame = mFrames[mSlot];
+    mFrame.step   = mStep;
+    if (ParticleStore* mStore = pPhysics.packed()) {
+        mFrame.positions.assign(mStore->positions(), mStore->positions() + mStore->size());
+        if (mVelocities) {
+            mFrame.velocities.assign(mStore->velocities(), mStore->velocities() + mStore->size());
+        }
+    } else {
+        const auto& mParticles = pPhysics.particles();
+        mFrame.positions.resize(mParticles.size());
+        mFrame.velocities.resize(mVelocities ? mParticles.size() : 0);
+        for (size_t i = 0; i < mParticles.size(); ++i) {
+            mFrame.positions[i] = mParticles[i]->position();
+            if (mVelocities) {
+                mFrame.velocities[i] = mParticles[i]->velocity();
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> mLock(mMutex);
+        mQueue.push_back(mSlot);
+    }
+    mQueued.notify_one();
+    return true;
+}
+
+void TrajectoryRecorder::flush() {
+    std::unique_lock<std::mutex> mLock(mMutex);
+    mWritten.wait(mLock, [this] { return mQueue.empty() && !mWriting; });
+    if (mFile != nullptr) {
+        std::fflush(mFile);
+    }
+}
+
+void TrajectoryRecorder::close() {
+    {
+        std::lock_guard<std::mutex> mLock(mMutex);
+        mStop = true;
+    }
+    mQueued.notify_all();
+    if (mWriter.joinable()) {
+        mWriter.join();
+    }
+    if (mFile != nullptr) {
+        if (std::fclose(mFile) != 0) {
+            mGood = false;
+        }
+        mFile = nullptr;
+    }
+}
+
+void TrajectoryRecorder::write() {
+    std::unique_lock<std::mutex> mLock(mMutex);
+    while (true) {
+        mQueued.wait(mLock, [this] { return mStop || !mQueue.empty(); });
+        if (mQueue.empty()) {
+            return;
+        }
+        const size_t mSlot = mQueue.front();
+        mQueue.pop_front();
+        mWriting = true;
+        mLock.unlock();
+        encode(mFrames[mSlot]);
+        mLock.lock();
+        mWriting = false;
+        mFree.push_back(mSlot);
+        mWritten.notify_all();
+    }
+}
+
+void TrajectoryRecorder::encode(const Frame& pFrame) {
+    const float  mInversePrecision = 1.0f / mPrecision;
+    const size_t mCount            = pFrame.positions.size();
+    /* components are stored in planes ( all x, all y, ... ) so that resting axes form long runs */
+    mQuantized.resize(mCount * 3 + pFrame.velocities.size() * 3);
+    for (size_t i = 0; i < mCount; ++i) {
+        mQuantized[i]              = quantize(pFrame.positions[i].x, mInversePrecision);
+        mQuantized[mCount + i]     = quantize(pFrame.positions[i].y, mInversePrecision);
+        mQuantized[mCount * 2 + i] = quantize(pFrame.positions[i].z, mInversePrecision);
+    }
+    for (size_t i = 0; i < pFrame.velocities.size(); ++i) {
+        mQuantized[mCount * 3 + i] = quantize(pFrame.velocities[i].x, mInversePrecision);
+        mQuantized[mCount * 4 + i] = quantize(pFrame.velocities[i].y, mInversePrecision);
+        mQuantized[mCount * 5 + i] = quantize(pFrame.velocities[i].z, mInversePrecision);
+    }
+
+    /* predictions from previous frames only make sense for the same particles */
+    const bool mKeyframe = mRecorded % mKeyframeInterval == 0 || mLast.size() != mQuantized.size();
+    if (mKeyframe) {
+        mDepth = 0;
+    }
+    predict(mLast, mBeforeLast, mDepth, mQuantized.size(), mPrediction);
+    mEncoded.clear();
+    ::encode(mQuantized, mPrediction, mEncoded);
+    mBeforeLast.swap(mLast);
+    mLast.swap(mQuantized);
+    ++mDepth;
+
+    FrameHeader mHeader{};
+    mHeader.type  = mKeyframe ? FRAME_KEY : FRAME_DELTA;
+    mHeader.count = static_cast<uint32_t>(mCount);
+    mHeader.step  = pFrame.step;
+    mHeader.size  = mEncoded.size();
+    if (std::fwrite(&mHeader, sizeof(FrameHeader), 1, mFile) != 1 ||
+        (!mEncoded.empty() && std::fwrite(mEncoded.data(), mEncoded.size(), 1, mFile) != 1)) {
+        mGood = false;
+    }
+    mBytes += sizeof(FrameHeader) + mEncoded.size();
+    ++mRecorded;
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& pFilePath) : mFile(std::fopen(pFilePath.c_str(), "rb")) {
+    if (mFile == nullptr) {
+        return;
+    }
+    Header mHeader{};
+    if (std::fread(&mHeader, sizeof(Header), 1, mFile) != 1 ||
+        std::memcmp(mHeader.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        mHeader.version == 0 ||
+        mHeader.version > TrajectoryRecorder::VERSION ||
+        mHeader.byte_order != BYTE_ORDER_MARK ||
+        !(mHeader.precision > 0.0f)) {
+        std::fclose(mFile);
+        mFile = nullptr;
+        return;
+    }
+    mVelocities = mHeader.flags & FLAG_VELOCITIES;
+    mPrecision  = mHeader.precision;
+
+    std::fseek(mFile, 0, SEEK_END);
+    const auto mSize   = static_cast<uint64_t>(std::ftell(mFile));
+    uint64_t   mOffset = sizeof(Header);
+    std::fseek(mFile, static_cast<long>(mOffset), SEEK_SET);
+
+    /* index the frames, a frame that was not completely written ends the trajectory */
+    FrameHeader mFrameHeader{};
+    while (std::fread(&mFrameHeader, sizeof(FrameHeader), 1, mFile) == 1) {
+        mOffset += sizeof(FrameHeader);
+        if ((mFrameHeader.type != FRAME_KEY && mFrameHeader.type != FRAME_DELTA) ||
+            mFrameHeader.size > mSize - mOffset ||
+            (mFrameHeader.type == FRAME_DELTA && mKeyframes.empty())) {
+            break;
+        }
+        if (mFrameHeader.type == FRAME_KEY) {
+            mKeyframes.push_back(mEntries.size());
+        }
+        mEntries.push_back({mOffset, mFrameHeader.size, mFrameHeader.step, mFrameHeader.count, mFrameHeader.type == FRAME_KEY});
+        mOffset += mFrameHeader.size;
+        if (std::fseek(mFile, static_cast<long>(mOffset), SEEK_SET) != 0) {
+            break;
+        }
+    }
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    if (mFile != nullptr) {
+        std::fclose(mFile);
+    }
+}
+
+size_t TrajectoryReader::keyframe(const size_t pFrame) const {
+    const auto it = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), pFrame);
+    return it == mKeyframes.begin() ? 0 : *(it - 1);
+}
+
+bool TrajectoryReader::seek(const size_t pFrame) {
+    if (mFile == nullptr || pFrame >= mEntries.size()) {
+        return false;
+    }
+    const size_t mKeyframe = keyframe(pFrame);
+    size_t       mFirst    = mKeyframe;
+    if (mFrame != SIZE_MAX && mFrame >= mKeyframe && mFrame <= pFrame) {
+        mFirst = mFrame + 1;
+    }
+    for (size_t i = mFirst; i <= pFrame; ++i) {
+        if (!decode(i)) {
+            mFrame = SIZE_MAX;
+            return false;
+        }
+    }
+    mFrame = pFrame;
+
+    const size_t mCount = mEntries[pFrame].count;
+    mPositions.resize(mCount);
+    mVelocityValues.resize(mVelocities ? mCount : 0);
+    const int32_t* mValues = mQuantized.data();
+    for (size_t i = 0; i < mCount; ++i) {
+        mPositions[i].set(static_cast<float>(mValues[i]) * mPrecision,
+                          static_cast<float>(mValues[mCount + i]) * mPrecision,
+                          static_cast<float>(mValues[mCount * 2 + i]) * mPrecision);
+    }
+    for (size_t i = 0; i < mVelocityValues.size(); ++i) {
+        mVelocityValues[i].set(static_cast<float>(mValues[mCount * 3 + i]) * mPrecision,
+                               static_cast<float>(mValues[mCount * 4 + i]) * mPrecision,
+                               static_cast<float>(mValues[mCount * 5 + i]) * mPrecision);
+    }
+    return true;
+}
+
+bool TrajectoryReader::decode(const size_t pFrame) {
+    const Entry& mEntry = mEntries[pFrame];
+    mEncoded.resize(mEntry.size);
+    if (std::fseek(mFile, static_cast<long>(mEntry.offset), SEEK_SET) != 0 ||
+        (mEntry.size > 0 && std::fread(mEncoded.data(), mEntry.size, 1, mFile) != 1)) {
+        return false;
+    }
+    const size_t mComponents = static_cast<size_t>(mEntry.count) * 3 * (mVelocities ? 2 : 1);
+    if (mEntry.keyframe) {
+        mDepth = 0;
+    } else if (mQuantized.size() != mComponents) {
+        return false;
+    }
+    predict(mQuantized, mBeforeLast, mDepth, mComponents, mPrediction);
+    mBeforeLast.swap(mQuantized);
+    mQuantized.resize(mComponents);
+    ++mDepth;
+    return ::decode(mEncoded.data(), mEncoded.data() + mEncoded.size(), mPrediction, mQuantized);
+}
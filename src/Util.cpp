@@ -25,10 +25,13 @@
 #include "Physics.h"
 
 Particle* Util::findParticleByProximity(Physics& pPhysics, float x, float y, float z, float pSelectionRadius) {
-    return findParticleByProximity(pPhysics.particles(), PVector(x, y, z), pSelectionRadius);
+    return findParticleByProximity(pPhysics, PVector(x, y, z), pSelectionRadius);
 }
 
 Particle* Util::findParticleByProximity(Physics& pPhysics, const PVector& pPosition, float pSelectionRadius) {
+    if (const SpatialHashGrid* mGrid = pPhysics.spatial_hash_grid()) {
+        return mGrid->nearest(pPosition, pSelectionRadius);
+    }
     return findParticleByProximity(pPhysics.particles(), pPosition, pSelectionRadius);
 }
 
@@ -0,0 +1,109 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+
+#include "Physics.h"
+#include "Verlet.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * mirrors the arithmetic of `integrate( Particle& )` operation by operation. the AVX2 path treats 8 particles as
+ * 24 consecutive floats of the position, old position, velocity and force arrays and spreads the inverse masses
+ * and fixed flags of the particles over their components. fixed particles are masked out of all stores. the
+ * scalar loop handles the remainder and all other targets. while particles sleep only the awake list is visited.
+ */
+void Verlet::integrate(const float pDeltaTime, ParticleStore& pStore) const {
+    const size_t   mSize          = pStore.size();
+    PVector*       mPositions     = pStore.positions();
+    PVector*       mOldPositions  = pStore.old_positions();
+    PVector*       mVelocities    = pStore.velocities();
+    const PVector* mForces        = pStore.forces();
+    const float*   mInverseMasses = pStore.inverse_masses();
+    const uint8_t* mFlags         = pStore.flags();
+    const float    mInverseDelta  = 1.0f / pDeltaTime;
+    const float    mDeltaSquared  = pDeltaTime * pDeltaTime;
+    const auto     mIntegrate     = [&](const size_t i) {
+        const PVector mOldPosition = mPositions[i];
+        const PVector mDiff        = PVector::sub(mPositions[i], mOldPositions[i]);
+
+        mVelocities[i] = PVector::mult(mDiff, mInverseDelta);
+
+        PVector mAcceleration = PVector::mult(mForces[i], mInverseMasses[i]);
+        mAcceleration.mult(mDeltaSquared);
+
+        mPositions[i].add(mAcceleration);
+        mPositions[i].add(PVector::mult(mDiff, mDamping));
+
+        mOldPositions[i] = mOldPosition;
+    };
+    if (pStore.sleeping_count() > 0) {
+        pStore.forEachAwake([&](const uint32_t i) {
+            if (!(mFlags[i] & ParticleStore::FIXED)) {
+                mIntegrate(i);
+            }
+        });
+        return;
+    }
+    size_t i = 0;
+#if defined(__AVX2__)
+    static_assert(sizeof(PVector) == 3 * sizeof(float), "`PVector` must consist of 3 floats");
+    const __m256i mComponents[3] = {_mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2),
+                                    _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5),
+                                    _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7)};
+    const __m256  mInverseDeltas = _mm256_set1_ps(mInverseDelta);
+    const __m256  mDeltasSquared = _mm256_set1_ps(mDeltaSquared);
+    const __m256  mDampings      = _mm256_set1_ps(mDamping);
+    const __m256i mImmovable     = _mm256_set1_epi32(ParticleStore::IMMOVABLE);
+    const __m256i mZero          = _mm256_setzero_si256();
+    for (; i + 8 <= mSize; i += 8) {
+        const __m256  mParticleInverseMasses = _mm256_loadu_ps(mInverseMasses + i);
+        const __m256i mParticleFlags         = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mFlags + i)));
+        const __m256i mParticleMovable       = _mm256_cmpeq_epi32(_mm256_and_si256(mParticleFlags, mImmovable), mZero);
+        if (_mm256_testz_si256(mParticleMovable, mParticleMovable)) {
+            continue;
+        }
+        auto* mPosition    = reinterpret_cast<float*>(mPositions + i);
+        auto* mOldPosition = reinterpret_cast<float*>(mOldPositions + i);
+        auto* mVelocity    = reinterpret_cast<float*>(mVelocities + i);
+        auto* mForce       = reinterpret_cast<const float*>(mForces + i);
+        for (size_t k = 0; k < 3; ++k) {
+            const __m256  mInverseMass  = _mm256_permutevar8x32_ps(mParticleInverseMasses, mComponents[k]);
+            const __m256i mMovable      = _mm256_permutevar8x32_epi32(mParticleMovable, mComponents[k]);
+            const __m256  mP            = _mm256_loadu_ps(mPosition + 8 * k);
+            const __m256  mDiff         = _mm256_sub_ps(mP, _mm256_loadu_ps(mOldPosition + 8 * k));
+            const __m256  mAcceleration = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(mForce + 8 * k), mInverseMass), mDeltasSquared);
+            _mm256_maskstore_ps(mVelocity + 8 * k, mMovable, _mm256_mul_ps(mDiff, mInverseDeltas));
+            _mm256_maskstore_ps(mPosition + 8 * k, mMovable, _mm256_add_ps(_mm256_add_ps(mP, mAcceleration), _mm256_mul_ps(mDiff, mDampings)));
+            _mm256_maskstore_ps(mOldPosition + 8 * k, mMovable, mP);
+        }
+    }
+#endif
+    for (; i < mSize; ++i) {
+        if (!(mFlags[i] & ParticleStore::IMMOVABLE)) {
+            mIntegrate(i);
+        }
+    }
+}
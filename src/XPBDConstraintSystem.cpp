@@ -0,0 +1,234 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <algorithm>
+
+#include "XPBDConstraintSystem.h"
+#include "XPBDDistanceConstraint.h"
+#include "ParticleHandle.h"
+#include "ParticleStore.h"
+#include "Physics.h"
+#include "Spring.h"
+#include "Verlet.h"
+
+XPBDConstraintSystem::XPBDConstraintSystem()
+    : mStore(nullptr),
+      mStoreRevision(0),
+      mIndicesValid(false),
+      mIterations(4),
+      mActive(true),
+      mDead(false),
+      mID(Physics::getUniqueID()) {}
+
+uint32_t XPBDConstraintSystem::make(Particle* pA, Particle* pB) {
+    return make(pA, pB, PVector::dist(pA->position(), pB->position()));
+}
+
+uint32_t XPBDConstraintSystem::make(Particle*   pA,
+                                    Particle*   pB,
+                                    const float pRestLength,
+                                    const float pCompliance,
+                                    const float pDamping) {
+    const auto mIndex = static_cast<uint32_t>(size());
+    mParticlesA.push_back(pA);
+    mParticlesB.push_back(pB);
+    mRestLengths.push_back(pRestLength);
+    mCompliances.push_back(pCompliance);
+    mDampings.push_back(pDamping);
+    mLambdas.push_back(0.0f);
+    /* index arrays are rebuilt on the next `apply` */
+    mStore = nullptr;
+    return mIndex;
+}
+
+uint32_t XPBDConstraintSystem::make(Spring* pSpring) {
+    const float mStrength = pSpring->strength();
+    return make(pSpring->a(),
+                pSpring->b(),
+                pSpring->restlength(),
+                mStrength > 0.0f ? 1.0f / mStrength : 0.0f,
+                pSpring->damping());
+}
+
+size_t XPBDConstraintSystem::convert(Physics& pParticleSystem) {
+    std::vector<Force*> mConverted;
+    for (auto* mForce: pParticleSystem.forces()) {
+        auto* mSpring = dynamic_cast<Spring*>(mForce);
+        if (mSpring == nullptr || !mSpring->active() || mSpring->dead() || mSpring->oneway() ||
+            mSpring->strength() <= 0.0f) {
+            continue;
+        }
+        make(mSpring);
+        mConverted.push_back(mSpring);
+    }
+    pParticleSystem.remove(mConverted);
+    return mConverted.size();
+}
+
+void XPBDConstraintSystem::remove(const uint32_t pIndex) {
+    if (pIndex >= size()) {
+        return;
+    }
+    mParticlesA.erase(mParticlesA.begin() + pIndex);
+    mParticlesB.erase(mParticlesB.begin() + pIndex);
+    mRestLengths.erase(mRestLengths.begin() + pIndex);
+    mCompliances.erase(mCompliances.begin() + pIndex);
+    mDampings.erase(mDampings.begin() + pIndex);
+    mLambdas.erase(mLambdas.begin() + pIndex);
+    mStore = nullptr;
+}
+
+template<typename P>
+size_t XPBDConstraintSystem::removeIf(P pRemoved) {
+    size_t mWrite = 0;
+    for (size_t i = 0; i < size(); ++i) {
+        if (pRemoved(mParticlesA[i]) || pRemoved(mParticlesB[i])) {
+            continue;
+        }
+        if (mWrite != i) {
+            mParticlesA[mWrite]  = mParticlesA[i];
+            mParticlesB[mWrite]  = mParticlesB[i];
+            mRestLengths[mWrite] = mRestLengths[i];
+            mCompliances[mWrite] = mCompliances[i];
+            mDampings[mWrite]    = mDampings[i];
+            mLambdas[mWrite]     = mLambdas[i];
+        }
+        ++mWrite;
+    }
+    const size_t mRemoved = size() - mWrite;
+    if (mRemoved > 0) {
+        mParticlesA.resize(mWrite);
+        mParticlesB.resize(mWrite);
+        mRestLengths.resize(mWrite);
+        mCompliances.resize(mWrite);
+        mDampings.resize(mWrite);
+        mLambdas.resize(mWrite);
+        mStore = nullptr;
+    }
+    return mRemoved;
+}
+
+size_t XPBDConstraintSystem::removeDead() {
+    return removeIf([](const Particle* p) { return p->dead(); });
+}
+
+size_t XPBDConstraintSystem::removeConnected(const std::unordered_set<const Particle*>& pParticles) {
+    return removeIf([&](const Particle* p) { return pParticles.count(p) > 0; });
+}
+
+void XPBDConstraintSystem::reserve(const size_t pCapacity) {
+    mParticlesA.reserve(pCapacity);
+    mParticlesB.reserve(pCapacity);
+    mA.reserve(pCapacity);
+    mB.reserve(pCapacity);
+    mRestLengths.reserve(pCapacity);
+    mCompliances.reserve(pCapacity);
+    mDampings.reserve(pCapacity);
+    mLambdas.reserve(pCapacity);
+}
+
+void XPBDConstraintSystem::apply(Physics& pParticleSystem) {
+    const float mDeltaTime = pParticleSystem.delta_time();
+    if (!mActive || size() == 0 || mDeltaTime <= 0.0f) {
+        return;
+    }
+    std::fill(mLambdas.begin(), mLambdas.end(), 0.0f);
+    /* with a `Verlet` integrator velocities follow from the corrected positions */
+    const bool     mUpdateVelocities = dynamic_cast<Verlet*>(pParticleSystem.getIntegrator()) == nullptr;
+    ParticleStore* mPacked           = pParticleSystem.packed();
+    if (mPacked != nullptr && updateIndices(*mPacked)) {
+        applyPacked(*mPacked, mDeltaTime, mUpdateVelocities);
+    } else {
+        applyIndirect(mDeltaTime, mUpdateVelocities);
+    }
+}
+
+bool XPBDConstraintSystem::updateIndices(const ParticleStore& pStore) {
+    if (mStore == &pStore && mStoreRevision == pStore.revision()) {
+        return mIndicesValid;
+    }
+    mStore         = &pStore;
+    mStoreRevision = pStore.revision();
+    mIndicesValid  = true;
+    mA.resize(size());
+    mB.resize(size());
+    for (size_t i = 0; i < size(); ++i) {
+        const auto mHandleA = dynamic_cast<ParticleHandle*>(mParticlesA[i]);
+        const auto mHandleB = dynamic_cast<ParticleHandle*>(mParticlesB[i]);
+        if (mHandleA == nullptr || mHandleA->store() != &pStore || !mHandleA->attached() ||
+            mHandleB == nullptr || mHandleB->store() != &pStore || !mHandleB->attached()) {
+            mIndicesValid = false;
+            break;
+        }
+        mA[i] = mHandleA->index();
+        mB[i] = mHandleB->index();
+    }
+    return mIndicesValid;
+}
+
+void XPBDConstraintSystem::applyPacked(ParticleStore& pStore, const float pDeltaTime, const bool pUpdateVelocities) {
+    const size_t   mCount         = size();
+    PVector*       mPositions     = pStore.positions();
+    PVector*       mVelocities    = pStore.velocities();
+    const float*   mInverseMasses = pStore.inverse_masses();
+    const uint8_t* mFlags         = pStore.flags();
+    for (int mIteration = 0; mIteration < mIterations; ++mIteration) {
+        for (size_t i = 0; i < mCount; ++i) {
+            const uint32_t a       = mA[i];
+            const uint32_t b       = mB[i];
+            const float    mLambda = XPBDDistanceConstraint::project(mPositions[a], mPositions[b],
+                                                                     mVelocities[a], mVelocities[b],
+                                                                     mFlags[a] & ParticleStore::FIXED ? 0.0f : mInverseMasses[a],
+                                                                     mFlags[b] & ParticleStore::FIXED ? 0.0f : mInverseMasses[b],
+                                                                     mRestLengths[i], mCompliances[i], mDampings[i],
+                                                                     mLambdas[i], pDeltaTime, pUpdateVelocities);
+            /* a correction moves sleeping particles, they must integrate again */
+            if (mLambda != mLambdas[i] && ((mFlags[a] | mFlags[b]) & ParticleStore::SLEEPING)) {
+                pStore.wake(a);
+                pStore.wake(b);
+            }
+            mLambdas[i] = mLambda;
+        }
+    }
+}
+
+void XPBDConstraintSystem::applyIndirect(const float pDeltaTime, const bool pUpdateVelocities) {
+    const size_t mCount = size();
+    for (int mIteration = 0; mIteration < mIterations; ++mIteration) {
+        for (size_t i = 0; i < mCount; ++i) {
+            Particle*   mParticleA = mParticlesA[i];
+            Particle*   mParticleB = mParticlesB[i];
+            const float mLambda    = XPBDDistanceConstraint::project(mParticleA->position(), mParticleB->position(),
+                                                                     mParticleA->velocity(), mParticleB->velocity(),
+                                                                     mParticleA->fixed() ? 0.0f : 1.0f / mParticleA->mass(),
+                                                                     mParticleB->fixed() ? 0.0f : 1.0f / mParticleB->mass(),
+                                                                     mRestLengths[i], mCompliances[i], mDampings[i],
+                                                                     mLambdas[i], pDeltaTime, pUpdateVelocities);
+            if (mLambda != mLambdas[i]) {
+                mParticleA->wake();
+                mParticleB->wake();
+            }
+            mLambdas[i] = mLambda;
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+#include <cmath>
+
+#include "XPBDDistanceConstraint.h"
+#include "Physics.h"
+#include "Spring.h"
+#include "Verlet.h"
+
+XPBDDistanceConstraint::XPBDDistanceConstraint(Particle* pA, Particle* pB)
+    : XPBDDistanceConstraint(pA, pB, PVector::dist(pA->position(), pB->position())) {}
+
+XPBDDistanceConstraint::XPBDDistanceConstraint(Particle*   pA,
+                                               Particle*   pB,
+                                               const float pRestLength,
+                                               const float pCompliance)
+    : mA(pA),
+      mB(pB),
+      mRestLength(pRestLength),
+      mCompliance(pCompliance),
+      mDamping(0.0f),
+      mIterations(1),
+      mActive(true),
+      mDead(false),
+      mID(Physics::getUniqueID()) {}
+
+XPBDDistanceConstraint::XPBDDistanceConstraint(Spring* pSpring)
+    : XPBDDistanceConstraint(pSpring->a(),
+                             pSpring->b(),
+                             pSpring->restlength(),
+                             pSpring->strength() > 0.0f ? 1.0f / pSpring->strength() : 0.0f) {
+    mDamping = pSpring->damping();
+    mActive  = pSpring->active() && pSpring->strength() > 0.0f;
+}
+
+bool XPBDDistanceConstraint::dead() const {
+    /* a constraint marked dead does not touch its particles anymore, they may be released already */
+    return mDead || mA->dead() || mB->dead();
+}
+
+void XPBDDistanceConstraint::apply(Physics& pParticleSystem) {
+    const float mDeltaTime = pParticleSystem.delta_time();
+    if (!mActive || mDead || mDeltaTime <= 0.0f) {
+        return;
+    }
+    const float mInverseMassA = mA->fixed() ? 0.0f : 1.0f / mA->mass();
+    const float mInverseMassB = mB->fixed() ? 0.0f : 1.0f / mB->mass();
+    const bool  mVerlet       = dynamic_cast<Verlet*>(pParticleSystem.getIntegrator()) != nullptr;
+    float       mLambda       = 0.0f;
+    for (int i = 0; i < mIterations; ++i) {
+        const float mProjected = project(mA->position(), mB->position(), mA->velocity(), mB->velocity(),
+                                         mInverseMassA, mInverseMassB, mRestLength, mCompliance, mDamping,
+                                         mLambda, mDeltaTime, !mVerlet);
+        /* a correction moves sleeping particles, they must integrate again */
+        if (mProjected != mLambda) {
+            mA->wake();
+            mB->wake();
+        }
+        mLambda = mProjected;
+    }
+}
+
+float XPBDDistanceConstraint::project(PVector&    pPositionA,
+                                      PVector&    pPositionB,
+                                      PVector&    pVelocityA,
+                                      PVector&    pVelocityB,
+                                      const float pInverseMassA,
+                                      const float pInverseMassB,
+                                      const float pRestLength,
+                                      const float pCompliance,
+                                      const float pDamping,
+                                      const float pLambda,
+                                      const float pDeltaTime,
+                                      const bool  pUpdateVelocities) {
+    const float mInverseMass = pInverseMassA + pInverseMassB;
+    if (mInverseMass == 0.0f) {
+        return pLambda;
+    }
+    const float dx        = pPositionA.x - pPositionB.x;
+    const float dy        = pPositionA.y - pPositionB.y;
+    const float dz        = pPositionA.z - pPositionB.z;
+    const float mDistance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    if (mDistance == 0.0f) {
+        return pLambda;
+    }
+    const float nx = dx / mDistance;
+    const float ny = dy / mDistance;
+    const float nz = dz / mDistance;
+
+    /* `alpha = compliance / dt^2`, damping as in XPBD with `gamma = alpha * beta / dt` and `beta = damping * dt^2` */
+    const float mAlpha = pCompliance / (pDeltaTime * pDeltaTime);
+    const float mGamma = pCompliance * pDamping / pDeltaTime;
+    /* displacement along the constraint during this step, estimated from the relative velocity */
+    const float mDisplacement = pDeltaTime * (nx * (pVelocityA.x - pVelocityB.x) +
+                                              ny * (pVelocityA.y - pVelocityB.y) +
+                                              nz * (pVelocityA.z - pVelocityB.z));
+    const float mDeltaLambda = (pRestLength - mDistance - mAlpha * pLambda - mGamma * mDisplacement) /
+                               ((1.0f + mGamma) * mInverseMass + mAlpha);
+
+    const float mCorrectionA = mDeltaLambda * pInverseMassA;
+    const float mCorrectionB = mDeltaLambda * pInverseMassB;
+    pPositionA.add(nx * mCorrectionA, ny * mCorrectionA, nz * mCorrectionA);
+    pPositionB.sub(nx * mCorrectionB, ny * mCorrectionB, nz * mCorrectionB);
+    if (pUpdateVelocities) {
+        const float mInverseDeltaTime = 1.0f / pDeltaTime;
+        pVelocityA.add(nx * mCorrectionA * mInverseDeltaTime, ny * mCorrectionA * mInverseDeltaTime, nz * mCorrectionA * mInverseDeltaTime);
+        pVelocityB.sub(nx * mCorrectionB * mInverseDeltaTime, ny * mCorrectionB * mInverseDeltaTime, nz * mCorrectionB * mInverseDeltaTime);
+    }
+    return pLambda + mDeltaLambda;
+}
@@ -0,0 +1,158 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+/*
+ * checks the error control of `DormandPrince`. a harmonic oscillator is integrated against its exact solution with
+ * decreasing tolerances, which must decrease the error. a particle under constant gravity must advance in a single
+ * substep per frame and a stiff spring chain must stay bounded by subdividing its frames.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "DormandPrince.h"
+#include "Gravity.h"
+#include "Physics.h"
+
+namespace {
+    constexpr float DELTA_TIME = 1.0f / 30.0f;
+
+    /* pulls a particle towards the origin with a force proportional to its distance */
+    class Anchor final : public Force {
+        Particle*  mParticle;
+        float      mStrength;
+        bool       mActive = true;
+        bool       mDead   = false;
+        const long mID;
+
+    public:
+        Anchor(Particle* pParticle, const float pStrength)
+            : mParticle(pParticle), mStrength(pStrength), mID(Physics::getUniqueID()) {}
+
+        void apply(float /* pDeltaTime */, Physics& /* pParticleSystem */) override {
+            PVector mForce = mParticle->position();
+            mForce.mult(-mStrength);
+            mParticle->force().add(mForce);
+        }
+
+        bool dead() const override { return mDead; }
+        void dead(const bool pDead) override { mDead = pDead; }
+        bool active() const override { return mActive; }
+        void active(const bool pActiveState) override { mActive = pActiveState; }
+        long ID() const override { return mID; }
+    };
+
+    /* largest deviation of a stiff oscillator from `cos( omega * t )` over two seconds, about ten periods */
+    float oscillate(const float pTolerance, int& pEvaluations) {
+        constexpr float STRENGTH = 1000.0f;
+        const float     mOmega   = std::sqrt(STRENGTH);
+
+        Physics       mPhysics;
+        DormandPrince mIntegrator;
+        mIntegrator.tolerance(pTolerance);
+        mPhysics.setIntegratorRef(&mIntegrator);
+        Particle* mParticle = mPhysics.makeParticle(1, 0, 0);
+        Anchor    mAnchor(mParticle, STRENGTH);
+        mPhysics.add(&mAnchor);
+
+        float mError = 0.0f;
+        pEvaluations = 0;
+        for (int i = 1; i <= 60; ++i) {
+            mPhysics.step(DELTA_TIME);
+            pEvaluations += mIntegrator.evaluations();
+            const double t = static_cast<double>(i) * DELTA_TIME;
+            mError         = std::max(mError, std::fabs(mParticle->position().x - static_cast<float>(std::cos(mOmega * t))));
+        }
+        return mError;
+    }
+
+    int checkTolerance() {
+        int   mFailures      = 0;
+        float mFirstError    = 0.0f;
+        float mPreviousError = INFINITY;
+        for (const float mTolerance: {1.0e-2f, 1.0e-3f, 1.0e-4f, 1.0e-5f}) {
+            int         mEvaluations;
+            const float mError = oscillate(mTolerance, mEvaluations);
+            const bool  mOk    = mError < mPreviousError;
+            std::printf("oscillator, tolerance %g: error %g, %d evaluations %s\n", mTolerance, mError, mEvaluations, mOk ? "ok" : "did not decrease");
+            mFailures += !mOk;
+            mFirstError    = mFirstError == 0.0f ? mError : mFirstError;
+            mPreviousError = mError;
+        }
+        /* the error accumulated over many periods shrinks roughly with the tolerance */
+        const bool mOk = mPreviousError * 100.0f < mFirstError;
+        std::printf("oscillator: error reduced %gx by a 1000x tighter tolerance %s\n", mFirstError / mPreviousError, mOk ? "ok" : "too little");
+        return mFailures + !mOk;
+    }
+
+    int checkCalm() {
+        Physics       mPhysics;
+        DormandPrince mIntegrator;
+        mPhysics.setIntegratorRef(&mIntegrator);
+        mPhysics.makeForce<Gravity>();
+        for (int i = 0; i < 100; ++i) {
+            mPhysics.makeParticle(static_cast<float>(i), 0, 0);
+        }
+        int mSubsteps = 0;
+        for (int i = 0; i < 60; ++i) {
+            mPhysics.step(DELTA_TIME);
+            mSubsteps = std::max(mSubsteps, mIntegrator.substeps());
+        }
+        std::printf("gravity: at most %d substeps per frame %s\n", mSubsteps, mSubsteps == 1 ? "ok" : "too many");
+        return mSubsteps == 1 ? 0 : 1;
+    }
+
+    int checkStiff() {
+        Physics       mPhysics;
+        DormandPrince mIntegrator;
+        mPhysics.setIntegratorRef(&mIntegrator);
+        mPhysics.makeForce<Gravity>();
+        std::vector<Particle*> mChain;
+        for (int i = 0; i < 10; ++i) {
+            mChain.push_back(mPhysics.makeParticle(static_cast<float>(i) * 10.0f, 0, 0));
+        }
+        mChain.front()->fixed(true);
+        for (int i = 1; i < 10; ++i) {
+            mPhysics.makeSpring(mChain[i - 1], mChain[i], 20000.0f, 0.1f, 10.0f);
+        }
+        int   mSubsteps = 0;
+        float mExtent   = 0.0f;
+        for (int i = 0; i < 120; ++i) {
+            mPhysics.step(DELTA_TIME);
+            mSubsteps = std::max(mSubsteps, mIntegrator.substeps());
+            for (const auto& p: mChain) {
+                mExtent = std::max(mExtent, p->position().mag());
+            }
+        }
+        /* the stretched chain is about 90 units long */
+        const bool mOk = std::isfinite(mExtent) && mExtent < 200.0f && mSubsteps > 1;
+        std::printf("stiff chain: extent %g, at most %d substeps per frame %s\n", mExtent, mSubsteps, mOk ? "ok" : "unstable");
+        return mOk ? 0 : 1;
+    }
+} // namespace
+
+int main() {
+    const int mFailures = checkTolerance() + checkCalm() + checkStiff();
+    return mFailures == 0 ? 0 : 1;
+}
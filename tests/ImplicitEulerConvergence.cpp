@@ -0,0 +1,121 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+/*
+ * checks `ImplicitEuler`. a particle on a spring is integrated with halved time steps and compared with a
+ * reference solution of `DormandPrince`, the error of a first order method must roughly halve with the time step. a
+ * stiff cloth must stay bounded at `1/30` seconds per frame with a conjugate gradient solve that converges before
+ * it runs out of iterations.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "DormandPrince.h"
+#include "Gravity.h"
+#include "ImplicitEuler.h"
+#include "Physics.h"
+
+namespace {
+    constexpr float DURATION = 1.0f;
+
+    /* position of a particle on a spring after `DURATION` seconds */
+    PVector oscillate(Integrator& pIntegrator, const int pSteps) {
+        Physics mPhysics;
+        mPhysics.setIntegratorRef(&pIntegrator);
+        Particle* mAnchor   = mPhysics.makeParticle(0, 0, 0);
+        Particle* mParticle = mPhysics.makeParticle(2, 0.5f, 0);
+        mAnchor->fixed(true);
+        mPhysics.makeSpring(mAnchor, mParticle, 50.0f, 0.5f, 1.0f);
+        for (int i = 0; i < pSteps; ++i) {
+            mPhysics.step(DURATION / static_cast<float>(pSteps));
+        }
+        return mParticle->position();
+    }
+
+    int checkConvergence() {
+        DormandPrince mReference;
+        mReference.tolerance(1.0e-7f);
+        const PVector mExpected = oscillate(mReference, 960);
+
+        int   mFailures      = 0;
+        float mPreviousError = 0.0f;
+        for (const int mSteps: {120, 240, 480, 960}) {
+            ImplicitEuler mIntegrator;
+            const float   mError = PVector::dist(oscillate(mIntegrator, mSteps), mExpected);
+            /* first order convergence, allowing for the higher order terms at large steps */
+            const bool mOk = mPreviousError == 0.0f || mError * 1.6f < mPreviousError;
+            std::printf("spring, %3d steps: error %g %s\n", mSteps, mError, mOk ? "ok" : "did not converge");
+            mFailures += !mOk;
+            mPreviousError = mError;
+        }
+        return mFailures;
+    }
+
+    int checkCloth() {
+        constexpr int   SIZE    = 16;
+        constexpr float SPACING = 10.0f;
+
+        Physics       mPhysics;
+        ImplicitEuler mIntegrator;
+        mPhysics.setIntegratorRef(&mIntegrator);
+        mPhysics.makeForce<Gravity>();
+        std::vector<Particle*> mGrid;
+        for (int y = 0; y < SIZE; ++y) {
+            for (int x = 0; x < SIZE; ++x) {
+                Particle* mParticle = mPhysics.makeParticle(static_cast<float>(x) * SPACING, static_cast<float>(y) * SPACING, 0);
+                mParticle->fixed(y == 0);
+                mGrid.push_back(mParticle);
+            }
+        }
+        for (int y = 0; y < SIZE; ++y) {
+            for (int x = 0; x < SIZE; ++x) {
+                if (x > 0) {
+                    mPhysics.makeSpring(mGrid[y * SIZE + x - 1], mGrid[y * SIZE + x], 500.0f, 0.1f, SPACING);
+                }
+                if (y > 0) {
+                    mPhysics.makeSpring(mGrid[(y - 1) * SIZE + x], mGrid[y * SIZE + x], 500.0f, 0.1f, SPACING);
+                }
+            }
+        }
+        int   mIterations = 0;
+        float mExtent     = 0.0f;
+        for (int i = 0; i < 120; ++i) {
+            mPhysics.step(1.0f / 30.0f);
+            mIterations = std::max(mIterations, mIntegrator.last_iterations());
+            for (const auto& p: mGrid) {
+                mExtent = std::max(mExtent, p->position().mag());
+            }
+        }
+        /* the hanging cloth stretches a little beyond its diagonal */
+        const bool mOk = std::isfinite(mExtent) && mExtent < 2.0f * SIZE * SPACING && mIterations < mIntegrator.iterations();
+        std::printf("cloth: extent %g, at most %d of %d iterations %s\n", mExtent, mIterations, mIntegrator.iterations(), mOk ? "ok" : "unstable");
+        return mOk ? 0 : 1;
+    }
+} // namespace
+
+int main() {
+    const int mFailures = checkConvergence() + checkCloth();
+    return mFailures == 0 ? 0 : 1;
+}
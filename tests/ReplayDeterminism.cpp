@@ -0,0 +1,242 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+/*
+ * records a session covering the features that influence a step ( particle store, sleeping, islands, threads,
+ * integrator switches, removals and springs that change their particles ), replays it into a new system and
+ * compares the state after every step bit for bit. the final state is then saved as a snapshot, loaded into
+ * another system and both systems are stepped side by side. islands apply springs in an order that depends on the
+ * history of the spring network, so snapshots are only compared while islands are disabled. every single threaded
+ * session is also recorded on multiple threads with `HINT_DETERMINISTIC_REDUCTION`, which must match it bit for bit.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Physics.h"
+#include "Gravity.h"
+#include "ViscousDrag.h"
+#include "Attractor.h"
+#include "Box.h"
+#include "Verlet.h"
+#include "DormandPrince.h"
+#include "Replay.h"
+#include "Snapshot.h"
+
+namespace {
+    constexpr int STEPS          = 600;
+    constexpr int SNAPSHOT_STEPS = 60;
+
+    /* bits of the session modes */
+    constexpr int PARTICLE_STORE = 1 << 0;
+    constexpr int SLEEPING       = 1 << 1;
+    constexpr int ISLANDS        = 1 << 2;
+    constexpr int THREADS        = 1 << 3;
+    constexpr int DETERMINISTIC  = 1 << 4;
+
+    /* FNV-1a over the state of all valid particles */
+    uint64_t hash(Physics& pPhysics) {
+        uint64_t   mHash = 1469598103934665603ULL;
+        const auto mMix  = [&](const void* pData, const size_t pSize) {
+            const auto mBytes = static_cast<const uint8_t*>(pData);
+            for (size_t i = 0; i < pSize; ++i) {
+                mHash ^= mBytes[i];
+                mHash *= 1099511628211ULL;
+            }
+        };
+        for (const auto& p: pPhysics.particles()) {
+            if (!pPhysics.handle(p).valid()) {
+                continue;
+            }
+            const bool mSleeping = p->sleeping();
+            mMix(&p->position(), sizeof(PVector));
+            mMix(&p->velocity(), sizeof(PVector));
+            mMix(&mSleeping, sizeof(mSleeping));
+        }
+        const size_t mParticles = pPhysics.particles().size();
+        const size_t mForces    = pPhysics.forces().size();
+        mMix(&mParticles, sizeof(mParticles));
+        mMix(&mForces, sizeof(mForces));
+        return mHash;
+    }
+
+    float delta_time(const int pStep) {
+        return 1.0f / (55.0f + static_cast<float>(pStep % 10));
+    }
+
+    void record(Physics& pPhysics, const std::string& pFilePath, const int pMode, std::vector<uint64_t>& pHashes) {
+        pPhysics.useParticleStore(pMode & PARTICLE_STORE);
+        pPhysics.useSleeping(pMode & SLEEPING);
+        pPhysics.useIslands(pMode & ISLANDS);
+        pPhysics.threads((pMode & THREADS) ? 4 : 1);
+        pPhysics.HINT_DETERMINISTIC_REDUCTION = pMode & DETERMINISTIC;
+        pPhysics.makeParticle(10, 10, 0);
+
+        ReplayRecorder mRecorder(pPhysics, pFilePath, 1234);
+        Gravity*       mGravity = pPhysics.makeForce<Gravity>();
+        mGravity->force().set(0, 3, 0);
+        pPhysics.makeForce<ViscousDrag>()->coefficient = 0.1f;
+        pPhysics.makeConstraint<Box>()->max().set(400, 400, 0);
+
+        std::vector<Particle*> mParticles;
+        Particle*              mLast = nullptr;
+        for (int i = 0; i < STEPS; ++i) {
+            if (i % 7 == 0) {
+                PVector mOffset = PVector::random2D();
+                mOffset.mult(50);
+                Particle* mParticle = pPhysics.makeParticle(200 + mOffset.x, 100 + mOffset.y, 0);
+                if (mLast != nullptr && pPhysics.handle(mLast).valid()) {
+                    Spring* mSpring = pPhysics.makeSpring(mLast, mParticle, 20, 0.2f, 30);
+                    if (i % 21 == 0) {
+                        mSpring->restlength(10);
+                    }
+                }
+                mLast = mParticle;
+                mParticles.push_back(mParticle);
+            }
+            if (i % 13 == 0) {
+                Particle* mParticle = mParticles[(i * 31) % mParticles.size()];
+                if (pPhysics.handle(mParticle).valid()) {
+                    mParticle->position().add(5, -3, 0);
+                    mParticle->wake();
+                }
+            }
+            if (i % 50 == 49 && mParticles.size() > 3) {
+                Particle* mParticle = mParticles[(i * 17) % mParticles.size()];
+                if (pPhysics.handle(mParticle).valid()) {
+                    pPhysics.remove(mParticle);
+                }
+            }
+            if (i % 60 == 30) {
+                /* re-point the first spring that is not already connected to the chosen particle */
+                Particle* mParticle = mParticles[(i * 7) % mParticles.size()];
+                for (const auto& f: pPhysics.forces()) {
+                    const auto mSpring = dynamic_cast<Spring*>(f);
+                    if (mSpring != nullptr && pPhysics.handle(mParticle).valid() && mSpring->a() != mParticle) {
+                        mSpring->b(mParticle);
+                        break;
+                    }
+                }
+            }
+            if (i % 100 == 50) {
+                Attractor* mAttractor = pPhysics.makeForce<Attractor>();
+                mAttractor->position().set(200, 200, 0);
+                mAttractor->strength(50);
+                mAttractor->radius(100);
+            }
+            if (i == 200) {
+                pPhysics.HINT_REMOVE_DEAD = false;
+            }
+            if (i == 300) {
+                mGravity->force().set(1, 2, 0);
+                pPhysics.replace_integrator(new Verlet(0.99f));
+                pPhysics.HINT_COLOR_SPRINGS = false;
+            }
+            if (i == 400) {
+                pPhysics.replace_integrator(new DormandPrince());
+                pPhysics.HINT_REMOVE_DEAD = true;
+            }
+            pPhysics.step(delta_time(i));
+            pHashes.push_back(hash(pPhysics));
+        }
+    }
+
+    /* returns the first step that differs or -1 */
+    int compare(const std::vector<uint64_t>& pExpected, const std::vector<uint64_t>& pActual) {
+        for (size_t i = 0; i < pExpected.size(); ++i) {
+            if (i >= pActual.size() || pExpected[i] != pActual[i]) {
+                return static_cast<int>(i);
+            }
+        }
+        return pActual.size() == pExpected.size() ? -1 : static_cast<int>(pExpected.size());
+    }
+} // namespace
+
+int main(const int argc, char* argv[]) {
+    const std::string mDirectory = argc > 1 ? argv[1] : ".";
+    int               mFailures  = 0;
+    for (int mMode = 0; mMode < DETERMINISTIC; ++mMode) {
+        const std::string     mSession  = mDirectory + "/session" + std::to_string(mMode) + ".replay";
+        const std::string     mSnapshot = mDirectory + "/session" + std::to_string(mMode) + ".snapshot";
+        std::vector<uint64_t> mRecorded;
+        Physics               mPhysics;
+        record(mPhysics, mSession, mMode, mRecorded);
+
+        Physics               mReplayed;
+        Replayer              mReplayer(mSession);
+        std::vector<uint64_t> mHashes;
+        while (mReplayer.next(mReplayed)) {
+            mHashes.push_back(hash(mReplayed));
+        }
+        const int mReplayDiff = mReplayer.good() ? compare(mRecorded, mHashes) : 0;
+
+        /* the snapshot leaves the number of threads to the loading system */
+        const bool mCompareSnapshot = !mPhysics.usesIslands();
+        Physics    mLoaded;
+        mLoaded.threads(mPhysics.threads());
+        int mSnapshotDiff = -1;
+        if (!Snapshot::save(mPhysics, mSnapshot) || !Snapshot::load(mLoaded, mSnapshot) || hash(mLoaded) != hash(mPhysics)) {
+            mSnapshotDiff = 0;
+        }
+        for (int i = 0; i < SNAPSHOT_STEPS && mCompareSnapshot && mSnapshotDiff < 0; ++i) {
+            mPhysics.step(delta_time(i));
+            mLoaded.step(delta_time(i));
+            if (hash(mLoaded) != hash(mPhysics)) {
+                mSnapshotDiff = i + 1;
+            }
+        }
+
+        /* the same session on multiple threads with deterministic reduction */
+        int mThreadedDiff = -1;
+        if (!(mMode & THREADS)) {
+            const std::string     mThreadedSession = mDirectory + "/session" + std::to_string(mMode) + "_threaded.replay";
+            std::vector<uint64_t> mThreadedHashes;
+            Physics               mThreaded;
+            record(mThreaded, mThreadedSession, mMode | THREADS | DETERMINISTIC, mThreadedHashes);
+            mThreadedDiff = compare(mRecorded, mThreadedHashes);
+            std::remove(mThreadedSession.c_str());
+        }
+
+        std::printf("mode %2d: replay %s", mMode, mReplayDiff < 0 ? "ok" : "differs");
+        if (mReplayDiff >= 0) {
+            std::printf(" at step %d", mReplayDiff);
+        }
+        if (!(mMode & THREADS)) {
+            std::printf(", threaded %s", mThreadedDiff < 0 ? "ok" : "differs");
+            if (mThreadedDiff >= 0) {
+                std::printf(" at step %d", mThreadedDiff);
+            }
+        }
+        std::printf(", snapshot %s", mSnapshotDiff < 0 ? (mCompareSnapshot ? "ok" : "loaded") : "differs");
+        if (mSnapshotDiff >= 0) {
+            std::printf(" at step %d", mSnapshotDiff);
+        }
+        std::printf("\n");
+        mFailures += mReplayDiff >= 0 || mSnapshotDiff >= 0 || mThreadedDiff >= 0;
+        std::remove(mSession.c_str());
+        std::remove(mSnapshot.c_str());
+    }
+    return mFailures == 0 ? 0 : 1;
+}
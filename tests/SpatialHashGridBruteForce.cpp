@@ -0,0 +1,196 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+/*
+ * compares the radius, nearest neighbor and pair queries of `SpatialHashGrid` with a brute force search over all
+ * particles. particles are spread uniformly, clustered and far from the origin, grids are built with cell sizes
+ * well below, close to and well above the query radius. the pairs collected on multiple threads must equal the
+ * pairs collected on one thread in the same order.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "BasicParticle.h"
+#include "SpatialHashGrid.h"
+#include "ThreadPool.h"
+
+namespace {
+    constexpr int PARTICLES = 1500;
+    constexpr int QUERIES   = 300;
+
+    float distanceSquared(const PVector& p0, const PVector& p1) {
+        const float dx = p0.x - p1.x;
+        const float dy = p0.y - p1.y;
+        const float dz = p0.z - p1.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    /* unordered pair of particles with the smaller address first */
+    std::pair<const Particle*, const Particle*> ordered(const Particle* pA, const Particle* pB) {
+        return std::less<const Particle*>()(pA, pB) ? std::make_pair(pA, pB) : std::make_pair(pB, pA);
+    }
+
+    std::vector<std::unique_ptr<BasicParticle>> scatter(const int pDistribution, std::mt19937& pRandom) {
+        std::uniform_real_distribution<float>       mUniform(0.0f, 200.0f);
+        std::normal_distribution<float>             mCluster(0.0f, 4.0f);
+        std::vector<std::unique_ptr<BasicParticle>> mParticles;
+        for (int i = 0; i < PARTICLES; ++i) {
+            auto mParticle = std::make_unique<BasicParticle>();
+            switch (pDistribution) {
+                case 0:
+                    mParticle->position().set(mUniform(pRandom), mUniform(pRandom), mUniform(pRandom) * 0.1f);
+                    break;
+                case 1:
+                    /* a few dense clusters, some particles share their position */
+                    mParticle->position().set(50.0f * static_cast<float>(i % 4) + mCluster(pRandom), mCluster(pRandom), 0.0f);
+                    if (i % 10 == 0) {
+                        mParticle->position().set(1.5f, -2.5f, 0.0f);
+                    }
+                    break;
+                default:
+                    /* negative and large coordinates */
+                    mParticle->position().set(-1.0e5f + mUniform(pRandom), 3.0e4f - mUniform(pRandom), -mUniform(pRandom));
+                    break;
+            }
+            mParticles.push_back(std::move(mParticle));
+        }
+        return mParticles;
+    }
+
+    /* returns an empty string if all queries match the brute force search or a description of the first mismatch */
+    const char* check(const std::vector<Particle*>& pParticles, SpatialHashGrid& pGrid, const float pRadius, ThreadPool& pThreadPool, std::mt19937& pRandom) {
+        std::uniform_int_distribution<size_t> mPick(0, pParticles.size() - 1);
+        std::normal_distribution<float>       mOffset(0.0f, pRadius);
+        std::vector<Particle*>                mFound;
+        for (int q = 0; q < QUERIES; ++q) {
+            PVector mPosition = pParticles[mPick(pRandom)]->position();
+            mPosition.add(mOffset(pRandom), mOffset(pRandom), mOffset(pRandom));
+
+            std::vector<Particle*> mExpected;
+            const Particle*        mNearest                = nullptr;
+            float                  mNearestDistanceSquared = pRadius * pRadius;
+            for (const auto& p: pParticles) {
+                const float mDistanceSquared = distanceSquared(mPosition, p->position());
+                if (mDistanceSquared < pRadius * pRadius) {
+                    mExpected.push_back(p);
+                }
+                if (mDistanceSquared < mNearestDistanceSquared) {
+                    mNearestDistanceSquared = mDistanceSquared;
+                    mNearest                = p;
+                }
+            }
+
+            mFound.clear();
+            pGrid.query(mPosition, pRadius, mFound);
+            std::sort(mExpected.begin(), mExpected.end());
+            std::sort(mFound.begin(), mFound.end());
+            if (mFound != mExpected) {
+                return "radius query differs";
+            }
+
+            /* particles at the same distance are equally valid */
+            Particle* mGridNearest = pGrid.nearest(mPosition, pRadius);
+            if ((mGridNearest == nullptr) != (mNearest == nullptr) ||
+                (mNearest != nullptr && distanceSquared(mPosition, mGridNearest->position()) != mNearestDistanceSquared)) {
+                return "nearest particle differs";
+            }
+            Particle* mUnbounded = pGrid.nearest(mPosition);
+            float     mClosest   = std::numeric_limits<float>::max();
+            for (const auto& p: pParticles) {
+                mClosest = std::min(mClosest, distanceSquared(mPosition, p->position()));
+            }
+            if (mUnbounded == nullptr || distanceSquared(mPosition, mUnbounded->position()) != mClosest) {
+                return "unbounded nearest particle differs";
+            }
+        }
+
+        std::vector<std::pair<const Particle*, const Particle*>> mExpected;
+        for (size_t i = 0; i < pParticles.size(); ++i) {
+            for (size_t j = i + 1; j < pParticles.size(); ++j) {
+                if (distanceSquared(pParticles[i]->position(), pParticles[j]->position()) < pRadius * pRadius) {
+                    mExpected.push_back(ordered(pParticles[i], pParticles[j]));
+                }
+            }
+        }
+        std::sort(mExpected.begin(), mExpected.end());
+
+        std::vector<std::pair<const Particle*, const Particle*>> mVisited;
+        pGrid.pairs(pRadius, [&](const Particle* pA, const Particle* pB, float) {
+            mVisited.push_back(ordered(pA, pB));
+        });
+        std::sort(mVisited.begin(), mVisited.end());
+        if (mVisited != mExpected) {
+            return "pairs visited by callback differ";
+        }
+
+        std::vector<SpatialHashGrid::Pair> mPairs;
+        std::vector<SpatialHashGrid::Pair> mThreadedPairs;
+        pGrid.pairs(pRadius, mPairs);
+        pGrid.pairs(pRadius, mThreadedPairs, &pThreadPool);
+        if (mPairs.size() != mThreadedPairs.size() ||
+            !std::equal(mPairs.begin(), mPairs.end(), mThreadedPairs.begin(), [](const SpatialHashGrid::Pair& a, const SpatialHashGrid::Pair& b) {
+                return a.a == b.a && a.b == b.b;
+            })) {
+            return "pairs collected on multiple threads differ";
+        }
+        mVisited.clear();
+        for (const auto& p: mPairs) {
+            mVisited.push_back(ordered(pGrid.particles()[p.a], pGrid.particles()[p.b]));
+        }
+        std::sort(mVisited.begin(), mVisited.end());
+        if (mVisited != mExpected) {
+            return "collected pairs differ";
+        }
+        return "";
+    }
+} // namespace
+
+int main() {
+    std::mt19937 mRandom(1234);
+    ThreadPool   mThreadPool(4);
+    int          mFailures = 0;
+    for (int mDistribution = 0; mDistribution < 3; ++mDistribution) {
+        const auto             mOwned = scatter(mDistribution, mRandom);
+        std::vector<Particle*> mParticles;
+        for (const auto& p: mOwned) {
+            mParticles.push_back(p.get());
+        }
+        for (const float mCellSize: {1.0f, 8.0f, 64.0f}) {
+            SpatialHashGrid mGrid(mCellSize);
+            mGrid.build(mParticles, mCellSize > 1.0f ? &mThreadPool : nullptr);
+            const float mRadius = 8.0f;
+            const char* mError  = check(mParticles, mGrid, mRadius, mThreadPool, mRandom);
+            std::printf("distribution %d, cell size %4.1f: %s\n", mDistribution, mCellSize, *mError == '\0' ? "ok" : mError);
+            mFailures += *mError != '\0';
+        }
+    }
+    return mFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+/*
+ * checks the invariants of `SpringColoring` under random spring additions and removals: every spring is listed
+ * exactly once, springs of the same color share no particle and springs only overflow once their particles use all
+ * colors. the coloring physics keeps while applying springs on multiple threads is checked the same way after
+ * every step of a system whose springs are added, removed and re-pointed at random.
+ */
+
+#include <bitset>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "BasicParticle.h"
+#include "Physics.h"
+#include "SpringColoring.h"
+
+namespace {
+    using Colors = std::bitset<SpringColoring::MAX_COLORS>;
+
+    /*
+     * returns an empty string if `pColoring` colors exactly `pSprings` with their current particles or a
+     * description of the first violation. with `pGreedy` set overflowing springs must have no free color left.
+     */
+    const char* check(const SpringColoring& pColoring, const std::vector<Spring*>& pSprings, const bool pGreedy) {
+        std::unordered_set<const Spring*>           mListed;
+        std::unordered_map<const Particle*, Colors> mUsedColors;
+        for (size_t c = 0; c < pColoring.colors(); ++c) {
+            if (pColoring.color(c).empty() && c + 1 == pColoring.colors()) {
+                return "last color is empty";
+            }
+            for (const auto& e: pColoring.color(c)) {
+                if (!mListed.insert(e.spring).second) {
+                    return "spring is listed twice";
+                }
+                if (e.spring->a() != e.a || e.spring->b() != e.b) {
+                    return "spring is listed with outdated particles";
+                }
+                if (mUsedColors[e.a].test(c) || mUsedColors[e.b].test(c)) {
+                    return "springs of the same color share a particle";
+                }
+                mUsedColors[e.a].set(c);
+                mUsedColors[e.b].set(c);
+            }
+        }
+        for (const auto& e: pColoring.overflow()) {
+            if (!mListed.insert(e.spring).second) {
+                return "spring is listed twice";
+            }
+            if (pGreedy && !(mUsedColors[e.a] | mUsedColors[e.b]).all()) {
+                return "spring overflows although a color is free";
+            }
+        }
+        if (mListed.size() != pSprings.size() || pColoring.size() != pSprings.size()) {
+            return "number of listed springs differs from number of springs";
+        }
+        for (const auto& s: pSprings) {
+            if (mListed.count(s) == 0) {
+                return "spring is not listed";
+            }
+        }
+        return "";
+    }
+
+    int checkColoring() {
+        constexpr int PARTICLES = 200;
+        constexpr int EDITS     = 3000;
+
+        std::mt19937                                mRandom(1234);
+        std::vector<std::unique_ptr<BasicParticle>> mParticles;
+        for (int i = 0; i < PARTICLES; ++i) {
+            mParticles.push_back(std::make_unique<BasicParticle>());
+        }
+        /* one hub particle collects enough springs to overflow */
+        const auto mPick = [&](const size_t pSize) {
+            return std::uniform_int_distribution<size_t>(0, pSize - 1)(mRandom);
+        };
+        const auto mParticle = [&]() {
+            return mPick(8) == 0 ? mParticles[0].get() : mParticles[mPick(mParticles.size())].get();
+        };
+
+        SpringColoring                       mColoring;
+        std::vector<std::unique_ptr<Spring>> mSprings;
+        std::vector<Spring*>                 mColored;
+        for (int i = 0; i < EDITS; ++i) {
+            /* springs are only added in the first half, so that overflowing springs can be checked for greed */
+            const bool mAdding = i < EDITS / 2 || mPick(2) == 0;
+            if (mAdding || mColored.empty()) {
+                Particle* mA = mParticle();
+                Particle* mB = mParticle();
+                if (mA == mB) {
+                    continue;
+                }
+                mSprings.push_back(std::make_unique<Spring>(mA, mB));
+                mColored.push_back(mSprings.back().get());
+                mColoring.add(mSprings.back().get());
+            } else {
+                const size_t mIndex = mPick(mColored.size());
+                mColoring.remove(mColored[mIndex]);
+                mColored[mIndex] = mColored.back();
+                mColored.pop_back();
+            }
+            const char* mError = check(mColoring, mColored, i < EDITS / 2);
+            if (*mError != '\0') {
+                std::printf("coloring: %s after edit %d\n", mError, i);
+                return 1;
+            }
+        }
+        std::printf("coloring: %zu colors, %zu overflowing springs ok\n", mColoring.colors(), mColoring.overflow().size());
+        return 0;
+    }
+
+    int checkPhysics() {
+        constexpr int PARTICLES = 300;
+        constexpr int STEPS     = 300;
+
+        Physics mPhysics;
+        mPhysics.threads(4);
+        std::mt19937 mRandom(1234);
+        const auto   mPick = [&](const size_t pSize) {
+            return std::uniform_int_distribution<size_t>(0, pSize - 1)(mRandom);
+        };
+        for (int i = 0; i < PARTICLES; ++i) {
+            mPhysics.makeParticle(static_cast<float>(i), 0, 0);
+        }
+        std::vector<Spring*> mSprings;
+        for (int i = 0; i < STEPS; ++i) {
+            const std::vector<Particle*>& mParticles = mPhysics.particles();
+            for (int j = 0; j < 8; ++j) {
+                const size_t mAction = mPick(10);
+                if (mAction < 5 || mSprings.empty()) {
+                    Particle* mA = mParticles[mPick(mParticles.size())];
+                    Particle* mB = mParticles[mPick(mParticles.size())];
+                    if (mA != mB) {
+                        mSprings.push_back(mPhysics.makeSpring(mA, mB));
+                    }
+                } else {
+                    const size_t mIndex = mPick(mSprings.size());
+                    if (mAction < 8) {
+                        mPhysics.remove(mSprings[mIndex]);
+                        mSprings[mIndex] = mSprings.back();
+                        mSprings.pop_back();
+                    } else if (mSprings[mIndex]->a() != mParticles[mIndex % mParticles.size()]) {
+                        mSprings[mIndex]->b(mParticles[mIndex % mParticles.size()]);
+                    }
+                }
+            }
+            mPhysics.step(1.0f / 60.0f);
+            const char* mError = check(mPhysics.spring_coloring(), mSprings, false);
+            if (*mError != '\0') {
+                std::printf("physics: %s after step %d\n", mError, i);
+                return 1;
+            }
+        }
+        std::printf("physics: %zu colors, %zu springs ok\n", mPhysics.spring_coloring().colors(), mSprings.size());
+        return 0;
+    }
+} // namespace
+
+int main() {
+    const int mFailures = checkColoring() + checkPhysics();
+    return mFailures == 0 ? 0 : 1;
+}
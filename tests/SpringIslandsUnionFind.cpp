@@ -0,0 +1,219 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+/*
+ * adds, removes and re-points springs and removes particles at random while stepping a system with islands enabled.
+ * after every step the islands are compared with the connected components of a union-find that is rebuilt from
+ * scratch over all springs of the system: particles share an island if and only if they share a component, every
+ * spring lies in the island of its particles and particles without springs belong to no island.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Physics.h"
+
+namespace {
+    constexpr int STEPS     = 400;
+    constexpr int PARTICLES = 300;
+
+    class UnionFind {
+        std::unordered_map<const Particle*, const Particle*> mParents;
+
+    public:
+        const Particle* find(const Particle* pParticle) {
+            const auto it = mParents.find(pParticle);
+            if (it == mParents.end()) {
+                mParents.emplace(pParticle, pParticle);
+                return pParticle;
+            }
+            if (it->second == pParticle) {
+                return pParticle;
+            }
+            const Particle* mRoot = find(it->second);
+            mParents[pParticle]   = mRoot;
+            return mRoot;
+        }
+
+        void unite(const Particle* pA, const Particle* pB) {
+            const Particle* mA = find(pA);
+            const Particle* mB = find(pB);
+            if (mA != mB) {
+                mParents[mA] = mB;
+            }
+        }
+
+        bool contains(const Particle* pParticle) const {
+            return mParents.find(pParticle) != mParents.end();
+        }
+    };
+
+    std::vector<Spring*> springs(const Physics& pPhysics) {
+        std::vector<Spring*> mSprings;
+        for (const auto& f: pPhysics.forces()) {
+            if (const auto mSpring = dynamic_cast<Spring*>(f)) {
+                mSprings.push_back(mSpring);
+            }
+        }
+        return mSprings;
+    }
+
+    /* returns an empty string if the islands match the union-find or a description of the first mismatch */
+    const char* check(Physics& pPhysics) {
+        const std::vector<Spring*> mSprings = springs(pPhysics);
+        UnionFind                  mComponents;
+        for (const auto& s: mSprings) {
+            mComponents.unite(s->a(), s->b());
+        }
+        const SpringIslands& mIslands = pPhysics.islands();
+
+        /* components and islands map onto each other one to one */
+        std::unordered_map<const Particle*, uint32_t> mIslandByComponent;
+        std::unordered_set<uint32_t>                  mUsedIslands;
+        for (const auto& p: pPhysics.particles()) {
+            const uint32_t mIsland = mIslands.island(p);
+            if (!mComponents.contains(p)) {
+                if (mIsland != SpringIslands::INVALID_ISLAND) {
+                    return "particle without springs belongs to an island";
+                }
+                continue;
+            }
+            if (mIsland == SpringIslands::INVALID_ISLAND) {
+                return "connected particle belongs to no island";
+            }
+            const auto it = mIslandByComponent.emplace(mComponents.find(p), mIsland);
+            if (it.first->second != mIsland) {
+                return "component is split over several islands";
+            }
+            if (it.second && !mUsedIslands.insert(mIsland).second) {
+                return "island joins several components";
+            }
+        }
+        if (mIslandByComponent.size() != mIslands.size()) {
+            return "number of islands differs from number of components";
+        }
+
+        /* every spring is listed once, in the island of its particles */
+        size_t mListed = 0;
+        for (uint32_t i = 0; i < mIslands.islands().size(); ++i) {
+            const SpringIslands::Island& mIsland = mIslands.islands()[i];
+            for (const auto& p: mIsland.particles) {
+                if (mIslands.island(p) != i) {
+                    return "island lists a particle of another island";
+                }
+            }
+            for (const auto& e: mIsland.springs) {
+                if (e.spring->a() != e.a || e.spring->b() != e.b) {
+                    return "island lists a spring with outdated particles";
+                }
+                if (mIslands.island(e.a) != i || mIslands.island(e.b) != i) {
+                    return "island lists a spring of another island";
+                }
+                ++mListed;
+            }
+        }
+        if (mListed != mSprings.size()) {
+            return "number of listed springs differs from number of springs";
+        }
+        return "";
+    }
+
+    int run(const bool pParticleStore, const size_t pThreads) {
+        Physics mPhysics;
+        mPhysics.useParticleStore(pParticleStore);
+        mPhysics.threads(pThreads);
+        mPhysics.useIslands(true);
+
+        std::mt19937 mRandom(1234);
+        const auto   mPick = [&](const size_t pSize) {
+            return std::uniform_int_distribution<size_t>(0, pSize - 1)(mRandom);
+        };
+        for (int i = 0; i < PARTICLES; ++i) {
+            mPhysics.makeParticle(static_cast<float>(i), 0, 0);
+        }
+        for (int i = 0; i < STEPS; ++i) {
+            const std::vector<Particle*>& mParticles = mPhysics.particles();
+            const std::vector<Spring*>    mSprings   = springs(mPhysics);
+            const int                     mEdits     = 1 + static_cast<int>(mPick(8));
+            for (int j = 0; j < mEdits; ++j) {
+                const size_t mAction = mPick(10);
+                if (mAction < 5 || mSprings.empty()) {
+                    Particle* mA = mParticles[mPick(mParticles.size())];
+                    Particle* mB = mParticles[mPick(mParticles.size())];
+                    if (mA != mB) {
+                        mPhysics.makeSpring(mA, mB);
+                    }
+                } else if (mAction < 7) {
+                    Spring* mSpring = mSprings[mPick(mSprings.size())];
+                    if (mPhysics.handle(mSpring).valid()) {
+                        mPhysics.remove(mSpring);
+                    }
+                } else if (mAction < 9) {
+                    Spring*   mSpring   = mSprings[mPick(mSprings.size())];
+                    Particle* mParticle = mParticles[mPick(mParticles.size())];
+                    if (mPhysics.handle(mSpring).valid() && mSpring->a() != mParticle) {
+                        mSpring->b(mParticle);
+                    }
+                } else {
+                    Particle* mParticle = mParticles[mPick(mParticles.size())];
+                    if (mPick(2) == 0) {
+                        mParticle->dead(true);
+                    } else if (mPhysics.handle(mParticle).valid()) {
+                        mPhysics.remove(mParticle);
+                    }
+                }
+            }
+            if (mPhysics.particles().size() < PARTICLES / 2) {
+                for (int j = 0; j < PARTICLES / 2; ++j) {
+                    mPhysics.makeParticle(static_cast<float>(j), 1, 0);
+                }
+            }
+            mPhysics.step(1.0f / 60.0f);
+            const char* mError = check(mPhysics);
+            if (*mError != '\0') {
+                std::printf("store %d, threads %zu: %s after step %d\n", pParticleStore, pThreads, mError, i);
+                return 1;
+            }
+        }
+        std::printf("store %d, threads %zu: %zu islands, %zu springs ok\n",
+                    pParticleStore,
+                    pThreads,
+                    mPhysics.islands().size(),
+                    springs(mPhysics).size());
+        return 0;
+    }
+} // namespace
+
+int main() {
+    int mFailures = 0;
+    for (const bool mParticleStore: {false, true}) {
+        for (const size_t mThreads: {1, 4}) {
+            mFailures += run(mParticleStore, mThreads);
+        }
+    }
+    return mFailures == 0 ? 0 : 1;
+}
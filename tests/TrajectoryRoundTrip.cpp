@@ -0,0 +1,219 @@
+/*
+ * Teilchen++
+ *
+ * This file is part of the *teilchen* library (https://github.com/dennisppaul/teilchen).
+ * Copyright (c) 2024 Dennis P Paul.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * {@link http://www.gnu.org/licenses/lgpl.html}
+ *
+ */
+
+/*
+ * writes trajectories with `TrajectoryRecorder` and reads them back with `TrajectoryReader`. every decoded value
+ * must equal the recorded value quantized to the precision of the file. the frames cover resting, moving and
+ * jumping particles, keyframe boundaries and a change of the particle count. frames are read in order and by
+ * seeking backwards, forward within the frames of one keyframe and forward across keyframes. a copy of the file
+ * with its last frame cut off must read like the original without that frame.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Physics.h"
+#include "TrajectoryRecorder.h"
+
+namespace {
+    constexpr float    PRECISION         = 0.001f;
+    constexpr uint32_t KEYFRAME_INTERVAL = 10;
+    constexpr int      FRAMES            = 100;
+
+    struct Expected {
+        uint64_t             step;
+        bool                 keyframe;
+        std::vector<PVector> positions;
+        std::vector<PVector> velocities;
+    };
+
+    /* the value `pValue` is read back as */
+    float quantized(const float pValue) {
+        return static_cast<float>(std::lrint(pValue * (1.0f / PRECISION))) * PRECISION;
+    }
+
+    PVector quantized(const PVector& pValue) {
+        return {quantized(pValue.x), quantized(pValue.y), quantized(pValue.z)};
+    }
+
+    /* moves the particles of `pPhysics` to the state of frame `pFrame` */
+    void move(Physics& pPhysics, const int pFrame) {
+        const auto& mParticles = pPhysics.particles();
+        const auto  t          = static_cast<float>(pFrame);
+        for (size_t i = 0; i < mParticles.size(); ++i) {
+            const auto mIndex = static_cast<float>(i);
+            PVector    mPosition;
+            PVector    mVelocity;
+            switch (i % 4) {
+                case 0:
+                    /* resting particles form runs of correctly predicted components */
+                    mPosition.set(mIndex, -mIndex, 0.5f);
+                    break;
+                case 1:
+                    mPosition.set(mIndex + 0.25f * t, 3.0f - 0.125f * t, 0.0f);
+                    mVelocity.set(0.25f, -0.125f, 0.0f);
+                    break;
+                case 2:
+                    mPosition.set(std::sin(t * 0.3f + mIndex) * 50.0f, std::cos(t * 0.2f) * 50.0f, mIndex * 0.001f);
+                    mVelocity.set(std::cos(t * 0.3f + mIndex) * 15.0f, -std::sin(t * 0.2f) * 10.0f, 0.0f);
+                    break;
+                default:
+                    /* large jumps produce long variable length integers */
+                    mPosition.set(((pFrame * 7919 + static_cast<int>(i) * 104729) % 1000001 - 500000) * 0.9f, -mIndex * 1000.0f, t);
+                    mVelocity.set(-mPosition.x, 0.0f, 1.0e-4f);
+                    break;
+            }
+            mParticles[i]->position().set(mPosition);
+            mParticles[i]->velocity().set(mVelocity);
+        }
+    }
+
+    bool equal(const std::vector<PVector>& pA, const std::vector<PVector>& pB) {
+        if (pA.size() != pB.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < pA.size(); ++i) {
+            if (pA[i].x != pB[i].x || pA[i].y != pB[i].y || pA[i].z != pB[i].z) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool check(TrajectoryReader& pReader, const std::vector<Expected>& pExpected, const size_t pFrame) {
+        const Expected& e = pExpected[pFrame];
+        return pReader.seek(pFrame) &&
+               pReader.frame() == pFrame &&
+               pReader.step() == e.step &&
+               equal(pReader.positions(), e.positions) &&
+               equal(pReader.velocities(), e.velocities);
+    }
+
+    /* returns an empty string if the trajectory reads back as expected or a description of the first mismatch */
+    const char* read(const std::string& pFilePath, const std::vector<Expected>& pExpected) {
+        TrajectoryReader mReader(pFilePath);
+        if (!mReader.good() || mReader.frames() != pExpected.size()) {
+            return "wrong number of frames";
+        }
+        for (size_t i = 0; i < pExpected.size(); ++i) {
+            if (!mReader.next() || !check(mReader, pExpected, i)) {
+                return "frame read in order differs";
+            }
+            const bool mKeyframe = mReader.keyframe(i) == i;
+            if (mKeyframe != pExpected[i].keyframe) {
+                return "keyframe at the wrong frame";
+            }
+        }
+        if (mReader.next()) {
+            return "frame read past the end";
+        }
+        /* backwards, forward within the frames of a keyframe, forward across keyframes and onto keyframes */
+        for (const size_t mFrame: {13, 11, 17, 19, 64, 20, 29, 31, 0, 99, 98, 50, 49, 53}) {
+            if (mFrame < pExpected.size() && !check(mReader, pExpected, mFrame)) {
+                return "frame read by seeking differs";
+            }
+        }
+        if (mReader.seek(pExpected.size())) {
+            return "frame read by seeking past the end";
+        }
+        return "";
+    }
+
+    int run(const bool pVelocities) {
+        const std::string mFilePath  = "trajectory_round_trip.bin";
+        const std::string mTruncated = "trajectory_round_trip_truncated.bin";
+
+        /* frames 25 to 49 are captured from a system with more particles, which forces keyframes */
+        Physics mPhysics;
+        Physics mGrown;
+        for (int i = 0; i < 40; ++i) {
+            mPhysics.makeParticle();
+        }
+        for (int i = 0; i < 47; ++i) {
+            mGrown.makeParticle();
+        }
+
+        std::vector<Expected> mExpected;
+        {
+            /* the queue holds every frame so none is dropped */
+            TrajectoryRecorder mRecorder(mFilePath, pVelocities, PRECISION, KEYFRAME_INTERVAL, FRAMES);
+            size_t             mLastCount = 0;
+            for (int i = 0; i < FRAMES; ++i) {
+                Physics& mSource = i >= 25 && i < 50 ? mGrown : mPhysics;
+                move(mSource, i);
+                if (!mRecorder.record(mSource)) {
+                    break;
+                }
+                Expected e;
+                e.step     = static_cast<uint64_t>(i);
+                e.keyframe = mExpected.size() % KEYFRAME_INTERVAL == 0 || mSource.particles().size() != mLastCount;
+                for (const auto& p: mSource.particles()) {
+                    e.positions.push_back(quantized(p->position()));
+                    if (pVelocities) {
+                        e.velocities.push_back(quantized(p->velocity()));
+                    }
+                }
+                mLastCount     = mSource.particles().size();
+                mExpected.push_back(e);
+            }
+            mRecorder.close();
+            if (!mRecorder.good() || mExpected.size() != FRAMES || mRecorder.recorded() != FRAMES) {
+                std::printf("velocities %d: recording failed\n", pVelocities);
+                return 1;
+            }
+        }
+
+        const char* mError = read(mFilePath, mExpected);
+
+        /* a copy with the last frame cut off in the middle */
+        if (*mError == '\0') {
+            std::FILE* mIn  = std::fopen(mFilePath.c_str(), "rb");
+            std::FILE* mOut = std::fopen(mTruncated.c_str(), "wb");
+            std::vector<char> mBytes;
+            if (mIn != nullptr) {
+                std::fseek(mIn, 0, SEEK_END);
+                mBytes.resize(static_cast<size_t>(std::ftell(mIn)));
+                std::fseek(mIn, 0, SEEK_SET);
+                mBytes.resize(std::fread(mBytes.data(), 1, mBytes.size(), mIn));
+                std::fclose(mIn);
+            }
+            if (mOut != nullptr) {
+                std::fwrite(mBytes.data(), 1, mBytes.size() - 3, mOut);
+                std::fclose(mOut);
+            }
+            mExpected.pop_back();
+            mError = read(mTruncated, mExpected);
+        }
+        std::printf("velocities %d: %d frames %s\n", pVelocities, FRAMES, *mError == '\0' ? "ok" : mError);
+        std::remove(mFilePath.c_str());
+        std::remove(mTruncated.c_str());
+        return *mError == '\0' ? 0 : 1;
+    }
+} // namespace
+
+int main() {
+    const int mFailures = run(false) + run(true);
+    return mFailures == 0 ? 0 : 1;
+}